@@ -0,0 +1,45 @@
+#ifndef DSVCOLUMNLOADER_H
+#define DSVCOLUMNLOADER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DSVReader.h"
+
+class CDSVColumnLoader{
+    private:
+        struct SImplementation;
+        std::unique_ptr<SImplementation> DImplementation;
+
+    public:
+        enum class EColumnType{UInt64, Double, String, Enum};
+
+        struct SStatistics{
+            std::size_t DRows = 0; // data rows read, not counting the header
+            std::size_t DLoadedRows = 0; // rows stored in the columns
+            std::size_t DShortRows = 0; // rows dropped for missing a bound column
+            std::size_t DBadRows = 0; // rows dropped for a value that did not parse
+            bool DHeaderFound = false; // columns were bound by header name
+        };
+
+        CDSVColumnLoader();
+        ~CDSVColumnLoader();
+
+        std::size_t AddColumn(const std::string &name, EColumnType type);
+        bool Load(std::shared_ptr< CDSVReader > src);
+
+        std::size_t RowCount() const;
+        const SStatistics &Statistics() const;
+        std::size_t BadValueCount(std::size_t column) const;
+
+        const std::vector<uint64_t> &UInt64Column(std::size_t column) const;
+        const std::vector<double> &DoubleColumn(std::size_t column) const;
+        std::string_view StringValue(std::size_t column, std::size_t row) const;
+        const std::vector<uint32_t> &EnumColumn(std::size_t column) const;
+        std::size_t EnumValueCount(std::size_t column) const;
+        std::string_view EnumValue(std::size_t column, uint32_t code) const;
+};
+
+#endif
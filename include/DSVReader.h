@@ -3,7 +3,10 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 #include "DataSource.h"
+#include "DSVRowIndex.h"
 
 class CDSVReader{
     private:
@@ -16,6 +19,8 @@ class CDSVReader{
 
         bool End() const;
         bool ReadRow(std::vector<std::string> &row);
+        bool ReadRowView(std::vector<std::string_view> &row);
+        bool SeekRow(const CDSVRowIndex &index, std::size_t row);
 };
 
 #endif
@@ -0,0 +1,36 @@
+#ifndef DSVROWINDEX_H
+#define DSVROWINDEX_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "DataSink.h"
+#include "DataSource.h"
+
+// byte offsets of every interval-th row of DSV data, row ends are found with
+// the same quote aware rules as CDSVReader so an offset is always the start of
+// a row the reader would return, the index can be saved to a sidecar and
+// loaded back to start reading at any row without scanning from the start
+class CDSVRowIndex{
+    private:
+        std::size_t DInterval;
+        std::size_t DRowCount;
+        std::vector<uint64_t> DOffsets;
+
+    public:
+        static const std::size_t DefaultInterval = 1024;
+
+        CDSVRowIndex(std::size_t interval = DefaultInterval);
+
+        bool Build(std::shared_ptr< CDataSource > src);
+        bool Save(std::shared_ptr< CDataSink > sink) const;
+        bool Load(std::shared_ptr< CDataSource > src);
+
+        std::size_t Interval() const noexcept;
+        std::size_t RowCount() const noexcept;
+        std::size_t EntryCount() const noexcept;
+        uint64_t Offset(std::size_t entry) const noexcept;
+        bool Locate(std::size_t row, uint64_t &offset, std::size_t &skip) const noexcept;
+};
+
+#endif
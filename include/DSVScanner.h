@@ -0,0 +1,33 @@
+#ifndef DSVSCANNER_H
+#define DSVSCANNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// vectorized scanning primitives shared by the DSV readers, blocks of up to
+// 64 bytes are classified into bitmasks and the quote state is tracked with a
+// prefix xor of the quote mask, a doubled quote toggles the state twice so it
+// never changes which delimiters and newlines are structural
+namespace DSVScanner{
+
+struct SMasks{
+    uint64_t DQuotes;
+    uint64_t DDelimiters;
+    uint64_t DNewlines;
+};
+
+SMasks Classify(const char *data, std::size_t length, char delimiter) noexcept;
+uint64_t PrefixXor(uint64_t mask) noexcept;
+const char *FindRowEnd(const char *begin, const char *end, bool &inquotes) noexcept;
+bool SplitFields(const char *begin, const char *end, char delimiter, std::vector< std::size_t > &ends);
+void Unquote(const char *begin, const char *end, std::string &out);
+void SplitRow(const char *begin, const char *end, char delimiter, std::vector< std::size_t > &ends, std::string &unquoted, std::vector< std::string_view > &row, std::size_t reserve = 0);
+bool QuoteParity(const char *begin, const char *end) noexcept;
+bool NeedsQuotes(const char *begin, const char *end, char delimiter) noexcept;
+
+}
+
+#endif
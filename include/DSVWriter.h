@@ -1,8 +1,12 @@
 #ifndef DSVWRITER_H
 #define DSVWRITER_H
 
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 #include "DataSink.h"
 
 class CDSVWriter{
@@ -10,11 +14,63 @@ class CDSVWriter{
         struct SImplementation;
         std::unique_ptr<SImplementation> DImplementation;
 
+        void BeginRow();
+        void AppendField(std::string_view field);
+        void AppendField(int64_t value);
+        void AppendField(uint64_t value);
+        void AppendField(double value);
+        bool EndRow();
+
+        // picks the field overload for one WriteFields argument
+        template <typename TField> void AppendTyped(const TField &field){
+            if constexpr(std::is_same_v<TField, char>){
+                AppendField(std::string_view(&field, 1));
+            }
+            else if constexpr(std::is_floating_point_v<TField>){
+                AppendField(static_cast<double>(field));
+            }
+            else if constexpr(std::is_integral_v<TField> && std::is_signed_v<TField>){
+                AppendField(static_cast<int64_t>(field));
+            }
+            else if constexpr(std::is_integral_v<TField>){
+                AppendField(static_cast<uint64_t>(field));
+            }
+            else{
+                AppendField(std::string_view(field));
+            }
+        }
+
     public:
+        // one column of a WriteColumns batch, refers to the caller's array
+        // which has to outlive the call
+        struct SColumn{
+            enum class EType{Int64, UInt64, Double, String, StringView};
+
+            EType DType;
+            const void *DData;
+            std::size_t DSize;
+
+            SColumn(const std::vector<int64_t> &values) : DType(EType::Int64), DData(values.data()), DSize(values.size()){}
+            SColumn(const std::vector<uint64_t> &values) : DType(EType::UInt64), DData(values.data()), DSize(values.size()){}
+            SColumn(const std::vector<double> &values) : DType(EType::Double), DData(values.data()), DSize(values.size()){}
+            SColumn(const std::vector<std::string> &values) : DType(EType::String), DData(values.data()), DSize(values.size()){}
+            SColumn(const std::vector<std::string_view> &values) : DType(EType::StringView), DData(values.data()), DSize(values.size()){}
+        };
+
         CDSVWriter(std::shared_ptr< CDataSink > sink, char delimiter, bool quoteall = false);
         ~CDSVWriter();
 
         bool WriteRow(const std::vector<std::string> &row);
+        bool WriteColumns(const std::vector<SColumn> &columns);
+        bool Flush();
+
+        // writes one row with a field per argument, numbers are formatted
+        // straight into the output buffer and strings are copied from views
+        template <typename... TFields> bool WriteFields(const TFields &... fields){
+            BeginRow();
+            (AppendTyped(fields), ...);
+            return EndRow();
+        }
 };
 
 #endif
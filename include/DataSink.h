@@ -8,6 +8,12 @@ class CDataSink{
         virtual ~CDataSink(){};
         virtual bool Put(const char &ch) noexcept = 0;
         virtual bool Write(const std::vector<char> &buf) noexcept = 0;
+
+        // pushes any buffered output to its destination, sinks that do not
+        // buffer have nothing to do
+        virtual bool Flush() noexcept{
+            return true;
+        };
 };
 
 #endif
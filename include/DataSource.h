@@ -2,6 +2,7 @@
 #define DATASOURCE_H
 
 #include <vector>
+#include <cstddef>
 
 class CDataSource{
     public:
@@ -10,6 +11,36 @@ class CDataSource{
         virtual bool Get(char &ch) noexcept = 0;
         virtual bool Peek(char &ch) noexcept = 0;
         virtual bool Read(std::vector<char> &buf, std::size_t count) noexcept = 0;
+
+        // reads up to count bytes into buf, returns the number of bytes read,
+        // sources should override this to avoid the per character Get calls
+        virtual std::size_t ReadBlock(char *buf, std::size_t count) noexcept{
+            std::size_t Length = 0;
+            while(Length < count && Get(buf[Length])){
+                Length++;
+            }
+            return Length;
+        };
+
+        // consumes up to count of the next bytes without copying them, data is
+        // pointed at the bytes which stay valid until the next call on the
+        // source, returns 0 when the source cannot lend its storage or is at
+        // the end so callers fall back to ReadBlock
+        virtual std::size_t Borrow(const char *&data, std::size_t count) noexcept{
+            return 0;
+        };
+
+        // true when reads may stall on I/O or decoding work, readers use this
+        // to overlap filling the source with parsing on a background thread
+        virtual bool Blocking() const noexcept{
+            return false;
+        };
+
+        // repositions the source so the next byte read is at offset from the
+        // start of the data, returns false when the source cannot seek
+        virtual bool Seek(std::size_t offset) noexcept{
+            return false;
+        };
 };
 
 #endif
@@ -0,0 +1,40 @@
+#ifndef FILEDATASINK_H
+#define FILEDATASINK_H
+
+#include "DataSink.h"
+#include <string>
+
+class CFileDataSink : public CDataSink{
+    public:
+        // when the written data is forced to stable storage with fdatasync
+        enum class ESyncPolicy{None, OnFlush, EveryWrite};
+
+        static const std::size_t DefaultBufferSize = 1024 * 1024;
+
+    private:
+        int DFileDescriptor;
+        char *DBuffer;
+        std::size_t DCapacity;
+        std::size_t DLength;
+        bool DDirect;
+        ESyncPolicy DSyncPolicy;
+
+        std::size_t WriteAll(const char *data, std::size_t length) noexcept;
+        bool FlushBuffer(bool final) noexcept;
+
+    public:
+        CFileDataSink(const std::string &filename, std::size_t buffersize = DefaultBufferSize, bool direct = false, ESyncPolicy sync = ESyncPolicy::None);
+        ~CFileDataSink();
+
+        CFileDataSink(const CFileDataSink &) = delete;
+        CFileDataSink &operator=(const CFileDataSink &) = delete;
+
+        bool IsOpen() const noexcept;
+        bool Close() noexcept;
+
+        bool Put(const char &ch) noexcept override;
+        bool Write(const std::vector<char> &buf) noexcept override;
+        bool Flush() noexcept override;
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef FILEDATASOURCE_H
+#define FILEDATASOURCE_H
+
+#include "DataSource.h"
+#include <string>
+
+class CFileDataSource : public CDataSource{
+    private:
+        int DFileDescriptor;
+        std::vector<char> DBuffer;
+        std::size_t DIndex;
+        std::size_t DLength;
+        bool DEnd;
+
+        bool Fill() noexcept;
+
+    public:
+        static const std::size_t DefaultBufferSize = 64 * 1024;
+
+        CFileDataSource(const std::string &filename, std::size_t buffersize = DefaultBufferSize);
+        ~CFileDataSource();
+
+        CFileDataSource(const CFileDataSource &) = delete;
+        CFileDataSource &operator=(const CFileDataSource &) = delete;
+
+        bool IsOpen() const noexcept;
+
+        bool End() const noexcept override;
+        bool Get(char &ch) noexcept override;
+        bool Peek(char &ch) noexcept override;
+        bool Read(std::vector<char> &buf, std::size_t count) noexcept override;
+        std::size_t ReadBlock(char *buf, std::size_t count) noexcept override;
+        bool Blocking() const noexcept override;
+        bool Seek(std::size_t offset) noexcept override;
+};
+
+#endif
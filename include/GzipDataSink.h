@@ -0,0 +1,25 @@
+#ifndef GZIPDATASINK_H
+#define GZIPDATASINK_H
+
+#include "DataSink.h"
+#include <memory>
+
+class CGzipDataSink : public CDataSink{
+    private:
+        struct SImplementation;
+        std::unique_ptr<SImplementation> DImplementation;
+    public:
+        static const std::size_t DefaultBufferSize = 64 * 1024;
+        static const int DefaultLevel = 6;
+
+        CGzipDataSink(std::shared_ptr< CDataSink > sink, int level = DefaultLevel, std::size_t buffersize = DefaultBufferSize);
+        ~CGzipDataSink();
+
+        bool Close() noexcept;
+
+        bool Put(const char &ch) noexcept override;
+        bool Write(const std::vector<char> &buf) noexcept override;
+        bool Flush() noexcept override;
+};
+
+#endif
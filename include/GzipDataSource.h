@@ -0,0 +1,28 @@
+#ifndef GZIPDATASOURCE_H
+#define GZIPDATASOURCE_H
+
+#include "DataSource.h"
+#include <memory>
+
+class CGzipDataSource : public CDataSource{
+    private:
+        struct SImplementation;
+        std::unique_ptr<SImplementation> DImplementation;
+    public:
+        static const std::size_t DefaultBufferSize = 64 * 1024;
+
+        CGzipDataSource(std::shared_ptr< CDataSource > src, std::size_t buffersize = DefaultBufferSize);
+        ~CGzipDataSource();
+
+        bool Error() const noexcept;
+
+        bool End() const noexcept override;
+        bool Get(char &ch) noexcept override;
+        bool Peek(char &ch) noexcept override;
+        bool Read(std::vector<char> &buf, std::size_t count) noexcept override;
+        std::size_t ReadBlock(char *buf, std::size_t count) noexcept override;
+        std::size_t Borrow(const char *&data, std::size_t count) noexcept override;
+        bool Blocking() const noexcept override;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef IDINDEX_H
+#define IDINDEX_H
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// maps 64 bit ids to their position in a list, built once and then only
+// searched, Eytzinger keeps the sorted ids in breadth first order so a search
+// walks the array from the front and is branch free, Hash is an open addressed
+// table that usually answers with one probe at the cost of more memory, when
+// an id appears more than once the first position is kept, the Eytzinger
+// arrays can be copied out and searched in place with FindEytzinger
+class CIDIndex{
+    public:
+        enum class EKind{Eytzinger, Hash};
+
+        static constexpr std::size_t NotFound = std::numeric_limits<std::size_t>::max();
+
+    private:
+        EKind DKind;
+        std::size_t DCount;
+        std::vector<uint64_t> DKeys;
+        std::vector<uint64_t> DPositions;
+        unsigned DShift;
+
+        void BuildEytzinger(std::vector< std::pair<uint64_t, std::size_t> > &entries);
+        void BuildHash(const std::vector< std::pair<uint64_t, std::size_t> > &entries);
+        std::size_t FindHash(uint64_t id) const noexcept;
+
+    public:
+        CIDIndex(EKind kind = EKind::Eytzinger);
+
+        void Build(const std::vector<uint64_t> &ids);
+
+        EKind Kind() const noexcept;
+        std::size_t Count() const noexcept;
+        std::size_t Find(uint64_t id) const noexcept;
+        std::size_t MemoryUsage() const noexcept;
+
+        std::size_t SlotCount() const noexcept;
+        const uint64_t *Keys() const noexcept;
+        const uint64_t *Positions() const noexcept;
+
+        static std::size_t FindEytzinger(const uint64_t *keys, const uint64_t *positions, std::size_t slots, uint64_t id) noexcept;
+};
+
+#endif
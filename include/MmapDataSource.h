@@ -0,0 +1,40 @@
+#ifndef MMAPDATASOURCE_H
+#define MMAPDATASOURCE_H
+
+#include "DataSource.h"
+#include <string>
+
+class CMmapDataSource : public CDataSource{
+    private:
+        const char *DData;
+        std::size_t DSize;
+        std::size_t DIndex;
+        bool DOpen;
+    public:
+        // how the mapping will be read, sequential readers get readahead as
+        // they go while random lookups only fault in the pages they touch
+        enum class EAccess{Sequential, Random};
+
+        CMmapDataSource(const std::string &filename, EAccess access = EAccess::Sequential);
+        ~CMmapDataSource();
+
+        CMmapDataSource(const CMmapDataSource &) = delete;
+        CMmapDataSource &operator=(const CMmapDataSource &) = delete;
+
+        bool IsOpen() const noexcept;
+        const char *Data() const noexcept;
+        std::size_t Size() const noexcept;
+        std::size_t Position() const noexcept;
+        std::size_t Advance(std::size_t count) noexcept;
+        bool Advise(EAccess access) noexcept;
+
+        bool End() const noexcept override;
+        bool Get(char &ch) noexcept override;
+        bool Peek(char &ch) noexcept override;
+        bool Read(std::vector<char> &buf, std::size_t count) noexcept override;
+        std::size_t ReadBlock(char *buf, std::size_t count) noexcept override;
+        std::size_t Borrow(const char *&data, std::size_t count) noexcept override;
+        bool Seek(std::size_t offset) noexcept override;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef OSMXMLTOKENIZER_H
+#define OSMXMLTOKENIZER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// pull tokenizer for the small subset of XML that OSM files use: an optional
+// UTF-8 declaration, elements with quoted attributes and character data with
+// the predefined and numeric entities, anything else such as comments, CDATA
+// sections, doctypes or malformed input stops it so the caller can hand the
+// rest of the input to a full parser
+class COSMXMLTokenizer{
+    private:
+        struct SImplementation;
+        std::unique_ptr<SImplementation> DImplementation;
+
+    public:
+        // receives the events with expat style arguments, names and values are
+        // NUL terminated and attributes is a NULL terminated array of name and
+        // value pairs, all valid only for the call
+        struct SHandler{
+            virtual ~SHandler(){};
+            virtual void StartElement(const char *name, const char **attributes) = 0;
+            virtual void EndElement(const char *name) = 0;
+            virtual void CharData(const char *data, std::size_t length) = 0;
+        };
+
+        enum class EStatus{Ok, Unexpected};
+
+        COSMXMLTokenizer(SHandler &handler);
+        ~COSMXMLTokenizer();
+
+        EStatus Parse(const char *data, std::size_t length, bool final);
+        std::string_view Remainder() const noexcept;
+        std::vector< std::string > OpenElements() const;
+        bool RootClosed() const noexcept;
+};
+
+#endif
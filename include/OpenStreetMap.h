@@ -2,7 +2,9 @@
 #define OPENSTREETMAP_H
 
 #include "XMLReader.h"
+#include "PBFReader.h"
 #include "StreetMap.h"
+#include "IDIndex.h"
 
 class COpenStreetMap : public CStreetMap{
     private:
@@ -10,7 +12,8 @@ class COpenStreetMap : public CStreetMap{
         std::unique_ptr<SImplementation> DImplementation;
 
     public:
-        COpenStreetMap(std::shared_ptr<CXMLReader> src);
+        COpenStreetMap(std::shared_ptr<CXMLReader> src, CIDIndex::EKind index = CIDIndex::EKind::Eytzinger, std::size_t threads = 1);
+        COpenStreetMap(std::shared_ptr<CPBFReader> src, CIDIndex::EKind index = CIDIndex::EKind::Eytzinger);
         ~COpenStreetMap();
 
         std::size_t NodeCount() const noexcept override;
@@ -19,6 +22,10 @@ class COpenStreetMap : public CStreetMap{
         std::shared_ptr<CStreetMap::SNode> NodeByID(TNodeID id) const noexcept override;
         std::shared_ptr<CStreetMap::SWay> WayByIndex(std::size_t index) const noexcept override;
         std::shared_ptr<CStreetMap::SWay> WayByID(TWayID id) const noexcept override;
+
+        std::size_t NodeMemoryUsage() const noexcept;
+        std::size_t StringMemoryUsage() const noexcept;
+        std::size_t IndexMemoryUsage() const noexcept;
 };
 
 #endif
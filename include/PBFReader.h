@@ -0,0 +1,51 @@
+#ifndef PBFREADER_H
+#define PBFREADER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "DataSource.h"
+
+// reader for OSM PBF files, the file is a sequence of blobs that are
+// inflated and decoded on worker threads while ReadBlock hands the decoded
+// blocks out in file order, nodes (plain and dense) and ways are decoded
+// with their author metadata, relations are skipped
+class CPBFReader{
+    private:
+        struct SImplementation;
+        std::unique_ptr<SImplementation> DImplementation;
+
+    public:
+        // the nodes and ways of one primitive block as parallel arrays, tags
+        // are pairs of indexes into the block's string table and the starts
+        // arrays hold where each element's run begins with one extra entry,
+        // the author metadata comes first in each run as version, timestamp,
+        // uid, user and changeset tags with the values as XML writes them
+        struct SBlock{
+            using TTag = std::pair<uint32_t, uint32_t>;
+
+            std::vector<std::string> DStrings;
+            std::vector<uint64_t> DNodeIDs;
+            std::vector<double> DNodeLats;
+            std::vector<double> DNodeLons;
+            std::vector<std::size_t> DNodeTagStarts;
+            std::vector<TTag> DNodeTags;
+            std::vector<uint64_t> DWayIDs;
+            std::vector<std::size_t> DWayRefStarts;
+            std::vector<uint64_t> DWayRefs;
+            std::vector<std::size_t> DWayTagStarts;
+            std::vector<TTag> DWayTags;
+
+            void Clear();
+        };
+
+        CPBFReader(std::shared_ptr< CDataSource > src, std::size_t threads = 0);
+        ~CPBFReader();
+
+        bool End() const;
+        bool ReadBlock(SBlock &block);
+};
+
+#endif
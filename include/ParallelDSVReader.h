@@ -0,0 +1,31 @@
+#ifndef PARALLELDSVREADER_H
+#define PARALLELDSVREADER_H
+
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "MmapDataSource.h"
+
+class CParallelDSVReader{
+    private:
+        struct SImplementation;
+        std::unique_ptr<SImplementation> DImplementation;
+
+    public:
+        using TRow = std::vector<std::string_view>;
+        using TChunkCallback = std::function<void(std::size_t chunk, const TRow &row)>;
+        using TRowCallback = std::function<void(const TRow &row)>;
+
+        static const std::size_t DefaultChunkSize = 8 * 1024 * 1024;
+
+        CParallelDSVReader(std::string_view data, char delimiter, std::size_t threads = 0, std::size_t chunksize = DefaultChunkSize);
+        CParallelDSVReader(std::shared_ptr< CMmapDataSource > src, char delimiter, std::size_t threads = 0, std::size_t chunksize = DefaultChunkSize);
+        ~CParallelDSVReader();
+
+        std::size_t ChunkCount() const;
+        bool ParseChunks(const TChunkCallback &callback);
+        bool ParseOrdered(const TRowCallback &callback);
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef PREFETCHDATASOURCE_H
+#define PREFETCHDATASOURCE_H
+
+#include "DataSource.h"
+#include <memory>
+
+class CPrefetchDataSource : public CDataSource{
+    private:
+        struct SImplementation;
+        std::unique_ptr<SImplementation> DImplementation;
+    public:
+        static const std::size_t DefaultBlockSize = 256 * 1024;
+        static const std::size_t DefaultBlockCount = 4;
+
+        CPrefetchDataSource(std::shared_ptr< CDataSource > src, std::size_t blocksize = DefaultBlockSize, std::size_t blockcount = DefaultBlockCount);
+        ~CPrefetchDataSource();
+
+        bool End() const noexcept override;
+        bool Get(char &ch) noexcept override;
+        bool Peek(char &ch) noexcept override;
+        bool Read(std::vector<char> &buf, std::size_t count) noexcept override;
+        std::size_t ReadBlock(char *buf, std::size_t count) noexcept override;
+        std::size_t Borrow(const char *&data, std::size_t count) noexcept override;
+        bool Seek(std::size_t offset) noexcept override;
+};
+
+#endif
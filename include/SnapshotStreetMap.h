@@ -0,0 +1,37 @@
+#ifndef SNAPSHOTSTREETMAP_H
+#define SNAPSHOTSTREETMAP_H
+
+#include "StreetMap.h"
+#include "DataSink.h"
+#include "MmapDataSource.h"
+
+// street map served straight from a memory mapped snapshot file, the nodes,
+// ways, attributes and id indexes are fixed size arrays in the file that are
+// used in place, so opening a snapshot costs no parsing and processes mapping
+// the same file share its pages, Write saves any street map in the format,
+// opening without verify is only safe for files this process wrote since the
+// lookups trust the stored positions and order
+class CSnapshotStreetMap : public CStreetMap{
+    private:
+        struct SImplementation;
+        std::unique_ptr<SImplementation> DImplementation;
+
+    public:
+        static const uint32_t Version = 1;
+
+        CSnapshotStreetMap(std::shared_ptr<CMmapDataSource> src, bool verify = true);
+        ~CSnapshotStreetMap();
+
+        static bool Write(const CStreetMap &map, std::shared_ptr<CDataSink> sink);
+
+        bool IsValid() const noexcept;
+
+        std::size_t NodeCount() const noexcept override;
+        std::size_t WayCount() const noexcept override;
+        std::shared_ptr<CStreetMap::SNode> NodeByIndex(std::size_t index) const noexcept override;
+        std::shared_ptr<CStreetMap::SNode> NodeByID(TNodeID id) const noexcept override;
+        std::shared_ptr<CStreetMap::SWay> WayByIndex(std::size_t index) const noexcept override;
+        std::shared_ptr<CStreetMap::SWay> WayByID(TWayID id) const noexcept override;
+};
+
+#endif
@@ -15,6 +15,9 @@ class CStringDataSource : public CDataSource{
         bool Get(char &ch) noexcept override;
         bool Peek(char &ch) noexcept override;
         bool Read(std::vector<char> &buf, std::size_t count) noexcept override;
+        std::size_t ReadBlock(char *buf, std::size_t count) noexcept override;
+        std::size_t Borrow(const char *&data, std::size_t count) noexcept override;
+        bool Seek(std::size_t offset) noexcept override;
 };
 
 #endif
@@ -1,16 +1,24 @@
 #ifndef XMLENTITY_H
 #define XMLENTITY_H
 
+#include <cstdint>
+#include <limits>
 #include <utility>
 #include <string>
 #include <vector>
 
 struct SXMLEntity{
     using TAttribute = std::pair< std::string, std::string >;
+    using TSymbolID = uint32_t;
     enum class EType{StartElement, EndElement, CharData, CompleteElement};
+    static constexpr TSymbolID InvalidSymbolID = std::numeric_limits<TSymbolID>::max();
     EType DType;
     std::string DNameData;
     std::vector< TAttribute > DAttributes;
+    // symbol ids from the reader that produced the entity, DAttributeIDs
+    // parallels DAttributes and names the reader did not intern are invalid
+    TSymbolID DNameID = InvalidSymbolID;
+    std::vector< TSymbolID > DAttributeIDs;
     
     bool AttributeExists(const std::string &name) const{
         for(auto &Attribute : DAttributes){
@@ -21,6 +29,29 @@ struct SXMLEntity{
         return false;
     };
     
+    // returns the value of the attribute whose name has the symbol id, or
+    // nullptr if there is none
+    const std::string *FindAttribute(TSymbolID id) const{
+        if(id == InvalidSymbolID){
+            return nullptr;
+        }
+        for(std::vector< TSymbolID >::size_type Index = 0; Index < DAttributeIDs.size() && Index < DAttributes.size(); Index++){
+            if(DAttributeIDs[Index] == id){
+                return &std::get<1>(DAttributes[Index]);
+            }
+        }
+        return nullptr;
+    };
+
+    bool AttributeExists(TSymbolID id) const{
+        return FindAttribute(id) != nullptr;
+    };
+
+    std::string AttributeValue(TSymbolID id) const{
+        const std::string *Value = FindAttribute(id);
+        return Value ? *Value : std::string();
+    };
+
     std::string AttributeValue(const std::string &name) const{
         for(auto &Attribute : DAttributes){
             if(std::get<0>(Attribute) == name){
@@ -41,6 +72,9 @@ struct SXMLEntity{
             }
         }
         DAttributes.push_back(std::make_pair(name,value));
+        if(!DAttributeIDs.empty()){
+            DAttributeIDs.resize(DAttributes.size(), InvalidSymbolID);
+        }
         return true;
     };
 };
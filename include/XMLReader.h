@@ -1,8 +1,13 @@
 #ifndef XMLREADER_H
 #define XMLREADER_H
 
+#include <limits>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
 #include "XMLEntity.h"
+#include "XMLVisitor.h"
 #include "DataSource.h"
 
 class CXMLReader {
@@ -11,11 +16,37 @@ private:
     std::unique_ptr<SImplementation> DImplementation;
 
 public:
-    CXMLReader(std::shared_ptr<CDataSource> src);
+    static const std::size_t DefaultBlockSize = 256 * 1024;
+    static const std::size_t MaxSymbols = 4096;
+
+    // Expat parses any XML, OSM uses a tokenizer specialized for OSM files
+    // that hands the rest of the input to expat when it meets anything else
+    enum class EBackend{Expat, OSM};
+
+    // selects the elements the reader reports, a rejected element is dropped
+    // together with everything inside it before it is ever queued
+    struct SFilter {
+        enum class EMode{All, Allow, Deny};
+        static constexpr std::size_t AnyDepth = std::numeric_limits<std::size_t>::max();
+
+        EMode DMode = EMode::All; // allow only DNames, deny DNames, or report everything
+        std::vector<std::string> DNames; // element names the mode applies to
+        std::size_t DDepth = AnyDepth; // depth the names are checked at, the root element is depth 0
+        bool DDropWhitespace = false; // drop character data that is only whitespace
+    };
+
+    CXMLReader(std::shared_ptr<CDataSource> src, std::size_t blocksize = DefaultBlockSize, EBackend backend = EBackend::Expat);
     virtual ~CXMLReader();
     
     virtual bool End() const;
     virtual bool ReadEntity(SXMLEntity &entity, bool skipcdata = false); // Ensure virtual
+    virtual bool Visit(CXMLVisitor &visitor, bool skipcdata = false);
+
+    void SetFilter(const SFilter &filter);
+    const SFilter &Filter() const;
+
+    SXMLEntity::TSymbolID Symbol(std::string_view name);
+    std::string_view SymbolName(SXMLEntity::TSymbolID id) const;
 };
 
 #endif
@@ -0,0 +1,24 @@
+#ifndef XMLVISITOR_H
+#define XMLVISITOR_H
+
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "XMLEntity.h"
+
+// receives parse events from CXMLReader::Visit without building SXMLEntity
+// objects, the views point into the parser's buffers and are only valid for
+// the duration of the call, names come with their symbol ids from the reader
+// and attributeids parallels attributes
+class CXMLVisitor{
+    public:
+        using TAttribute = std::pair< std::string_view, std::string_view >;
+        using TSymbolID = SXMLEntity::TSymbolID;
+
+        virtual ~CXMLVisitor(){};
+        virtual void StartElement(std::string_view name, TSymbolID nameid, const std::vector< TAttribute > &attributes, const std::vector< TSymbolID > &attributeids){};
+        virtual void EndElement(std::string_view name, TSymbolID nameid){};
+        virtual void CharData(std::string_view data){};
+};
+
+#endif
@@ -2,9 +2,9 @@
 #include <vector>          
 #include <string>          
 #include <unordered_map>  
-#include <iostream> 
 #include "CSVBusSystem.h" 
 #include "DSVReader.h"    
+#include "DSVColumnLoader.h"
 #include "XMLReader.h"
 
 // Class for stop structure
@@ -65,66 +65,52 @@ struct CCSVBusSystem::SImplementation{
 // Constructor for the CSV Bus System
 CCSVBusSystem::CCSVBusSystem(std::shared_ptr< CDSVReader > stopsrc, std::shared_ptr<CDSVReader > routesrc){
     DImplementation = std::make_unique<SImplementation>();
-    // Temporary vector to hold data from each row of CSV
-    std::vector<std::string> row;  
     
-    // If stops CSV is provided, process the stops
+    // If stops CSV is provided, load the stop and node id columns, rows that
+    // do not parse (or a header with other names) are counted by the loader
     if (stopsrc) {
-        // Read each row of the stops CSV file
-        while (stopsrc->ReadRow(row)) {
-            if (row.size() >= 2) {
-                //make sure info is valid  
-                try {
-                    auto stop = std::make_shared<SStop>();
-
-                    // Convert and store stop ID and node ID from the row data
-                    stop->StopID = std::stoul(row[0]);  
-                    stop->val = std::stoul(row[1]);
-
-                    // Add the stop to the stops map and the list
-                    DImplementation->Stops[stop->StopID] = stop; 
-                    DImplementation->SList.push_back(stop);  
-
-                // Handle any exceptions that occur
-                } catch (const std::exception& e) {
-                    std::cerr << "Exception caught: " << e.what() << "\n";
-                }
-            }
+        CDSVColumnLoader loader;
+        auto stopColumn = loader.AddColumn("stop_id", CDSVColumnLoader::EColumnType::UInt64);
+        auto nodeColumn = loader.AddColumn("node_id", CDSVColumnLoader::EColumnType::UInt64);
+        loader.Load(stopsrc);
+
+        const auto &stopIDs = loader.UInt64Column(stopColumn);
+        const auto &nodeIDs = loader.UInt64Column(nodeColumn);
+        DImplementation->SList.reserve(loader.RowCount());
+        for (std::size_t index = 0; index < loader.RowCount(); index++) {
+            auto stop = std::make_shared<SStop>();
+
+            // Store stop ID and node ID from the columns
+            stop->StopID = stopIDs[index];  
+            stop->val = nodeIDs[index];
+
+            // Add the stop to the stops map and the list
+            DImplementation->Stops[stop->StopID] = stop; 
+            DImplementation->SList.push_back(stop);  
         }
     }
 
     
     if (routesrc) {
-
-        std::unordered_map<std::string, std::shared_ptr<SRoute>> temp;  
-        // Read each row from the routes CSV
-        while (routesrc->ReadRow(row)) {  
-            if (row.size() >= 2) {  
-                //make sure info is valid
-                try {
-                    std::string name = row[0];  
-                    TStopID stopID = std::stoul(row[1]);  
-
-                    // Find or create a route for the name
-                    auto& route = temp[name];  
-                    if (!route) {
-                        route = std::make_shared<SRoute>();
-                        route->RouteName = name;
-                    }
-
-                    // Add the stop ID to the route's list of stops
-                    route->RouteStops.push_back(stopID);  
-
-                // Handle any exceptions that occur
-                } catch (const std::exception& e) { 
-                    std::cerr << "Exception caught: " << e.what() << "\n";
-                }
-            }
+        // Route names are loaded as an enum so each name is stored once
+        CDSVColumnLoader loader;
+        auto routeColumn = loader.AddColumn("route", CDSVColumnLoader::EColumnType::Enum);
+        auto stopColumn = loader.AddColumn("stop_id", CDSVColumnLoader::EColumnType::UInt64);
+        loader.Load(routesrc);
+
+        // Create the routes in order of first appearance
+        for (uint32_t code = 0; code < loader.EnumValueCount(routeColumn); code++) {
+            auto route = std::make_shared<SRoute>();
+            route->RouteName = std::string(loader.EnumValue(routeColumn, code));
+            DImplementation->Routes[route->RouteName] = route; 
+            DImplementation->RList.push_back(route);  
         }
-        // After reading the CSV, add all routes to the system's routes map and list
-        for (const auto& pair : temp) {
-            DImplementation->Routes[pair.first] = pair.second; 
-            DImplementation->RList.push_back(pair.second);  
+
+        // Add the stop IDs to their route's list of stops
+        const auto &routeCodes = loader.EnumColumn(routeColumn);
+        const auto &stopIDs = loader.UInt64Column(stopColumn);
+        for (std::size_t index = 0; index < loader.RowCount(); index++) {
+            DImplementation->RList[routeCodes[index]]->RouteStops.push_back(stopIDs[index]);  
         }
     }
 }
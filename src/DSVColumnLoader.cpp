@@ -0,0 +1,207 @@
+#include "DSVColumnLoader.h"
+#include <charconv>
+#include <deque>
+#include <unordered_map>
+
+// loads the bound columns of a DSV file into one vector per column, values are
+// parsed with from_chars straight from the reader's field views and rows that
+// do not parse are counted and dropped so every column keeps the same length
+struct CDSVColumnLoader::SImplementation{
+    struct SColumn{
+        std::string Name;
+        EColumnType Type;
+        std::size_t Field = 0; // position of the column in each row
+        std::size_t BadValues = 0;
+        std::vector<uint64_t> UInt64Values;
+        std::vector<double> DoubleValues;
+        std::string Characters; // string values back to back
+        std::vector<std::size_t> Ends; // end offset of each string value
+        std::vector<uint32_t> Codes; // enum code of each row
+        std::deque<std::string> Dictionary; // enum values, deque so views stay put
+        std::unordered_map<std::string_view, uint32_t> Lookup;
+    };
+
+    // parsed numeric cell of the row being loaded
+    union UValue{
+        uint64_t UInt64;
+        double Double;
+    };
+
+    std::vector<SColumn> Columns;
+    std::vector<UValue> Values;
+    SStatistics Statistics;
+    std::size_t Rows = 0;
+
+    // binds columns by header name if every bound name is present in the
+    // first row, otherwise in declaration order with the first row as data
+    bool BindHeader(const std::vector<std::string_view> &row){
+        for(auto &Column : Columns){
+            std::size_t Field = 0;
+            while(Field < row.size() && row[Field] != Column.Name){
+                Field++;
+            }
+            if(Field == row.size()){
+                for(std::size_t Index = 0; Index < Columns.size(); Index++){
+                    Columns[Index].Field = Index;
+                }
+                return false;
+            }
+            Column.Field = Field;
+        }
+        return true;
+    }
+
+    template <typename T> static bool ParseValue(std::string_view field, T &value){
+        auto Result = std::from_chars(field.data(), field.data() + field.size(), value);
+        return Result.ec == std::errc() && Result.ptr == field.data() + field.size();
+    }
+
+    static uint32_t EnumCode(SColumn &column, std::string_view value){
+        auto Search = column.Lookup.find(value);
+        if(Search != column.Lookup.end()){
+            return Search->second;
+        }
+        uint32_t Code = column.Dictionary.size();
+        column.Dictionary.emplace_back(value);
+        column.Lookup.emplace(column.Dictionary.back(), Code);
+        return Code;
+    }
+
+    // stores one data row, numeric cells are parsed before anything is
+    // appended so a bad row leaves the columns untouched
+    void LoadRow(const std::vector<std::string_view> &row){
+        Statistics.DRows++;
+        bool Valid = true;
+        for(std::size_t Index = 0; Index < Columns.size(); Index++){
+            SColumn &Column = Columns[Index];
+            if(Column.Field >= row.size()){
+                Statistics.DShortRows++;
+                return;
+            }
+            std::string_view Field = row[Column.Field];
+            if(Column.Type == EColumnType::UInt64 && !ParseValue(Field, Values[Index].UInt64)){
+                Column.BadValues++;
+                Valid = false;
+            }
+            else if(Column.Type == EColumnType::Double && !ParseValue(Field, Values[Index].Double)){
+                Column.BadValues++;
+                Valid = false;
+            }
+        }
+        if(!Valid){
+            Statistics.DBadRows++;
+            return;
+        }
+        for(std::size_t Index = 0; Index < Columns.size(); Index++){
+            SColumn &Column = Columns[Index];
+            std::string_view Field = row[Column.Field];
+            switch(Column.Type){
+                case EColumnType::UInt64:   Column.UInt64Values.push_back(Values[Index].UInt64);
+                                            break;
+                case EColumnType::Double:   Column.DoubleValues.push_back(Values[Index].Double);
+                                            break;
+                case EColumnType::String:   Column.Characters.append(Field.data(), Field.size());
+                                            Column.Ends.push_back(Column.Characters.size());
+                                            break;
+                case EColumnType::Enum:     Column.Codes.push_back(EnumCode(Column, Field));
+                                            break;
+            }
+        }
+        Rows++;
+        Statistics.DLoadedRows++;
+    }
+
+    bool Load(CDSVReader &reader){
+        std::vector<std::string_view> Row;
+        Values.resize(Columns.size());
+        if(!reader.ReadRowView(Row)){
+            return false;
+        }
+        Statistics.DHeaderFound = BindHeader(Row);
+        if(!Statistics.DHeaderFound){
+            LoadRow(Row);
+        }
+        while(reader.ReadRowView(Row)){
+            if(!Row.empty()){
+                LoadRow(Row);
+            }
+        }
+        return true;
+    }
+
+    static const SColumn *Find(const std::vector<SColumn> &columns, std::size_t column, EColumnType type){
+        return column < columns.size() && columns[column].Type == type ? &columns[column] : nullptr;
+    }
+};
+
+CDSVColumnLoader::CDSVColumnLoader() : DImplementation(std::make_unique<SImplementation>()){
+
+}
+
+CDSVColumnLoader::~CDSVColumnLoader() = default;
+
+// binds a column by its header name, returns the index used by the accessors
+std::size_t CDSVColumnLoader::AddColumn(const std::string &name, EColumnType type){
+    DImplementation->Columns.emplace_back();
+    DImplementation->Columns.back().Name = name;
+    DImplementation->Columns.back().Type = type;
+    return DImplementation->Columns.size() - 1;
+}
+
+// loads every remaining row of src, returns false if src had no rows
+bool CDSVColumnLoader::Load(std::shared_ptr< CDSVReader > src){
+    return src && DImplementation->Load(*src);
+}
+
+// returns the number of rows in each column
+std::size_t CDSVColumnLoader::RowCount() const{
+    return DImplementation->Rows;
+}
+
+const CDSVColumnLoader::SStatistics &CDSVColumnLoader::Statistics() const{
+    return DImplementation->Statistics;
+}
+
+// returns how many values of the column failed to parse
+std::size_t CDSVColumnLoader::BadValueCount(std::size_t column) const{
+    return column < DImplementation->Columns.size() ? DImplementation->Columns[column].BadValues : 0;
+}
+
+// the typed accessors return an empty column if the index or type is wrong
+const std::vector<uint64_t> &CDSVColumnLoader::UInt64Column(std::size_t column) const{
+    static const std::vector<uint64_t> Empty;
+    auto Column = SImplementation::Find(DImplementation->Columns, column, EColumnType::UInt64);
+    return Column ? Column->UInt64Values : Empty;
+}
+
+const std::vector<double> &CDSVColumnLoader::DoubleColumn(std::size_t column) const{
+    static const std::vector<double> Empty;
+    auto Column = SImplementation::Find(DImplementation->Columns, column, EColumnType::Double);
+    return Column ? Column->DoubleValues : Empty;
+}
+
+std::string_view CDSVColumnLoader::StringValue(std::size_t column, std::size_t row) const{
+    auto Column = SImplementation::Find(DImplementation->Columns, column, EColumnType::String);
+    if(!Column || row >= Column->Ends.size()){
+        return std::string_view();
+    }
+    std::size_t Start = row ? Column->Ends[row - 1] : 0;
+    return std::string_view(Column->Characters.data() + Start, Column->Ends[row] - Start);
+}
+
+const std::vector<uint32_t> &CDSVColumnLoader::EnumColumn(std::size_t column) const{
+    static const std::vector<uint32_t> Empty;
+    auto Column = SImplementation::Find(DImplementation->Columns, column, EColumnType::Enum);
+    return Column ? Column->Codes : Empty;
+}
+
+// enum codes are assigned in order of first appearance
+std::size_t CDSVColumnLoader::EnumValueCount(std::size_t column) const{
+    auto Column = SImplementation::Find(DImplementation->Columns, column, EColumnType::Enum);
+    return Column ? Column->Dictionary.size() : 0;
+}
+
+std::string_view CDSVColumnLoader::EnumValue(std::size_t column, uint32_t code) const{
+    auto Column = SImplementation::Find(DImplementation->Columns, column, EColumnType::Enum);
+    return Column && code < Column->Dictionary.size() ? std::string_view(Column->Dictionary[code]) : std::string_view();
+}
@@ -1,64 +1,155 @@
 #include "DSVReader.h"
+#include "PrefetchDataSource.h"
+#include "DSVScanner.h"
 #include <sstream>
 #include <iostream>
 
 // this structure handles reading delimiter-separated values from a data source
 struct CDSVReader::SImplementation {
+    static const std::size_t BlockSize = 65536; // bytes requested from the source per refill
+
     std::shared_ptr<CDataSource> Source;  // holds our data source
     char Delimiter; // the character that splits the data into columns
+    std::vector<char> Buffer; // block storage for sources that cannot lend theirs
+    const char *Cursor; // next unread byte of the current block
+    const char *Limit; // one past the last byte of the current block
+    std::string RowBuffer; // holds a row that does not fit in one block
+    std::vector<std::size_t> FieldEnds; // field end offsets of the current row
+    std::string Unquoted; // storage for fields that had quotes removed
+    std::vector<std::string_view> Views; // field views used by ReadRow
+    bool PendingLineFeed; // the last row ended with a CR that may be followed by LF
     
-    // constructor sets up the data source and the delimiter
+    // constructor sets up the data source and the delimiter, sources that may
+    // stall are filled on a background thread while we parse
     SImplementation(std::shared_ptr<CDataSource> src, char delimiter)
-        : Source(std::move(src)), Delimiter(delimiter) {}
+        : Source(src && src->Blocking() ? std::make_shared<CPrefetchDataSource>(src) : std::move(src)), Delimiter(delimiter), Cursor(nullptr), Limit(nullptr), PendingLineFeed(false) {}
+
+    // fetches the next block from the source, borrowing when possible and
+    // copying into our own buffer otherwise, returns false at the end of data
+    bool Refill() {
+        const char *Data = nullptr;
+        std::size_t Length = Source->Borrow(Data, BlockSize);
+        if (!Length) {
+            Buffer.resize(BlockSize);
+            Length = Source->ReadBlock(Buffer.data(), Buffer.size());
+            Data = Buffer.data();
+        }
+        Cursor = Data;
+        Limit = Data + Length;
+        return Length != 0;
+    }
+
+    // drops the LF of a CRLF pair whose CR ended the previous row, this is
+    // deferred so the previous row's views stay valid until the next read
+    void SkipPendingLineFeed() {
+        if (PendingLineFeed) {
+            PendingLineFeed = false;
+            if ((Cursor != Limit || Refill()) && *Cursor == '\n') {
+                Cursor++;
+            }
+        }
+    }
+
+    // true once the buffered block and the source are both exhausted
+    bool End() {
+        SkipPendingLineFeed();
+        return Cursor == Limit && Source->End();
+    }
+
+    // fills row with views of the fields in the contiguous row text
+    void SplitRow(const char *begin, const char *end, std::vector<std::string_view> &row) {
+        Unquoted.clear();
+        Unquoted.reserve(end - begin); // unquoting only shrinks, so views never move
+        DSVScanner::SplitRow(begin, end, Delimiter, FieldEnds, Unquoted, row);
+    }
     
-    // reads a row of data, splitting it by delimiter and handling quotes
-    bool ReadRow(std::vector<std::string> &row) {
-        row.clear(); // start with a fresh row
-        std::string right; // collects the characters between delimiters
-        char c; // the current character being read
-        bool quotes = false; // inside quoted text
+    // reads a row of data, splitting it by delimiter and handling quotes, the
+    // row end is located first and the row is split while still in the block
+    bool ReadRowView(std::vector<std::string_view> &row) {
+        bool quotes = false; // inside quoted text at the end of the scanned data
         bool data = false; // read any data
+        RowBuffer.clear(); // row text that spans blocks is stitched together here
+        SkipPendingLineFeed();
         
-        while (!Source->End()) {
-            if (!Source->Get(c)) return false; // if we can't read anymore, we are done
+        while (Cursor != Limit || Refill()) {
             data = true;
+            const char *end = DSVScanner::FindRowEnd(Cursor, Limit, quotes);
+            if (end == Limit) {
+                RowBuffer.append(Cursor, Limit - Cursor);
+                Cursor = Limit;
+                continue;
+            }
             
-            if (c == '"') { // handle quotes
-                char next;
-                if (!Source->End() && Source->Peek(next)) {
-                    if (next == '"') { // two quotes in a row means add one quote to the data
-                        Source->Get(next);
-                        right += '"';
-                    } else {
-                        quotes = !quotes; // flip  quote boool
-                    }
-                } else {
-                    quotes = !quotes; // flip  quote bool
-                }
-            } else if (c == Delimiter && !quotes) {
-                row.push_back(std::move(right)); // end of a column
-                right.clear();
-            } else if ((c == '\n' || c == '\r') && !quotes) {
-                if (!right.empty() || !row.empty()) {
-                    row.push_back(std::move(right)); // end of a row
-                }
-                
-                if (c == '\r' && !Source->End()) {  // handle windows line endings
-                    char next;
-                    if (Source->Peek(next) && next == '\n') {
-                        Source->Get(next);
-                    }
-                }
-                return true; // we read a full row
+            if (RowBuffer.empty()) {
+                SplitRow(Cursor, end, row);
             } else {
-                right += c; // just another character in the current column
+                RowBuffer.append(Cursor, end - Cursor);
+                SplitRow(RowBuffer.data(), RowBuffer.data() + RowBuffer.size(), row);
             }
+            Cursor = end + 1;
+            PendingLineFeed = *end == '\r'; // handle windows line endings
+            return true; // we read a full row
         }
         
-        if (!right.empty() || !row.empty()) {
-            row.push_back(std::move(right)); // make sure to capture the last column
+        if (!data) {
+            row.clear();
+            return false; // nothing left to read
+        }
+        SplitRow(RowBuffer.data(), RowBuffer.data() + RowBuffer.size(), row); // the last row has no line ending
+        return true;
+    }
+
+    // moves past the next row without splitting it, returns false at the end
+    bool SkipRow() {
+        bool quotes = false;
+        bool data = false;
+        SkipPendingLineFeed();
+
+        while (Cursor != Limit || Refill()) {
+            data = true;
+            const char *end = DSVScanner::FindRowEnd(Cursor, Limit, quotes);
+            if (end != Limit) {
+                Cursor = end + 1;
+                PendingLineFeed = *end == '\r';
+                return true;
+            }
+            Cursor = Limit;
         }
-        return data; // return whether we read any data at all
+        return data;
+    }
+
+    // repositions the source at the indexed row before row and skips forward
+    // to it, the buffered block is dropped since it belongs to the old position,
+    // when the row is not indexed or the source cannot seek neither the source
+    // nor the block has moved so reading carries on from the current row
+    bool SeekRow(const CDSVRowIndex &index, std::size_t row) {
+        uint64_t offset;
+        std::size_t skip;
+        if (!index.Locate(row, offset, skip) || !Source->Seek(offset)) {
+            return false;
+        }
+        Cursor = nullptr;
+        Limit = nullptr;
+        PendingLineFeed = false;
+        while (skip--) {
+            if (!SkipRow()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // copies the row views into strings, reusing the strings already in row
+    bool ReadRow(std::vector<std::string> &row) {
+        if (!ReadRowView(Views)) {
+            row.clear();
+            return false;
+        }
+        row.resize(Views.size());
+        for (std::size_t index = 0; index < Views.size(); index++) {
+            row[index].assign(Views[index].data(), Views[index].size());
+        }
+        return true;
     }
 };
 
@@ -71,10 +162,22 @@ CDSVReader::~CDSVReader() = default;
 
 // checks if all data has been read
 bool CDSVReader::End() const {
-    return DImplementation->Source->End();
+    return DImplementation->End();
 }
 
 // tries to read a row into the provided vector, each element represents a column
 bool CDSVReader::ReadRow(std::vector<std::string> &row) {
     return DImplementation->ReadRow(row);
 }
+
+// like ReadRow but without copying, the views point into the reader's buffers
+// and stay valid until the next call on the reader
+bool CDSVReader::ReadRowView(std::vector<std::string_view> &row) {
+    return DImplementation->ReadRowView(row);
+}
+
+// positions the reader so the next row read is row, the index must have been
+// built from the same data, fails when the source cannot seek
+bool CDSVReader::SeekRow(const CDSVRowIndex &index, std::size_t row) {
+    return DImplementation->SeekRow(index, row);
+}
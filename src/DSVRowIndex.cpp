@@ -0,0 +1,221 @@
+#include "DSVRowIndex.h"
+#include "DSVScanner.h"
+#include "PrefetchDataSource.h"
+#include <algorithm>
+#include <cstring>
+#include <zlib.h>
+
+namespace{
+
+const char SidecarMagic[4] = {'D', 'S', 'V', 'I'};
+const uint8_t SidecarVersion = 1;
+const std::size_t BlockSize = 65536;
+
+void PutVarint(std::vector<char> &out, uint64_t value){
+    while(value >= 0x80){
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool GetVarint(const char *&cursor, const char *end, uint64_t &value){
+    value = 0;
+    for(int Shift = 0; Shift < 64 && cursor != end; Shift += 7){
+        uint8_t Byte = static_cast<uint8_t>(*cursor++);
+        value |= static_cast<uint64_t>(Byte & 0x7F) << Shift;
+        if(!(Byte & 0x80)){
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+CDSVRowIndex::CDSVRowIndex(std::size_t interval) : DInterval(std::max<std::size_t>(interval, 1)), DRowCount(0){
+
+}
+
+// scans the whole source once, a row ends at every unquoted CR, LF or CRLF
+// and a final row without a line ending still counts
+bool CDSVRowIndex::Build(std::shared_ptr< CDataSource > src){
+    DRowCount = 0;
+    DOffsets.clear();
+    if(!src){
+        return false;
+    }
+    if(src->Blocking()){
+        src = std::make_shared<CPrefetchDataSource>(src);
+    }
+    std::vector<char> Buffer;
+    uint64_t Base = 0; // offset of the current block
+    bool InQuotes = false;
+    bool AfterCR = false; // the previous block ended with a row ending CR
+    bool Partial = false; // bytes seen since the last row ended
+    DOffsets.push_back(0);
+    while(true){
+        const char *Begin = nullptr;
+        std::size_t Length = src->Borrow(Begin, BlockSize);
+        if(!Length){
+            Buffer.resize(BlockSize);
+            Length = src->ReadBlock(Buffer.data(), Buffer.size());
+            Begin = Buffer.data();
+        }
+        if(!Length){
+            break;
+        }
+        const char *End = Begin + Length;
+        const char *Cursor = Begin;
+        if(AfterCR){
+            AfterCR = false;
+            if(*Cursor == '\n'){
+                Cursor++;
+                // the row start recorded at the CR moves past the LF
+                if(DRowCount % DInterval == 0 && DOffsets.back() == Base){
+                    DOffsets.back()++;
+                }
+            }
+        }
+        while(Cursor != End){
+            const char *RowEnd = DSVScanner::FindRowEnd(Cursor, End, InQuotes);
+            if(RowEnd == End){
+                Partial = true;
+                break;
+            }
+            DRowCount++;
+            Partial = false;
+            Cursor = RowEnd + 1;
+            if(*RowEnd == '\r'){
+                if(Cursor == End){
+                    AfterCR = true;
+                }
+                else if(*Cursor == '\n'){
+                    Cursor++;
+                }
+            }
+            if(DRowCount % DInterval == 0){
+                DOffsets.push_back(Base + (Cursor - Begin));
+            }
+        }
+        Base += Length;
+    }
+    if(Partial){
+        DRowCount++;
+    }
+    // drop an entry recorded for a row that never started
+    while(!DOffsets.empty() && (DOffsets.size() - 1) * DInterval >= DRowCount){
+        DOffsets.pop_back();
+    }
+    return true;
+}
+
+// the sidecar is the magic, a version byte, varints for the interval, row
+// count and entry count, the offsets as varint deltas and a crc32 of it all
+bool CDSVRowIndex::Save(std::shared_ptr< CDataSink > sink) const{
+    if(!sink){
+        return false;
+    }
+    std::vector<char> Output(SidecarMagic, SidecarMagic + sizeof(SidecarMagic));
+    Output.push_back(static_cast<char>(SidecarVersion));
+    PutVarint(Output, DInterval);
+    PutVarint(Output, DRowCount);
+    PutVarint(Output, DOffsets.size());
+    uint64_t Previous = 0;
+    for(auto Offset : DOffsets){
+        PutVarint(Output, Offset - Previous);
+        Previous = Offset;
+    }
+    uint32_t Checksum = crc32(0L, reinterpret_cast<const Bytef *>(Output.data()), Output.size());
+    for(int Index = 0; Index < 4; Index++){
+        Output.push_back(static_cast<char>(Checksum >> (Index * 8)));
+    }
+    return sink->Write(Output) && sink->Flush();
+}
+
+// replaces the index with the sidecar read from src, the index is left
+// unchanged when the sidecar is truncated, corrupt or of another version
+bool CDSVRowIndex::Load(std::shared_ptr< CDataSource > src){
+    if(!src){
+        return false;
+    }
+    std::vector<char> Input;
+    while(true){
+        std::size_t Used = Input.size();
+        Input.resize(Used + BlockSize);
+        std::size_t Length = src->ReadBlock(Input.data() + Used, BlockSize);
+        Input.resize(Used + Length);
+        if(!Length){
+            break;
+        }
+    }
+    if(Input.size() < sizeof(SidecarMagic) + 1 + 4 || std::memcmp(Input.data(), SidecarMagic, sizeof(SidecarMagic))){
+        return false;
+    }
+    const char *Cursor = Input.data() + sizeof(SidecarMagic);
+    const char *End = Input.data() + Input.size() - 4;
+    uint32_t Stored = 0;
+    for(int Index = 0; Index < 4; Index++){
+        Stored |= static_cast<uint32_t>(static_cast<uint8_t>(End[Index])) << (Index * 8);
+    }
+    if(crc32(0L, reinterpret_cast<const Bytef *>(Input.data()), End - Input.data()) != Stored){
+        return false;
+    }
+    if(static_cast<uint8_t>(*Cursor++) != SidecarVersion){
+        return false;
+    }
+    uint64_t Interval, RowCount, EntryCount;
+    if(!GetVarint(Cursor, End, Interval) || !GetVarint(Cursor, End, RowCount) || !GetVarint(Cursor, End, EntryCount)){
+        return false;
+    }
+    // every entry takes at least a byte, this also rejects absurd counts
+    if(!Interval || EntryCount > static_cast<uint64_t>(End - Cursor) || EntryCount != (RowCount + Interval - 1) / Interval){
+        return false;
+    }
+    std::vector<uint64_t> Offsets;
+    Offsets.reserve(EntryCount);
+    uint64_t Offset = 0;
+    for(uint64_t Index = 0; Index < EntryCount; Index++){
+        uint64_t Delta;
+        if(!GetVarint(Cursor, End, Delta)){
+            return false;
+        }
+        Offset += Delta;
+        Offsets.push_back(Offset);
+    }
+    if(Cursor != End){
+        return false;
+    }
+    DInterval = Interval;
+    DRowCount = RowCount;
+    DOffsets = std::move(Offsets);
+    return true;
+}
+
+std::size_t CDSVRowIndex::Interval() const noexcept{
+    return DInterval;
+}
+
+std::size_t CDSVRowIndex::RowCount() const noexcept{
+    return DRowCount;
+}
+
+std::size_t CDSVRowIndex::EntryCount() const noexcept{
+    return DOffsets.size();
+}
+
+// returns the byte offset of row entry * Interval()
+uint64_t CDSVRowIndex::Offset(std::size_t entry) const noexcept{
+    return entry < DOffsets.size() ? DOffsets[entry] : 0;
+}
+
+// finds the closest indexed row at or before row, offset is where it starts
+// and skip is the number of rows to read past to reach row
+bool CDSVRowIndex::Locate(std::size_t row, uint64_t &offset, std::size_t &skip) const noexcept{
+    if(row >= DRowCount){
+        return false;
+    }
+    offset = DOffsets[row / DInterval];
+    skip = row % DInterval;
+    return true;
+}
@@ -0,0 +1,235 @@
+#include "DSVScanner.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DSVSCANNER_X86
+#endif
+
+namespace DSVScanner{
+
+namespace{
+
+// reference classifier, used for tails and on targets without SSE2
+SMasks ClassifyScalar(const char *data, std::size_t length, char delimiter) noexcept{
+    SMasks Masks{0, 0, 0};
+    for(std::size_t Index = 0; Index < length; Index++){
+        uint64_t Bit = uint64_t(1) << Index;
+        char Ch = data[Index];
+        if(Ch == '"'){
+            Masks.DQuotes |= Bit;
+        }
+        if(Ch == delimiter){
+            Masks.DDelimiters |= Bit;
+        }
+        if(Ch == '\n' || Ch == '\r'){
+            Masks.DNewlines |= Bit;
+        }
+    }
+    return Masks;
+}
+
+#ifdef DSVSCANNER_X86
+SMasks ClassifySSE2(const char *data, char delimiter) noexcept{
+    const __m128i Quote = _mm_set1_epi8('"');
+    const __m128i Delimiter = _mm_set1_epi8(delimiter);
+    const __m128i LineFeed = _mm_set1_epi8('\n');
+    const __m128i CarriageReturn = _mm_set1_epi8('\r');
+    SMasks Masks{0, 0, 0};
+    for(int Offset = 0; Offset < 64; Offset += 16){
+        __m128i Chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + Offset));
+        Masks.DQuotes |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(Chunk, Quote)))) << Offset;
+        Masks.DDelimiters |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(Chunk, Delimiter)))) << Offset;
+        __m128i Newlines = _mm_or_si128(_mm_cmpeq_epi8(Chunk, LineFeed), _mm_cmpeq_epi8(Chunk, CarriageReturn));
+        Masks.DNewlines |= uint64_t(uint16_t(_mm_movemask_epi8(Newlines))) << Offset;
+    }
+    return Masks;
+}
+
+__attribute__((target("avx2"))) SMasks ClassifyAVX2(const char *data, char delimiter) noexcept{
+    const __m256i Quote = _mm256_set1_epi8('"');
+    const __m256i Delimiter = _mm256_set1_epi8(delimiter);
+    const __m256i LineFeed = _mm256_set1_epi8('\n');
+    const __m256i CarriageReturn = _mm256_set1_epi8('\r');
+    SMasks Masks{0, 0, 0};
+    for(int Offset = 0; Offset < 64; Offset += 32){
+        __m256i Chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + Offset));
+        Masks.DQuotes |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(Chunk, Quote)))) << Offset;
+        Masks.DDelimiters |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(Chunk, Delimiter)))) << Offset;
+        __m256i Newlines = _mm256_or_si256(_mm256_cmpeq_epi8(Chunk, LineFeed), _mm256_cmpeq_epi8(Chunk, CarriageReturn));
+        Masks.DNewlines |= uint64_t(uint32_t(_mm256_movemask_epi8(Newlines))) << Offset;
+    }
+    return Masks;
+}
+
+using TClassifyFunction = SMasks (*)(const char *, char) noexcept;
+
+// picks the widest classifier the running CPU supports
+TClassifyFunction SelectClassifier() noexcept{
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        return ClassifyAVX2;
+    }
+    return ClassifySSE2;
+}
+
+const TClassifyFunction ClassifyBlock = SelectClassifier();
+#endif
+
+}
+
+// classifies up to 64 bytes, bit i of each mask describes data[i]
+SMasks Classify(const char *data, std::size_t length, char delimiter) noexcept{
+#ifdef DSVSCANNER_X86
+    if(length >= 64){
+        return ClassifyBlock(data, delimiter);
+    }
+    if(length >= 16){
+        // pad short blocks so the vector path can still be used, padding
+        // bits are cleared afterwards in case the delimiter is NUL
+        alignas(64) char Block[64] = {0};
+        std::memcpy(Block, data, length);
+        SMasks Masks = ClassifyBlock(Block, delimiter);
+        uint64_t Valid = (uint64_t(1) << length) - 1;
+        Masks.DQuotes &= Valid;
+        Masks.DDelimiters &= Valid;
+        Masks.DNewlines &= Valid;
+        return Masks;
+    }
+#endif
+    return ClassifyScalar(data, length < 64 ? length : 64, delimiter);
+}
+
+// bit i of the result is the parity of the set bits at positions 0 to i, for
+// a quote mask that is whether position i is inside quotes
+uint64_t PrefixXor(uint64_t mask) noexcept{
+    mask ^= mask << 1;
+    mask ^= mask << 2;
+    mask ^= mask << 4;
+    mask ^= mask << 8;
+    mask ^= mask << 16;
+    mask ^= mask << 32;
+    return mask;
+}
+
+// returns the first CR or LF outside of quotes in the range, or end if there
+// is none, inquotes carries the quote state in and out of the range
+const char *FindRowEnd(const char *begin, const char *end, bool &inquotes) noexcept{
+    while(begin < end){
+        std::size_t Length = end - begin < 64 ? end - begin : 64;
+        SMasks Masks = Classify(begin, Length, '\n');
+        uint64_t Inside = PrefixXor(Masks.DQuotes) ^ (inquotes ? ~uint64_t(0) : 0);
+        uint64_t Ends = Masks.DNewlines & ~Inside;
+        if(Ends){
+            inquotes = false;
+            return begin + __builtin_ctzll(Ends);
+        }
+        inquotes ^= __builtin_popcountll(Masks.DQuotes) & 1;
+        begin += Length;
+    }
+    return end;
+}
+
+// finds the delimiters outside of quotes in a single row, ends receives the
+// offset one past each field, returns true if the row contains any quotes
+bool SplitFields(const char *begin, const char *end, char delimiter, std::vector< std::size_t > &ends){
+    ends.clear();
+    bool InQuotes = false;
+    bool Quoted = false;
+    for(const char *Block = begin; Block < end; Block += 64){
+        std::size_t Length = end - Block < 64 ? end - Block : 64;
+        SMasks Masks = Classify(Block, Length, delimiter);
+        uint64_t Inside = PrefixXor(Masks.DQuotes) ^ (InQuotes ? ~uint64_t(0) : 0);
+        uint64_t Fields = Masks.DDelimiters & ~Inside;
+        while(Fields){
+            ends.push_back(Block - begin + __builtin_ctzll(Fields));
+            Fields &= Fields - 1;
+        }
+        InQuotes ^= __builtin_popcountll(Masks.DQuotes) & 1;
+        Quoted |= Masks.DQuotes != 0;
+    }
+    ends.push_back(end - begin);
+    return Quoted;
+}
+
+// appends a field to out removing its quotes, each run of n quotes leaves n / 2
+// literal quotes behind which is how paired quotes and quote toggles combine
+void Unquote(const char *begin, const char *end, std::string &out){
+    while(begin < end){
+        const char *Quote = static_cast<const char *>(std::memchr(begin, '"', end - begin));
+        if(!Quote){
+            out.append(begin, end - begin);
+            break;
+        }
+        out.append(begin, Quote - begin);
+        const char *Run = Quote;
+        while(Run < end && *Run == '"'){
+            Run++;
+        }
+        out.append((Run - Quote) / 2, '"');
+        begin = Run;
+    }
+}
+
+// fills row with views of the fields of the contiguous row text in
+// [begin, end), only fields that need quotes removed are copied, they are
+// appended to unquoted which must have room reserved for the whole row so
+// earlier views never move, a blank line gives an empty row, a nonzero
+// reserve is reserved in unquoted before the first copy into it instead
+void SplitRow(const char *begin, const char *end, char delimiter, std::vector< std::size_t > &ends, std::string &unquoted, std::vector< std::string_view > &row, std::size_t reserve){
+    bool Quoted = SplitFields(begin, end, delimiter, ends);
+    row.resize(ends.size());
+    std::size_t Start = 0;
+    for(std::size_t Index = 0; Index < ends.size(); Index++){
+        const char *Field = begin + Start;
+        std::size_t Length = ends[Index] - Start;
+        if(Quoted && std::memchr(Field, '"', Length)){
+            if(Length >= 3 && Field[0] == '"' && Field[Length - 1] == '"' && !std::memchr(Field + 1, '"', Length - 2)){
+                row[Index] = std::string_view(Field + 1, Length - 2);
+            }
+            else{
+                if(unquoted.empty() && unquoted.capacity() < reserve){
+                    unquoted.reserve(reserve);
+                }
+                std::size_t Offset = unquoted.size();
+                Unquote(Field, Field + Length, unquoted);
+                row[Index] = std::string_view(unquoted.data() + Offset, unquoted.size() - Offset);
+            }
+        }
+        else{
+            row[Index] = std::string_view(Field, Length);
+        }
+        Start = ends[Index] + 1;
+    }
+    if(row.size() == 1 && row[0].empty()){
+        row.clear();
+    }
+}
+
+// returns true if the range holds an odd number of quotes, which means the
+// quote state flips across it
+bool QuoteParity(const char *begin, const char *end) noexcept{
+    bool Parity = false;
+    while(begin < end){
+        std::size_t Length = end - begin < 64 ? end - begin : 64;
+        Parity ^= __builtin_popcountll(Classify(begin, Length, '"').DQuotes) & 1;
+        begin += Length;
+    }
+    return Parity;
+}
+
+// returns true if a field holds a quote, the delimiter or a line ending, any
+// of which means it has to be quoted to read back as a single field
+bool NeedsQuotes(const char *begin, const char *end, char delimiter) noexcept{
+    while(begin < end){
+        std::size_t Length = end - begin < 64 ? end - begin : 64;
+        SMasks Masks = Classify(begin, Length, delimiter);
+        if(Masks.DQuotes | Masks.DDelimiters | Masks.DNewlines){
+            return true;
+        }
+        begin += Length;
+    }
+    return false;
+}
+
+}
@@ -1,71 +1,217 @@
 #include "DSVWriter.h"
 #include "DataSink.h"
+#include "DSVScanner.h"
+#include <charconv>
+#include <cstring>
 
 // implementation structure for CDSVWriter, which handles writing to a data sink
 struct CDSVWriter::SImplementation {
+    static const std::size_t BatchSize = 65536; // buffered bytes that trigger a write to the sink
+    static const std::size_t MaxNumberLength = 32; // room for any formatted int64_t, uint64_t or double
+
     std::shared_ptr<CDataSink> Sink; // data sink for writing
     char Delimiter; // character used as delimiter
     bool QuoteAll; // determines if all fields should be quoted
+    std::vector<char> Buffer; // rows waiting to be written to the sink
+    bool FirstField; // no field has been added to the row being built
 
     // constructor for SImplementation, initializes the data sink, delimiter, and quote
     SImplementation(std::shared_ptr<CDataSink> sink, char delimiter, bool quoteall)
-        : Sink(sink), Delimiter(delimiter), QuoteAll(quoteall) {}
+        : Sink(sink), Delimiter(delimiter), QuoteAll(quoteall), FirstField(true) {
+        Buffer.reserve(BatchSize);
+    }
+
+    // unwritten rows are pushed out when the writer goes away
+    ~SImplementation() {
+        Flush();
+    }
+
+    void Append(const char *data, std::size_t length) {
+        Buffer.insert(Buffer.end(), data, data + length);
+    }
+
+    void BeginRow() {
+        FirstField = true;
+    }
+
+    // adds the delimiter between fields, but not before the first field
+    void BeginField() {
+        if (!FirstField) {
+            Buffer.push_back(Delimiter);
+        }
+        FirstField = false;
+    }
+
+    void AppendField(std::string_view field) {
+        BeginField();
+        AppendText(field);
+    }
 
-    // writes a row of data to the sink
+    // appends field text, it is quoted if requested or if it holds the
+    // delimiter, a double quote, or a line ending, which one scan decides
+    void AppendText(std::string_view field) {
+        const char *begin = field.data();
+        const char *end = begin + field.size();
+        if (!QuoteAll && !DSVScanner::NeedsQuotes(begin, end, Delimiter)) {
+            Append(begin, field.size());
+            return;
+        }
+        // start quoted field
+        Buffer.push_back('"');
+        // copy the runs between quotes in bulk, escaping each quote by doubling it
+        while (const char *quote = static_cast<const char *>(std::memchr(begin, '"', end - begin))) {
+            Append(begin, quote + 1 - begin);
+            Buffer.push_back('"');
+            begin = quote + 1;
+        }
+        Append(begin, end - begin);
+        // end quoted field
+        Buffer.push_back('"');
+    }
+
+    // formats a number in place at the end of the buffer, doubles use the
+    // shortest text that reads back to the same value
+    template <typename TValue> void AppendNumber(TValue value) {
+        BeginField();
+        // the text goes one byte in so an opening quote fits in front of it
+        std::size_t start = Buffer.size();
+        Buffer.resize(start + 1 + MaxNumberLength);
+        char *text = Buffer.data() + start + 1;
+        auto result = std::to_chars(text, Buffer.data() + Buffer.size(), value);
+        std::size_t length = result.ptr - text;
+        // numbers only need quotes when asked for or when the delimiter is a
+        // character that appears in them, they never hold quotes or newlines
+        // so the text needs no escaping
+        if (QuoteAll || std::memchr(text, Delimiter, length)) {
+            Buffer[start] = '"';
+            Buffer.resize(start + 1 + length);
+            Buffer.push_back('"');
+        } else {
+            std::memmove(Buffer.data() + start, text, length);
+            Buffer.resize(start + length);
+        }
+    }
+
+    // ends the row with a newline character, the buffer goes to the sink
+    // once a batch has built up
+    bool EndRow() {
+        Buffer.push_back('\n');
+        if (!Sink) {
+            Buffer.clear();
+            return false;
+        }
+        return Buffer.size() < BatchSize || WriteBuffer();
+    }
+
+    // writes a row of data to the buffer, an empty row is only a newline
     bool WriteRow(const std::vector<std::string>& row) {
-        // sink is valid
-        if (!Sink) return false; 
-        // write only a newline for an empty row
-        if (row.empty()) {
-            return Sink->Put('\n');
+        BeginRow();
+        for (const auto &field : row) {
+            AppendField(field);
         }
-        // iterate over each field in the row
-        for (size_t i = 0; i < row.size(); ++i) {
-            bool quote = QuoteAll || row[i].find(Delimiter) != std::string::npos ||
-                              row[i].find('"') != std::string::npos || row[i].find('\n') != std::string::npos;
-            
-            if (quote) {
-                // start quoted field
-                if (!Sink->Put('"')) return false; 
-                // iterate over each character in the field
-                for (char c : row[i]) {
-                    if (c == '"') {
-                        // escape double quotes by doubling them
-                        if (!Sink->Put('"') || !Sink->Put('"')) return false;
-                    } else {
-                        // write the character as is
-                        if (!Sink->Put(c)) return false;
-                    }
-                }
-                // end quoted field
-                if (!Sink->Put('"')) return false; 
-            // if no quoting is needed, write the field character by character
-            } else {
-                for (char c : row[i]) {
-                    if (!Sink->Put(c)) return false;
+        return EndRow();
+    }
+
+    // writes one row per index, columns of different lengths are rejected
+    // before anything is written
+    bool WriteColumns(const std::vector<SColumn> &columns) {
+        if (columns.empty()) {
+            return true;
+        }
+        std::size_t rows = columns[0].DSize;
+        for (const auto &column : columns) {
+            if (column.DSize != rows) {
+                return false;
+            }
+        }
+        for (std::size_t row = 0; row < rows; row++) {
+            BeginRow();
+            for (const auto &column : columns) {
+                switch (column.DType) {
+                    case SColumn::EType::Int64: AppendNumber(static_cast<const int64_t *>(column.DData)[row]); break;
+                    case SColumn::EType::UInt64: AppendNumber(static_cast<const uint64_t *>(column.DData)[row]); break;
+                    case SColumn::EType::Double: AppendNumber(static_cast<const double *>(column.DData)[row]); break;
+                    case SColumn::EType::String: AppendField(static_cast<const std::string *>(column.DData)[row]); break;
+                    case SColumn::EType::StringView: AppendField(static_cast<const std::string_view *>(column.DData)[row]); break;
                 }
             }
-            // add delimiter between fields, but not after the last field
-            if (i < row.size() - 1) {
-                if (!Sink->Put(Delimiter)) return false; 
+            if (!EndRow()) {
+                return false;
             }
         }
-        // end the row with a newline character
-        return Sink->Put('\n'); 
+        return true;
+    }
+
+    // hands the buffered rows to the sink in a single write, the rows stay
+    // buffered if the write fails so a later flush can retry them
+    bool WriteBuffer() {
+        if (Buffer.empty()) {
+            return true;
+        }
+        if (!Sink->Write(Buffer)) {
+            return false;
+        }
+        Buffer.clear();
+        return true;
+    }
+
+    bool Flush() {
+        if (!Sink) return false;
+        bool success = WriteBuffer();
+        return Sink->Flush() && success;
     }
 };
 // constructor for DSV writer, sink specifies the data destination, delimiter
 // specifies the delimiting character, and quoteall specifies if all values
 // should be quoted or only those that contain the delimiter, a double quote,
-// or a newline
+// or a line ending
 CDSVWriter::CDSVWriter(std::shared_ptr<CDataSink> sink, char delimiter, bool quoteall)
     : DImplementation(std::make_unique<SImplementation>(sink, delimiter, quoteall)) {}
 
-// destructor for CDSVWriter
+// destructor for CDSVWriter, flushes any rows still buffered
 CDSVWriter::~CDSVWriter() = default;
 
 // returns true if the row is successfully written, one string per column
-// should be put in the row vector
+// should be put in the row vector, rows are buffered and reach the sink in
+// batches, a false return means a batch could not be written, its rows stay
+// buffered for the next flush
 bool CDSVWriter::WriteRow(const std::vector<std::string>& row) {
     return DImplementation->WriteRow(row);
 }
+
+// writes any buffered rows to the sink and flushes the sink, returns false if
+// either fails
+bool CDSVWriter::Flush() {
+    return DImplementation->Flush();
+}
+
+// writes one row per array index, fields come from the columns in order,
+// returns false without writing anything if the columns differ in length
+bool CDSVWriter::WriteColumns(const std::vector<SColumn> &columns) {
+    return DImplementation->WriteColumns(columns);
+}
+
+// typed field building used by WriteFields
+void CDSVWriter::BeginRow() {
+    DImplementation->BeginRow();
+}
+
+void CDSVWriter::AppendField(std::string_view field) {
+    DImplementation->AppendField(field);
+}
+
+void CDSVWriter::AppendField(int64_t value) {
+    DImplementation->AppendNumber(value);
+}
+
+void CDSVWriter::AppendField(uint64_t value) {
+    DImplementation->AppendNumber(value);
+}
+
+void CDSVWriter::AppendField(double value) {
+    DImplementation->AppendNumber(value);
+}
+
+bool CDSVWriter::EndRow() {
+    return DImplementation->EndRow();
+}
@@ -0,0 +1,174 @@
+#include "FileDataSink.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace{
+    // O_DIRECT requires block aligned buffers, lengths and file offsets
+    const std::size_t BlockAlignment = 4096;
+}
+
+// opens (truncating) the file, the buffer is rounded up to whole blocks, when
+// direct is requested but not supported by the file system the sink silently
+// falls back to regular buffered writes
+CFileDataSink::CFileDataSink(const std::string &filename, std::size_t buffersize, bool direct, ESyncPolicy sync)
+    : DFileDescriptor(-1), DBuffer(nullptr), DCapacity(0), DLength(0), DDirect(false), DSyncPolicy(sync){
+    std::size_t Capacity = std::max(buffersize, BlockAlignment);
+    Capacity = (Capacity + BlockAlignment - 1) / BlockAlignment * BlockAlignment;
+    void *Memory = nullptr;
+    if(posix_memalign(&Memory, BlockAlignment, Capacity)){
+        return;
+    }
+    DBuffer = static_cast<char *>(Memory);
+    DCapacity = Capacity;
+
+    int Flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+#ifdef O_DIRECT
+    if(direct){
+        DFileDescriptor = open(filename.c_str(), Flags | O_DIRECT, 0644);
+        DDirect = DFileDescriptor >= 0;
+    }
+#endif
+    if(DFileDescriptor < 0){
+        DFileDescriptor = open(filename.c_str(), Flags, 0644);
+    }
+}
+
+CFileDataSink::~CFileDataSink(){
+    Close();
+    free(DBuffer);
+}
+
+bool CFileDataSink::IsOpen() const noexcept{
+    return DFileDescriptor >= 0;
+}
+
+// writes as much of data as it can, retrying on partial writes and
+// interrupts, returns the number of bytes that reached the file
+std::size_t CFileDataSink::WriteAll(const char *data, std::size_t length) noexcept{
+    std::size_t Total = 0;
+    while(Total < length){
+        ssize_t Written = write(DFileDescriptor, data + Total, length - Total);
+        if(Written < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            break;
+        }
+        Total += Written;
+    }
+    return Total;
+}
+
+// empties the buffer to the file with as few write calls as possible, under
+// O_DIRECT only whole blocks are written unless final is set, bytes that reach
+// the file are dropped from the buffer so a retry never writes them twice
+bool CFileDataSink::FlushBuffer(bool final) noexcept{
+    if(!DLength){
+        return true;
+    }
+    std::size_t Aligned = DDirect ? DLength / BlockAlignment * BlockAlignment : DLength;
+    if(Aligned){
+        std::size_t Written = WriteAll(DBuffer, Aligned);
+        DLength -= Written;
+        std::memmove(DBuffer, DBuffer + Written, DLength);
+        if(Written != Aligned){
+            return false;
+        }
+    }
+#ifdef O_DIRECT
+    if(final && DLength){
+        // an unaligned tail cannot go through O_DIRECT, it is written buffered
+        // and then kept, the offset goes back to the start of its block so the
+        // next direct write rewrites the block with the tail in it
+        int Flags = fcntl(DFileDescriptor, F_GETFL);
+        if(Flags < 0 || fcntl(DFileDescriptor, F_SETFL, Flags & ~O_DIRECT) < 0){
+            return false;
+        }
+        std::size_t Written = WriteAll(DBuffer, DLength);
+        bool Rewound = lseek(DFileDescriptor, -static_cast<off_t>(Written), SEEK_CUR) >= 0;
+        if(fcntl(DFileDescriptor, F_SETFL, Flags) < 0){
+            // stay in buffered mode, the kept tail is still in the right place
+            DDirect = false;
+            return false;
+        }
+        if(Written != DLength || !Rewound){
+            return false;
+        }
+    }
+#endif
+    if(DSyncPolicy == ESyncPolicy::EveryWrite){
+        return fdatasync(DFileDescriptor) == 0;
+    }
+    return true;
+}
+
+bool CFileDataSink::Put(const char &ch) noexcept{
+    if(DFileDescriptor < 0){
+        return false;
+    }
+    if(DLength == DCapacity && !FlushBuffer(false)){
+        return false;
+    }
+    DBuffer[DLength++] = ch;
+    return true;
+}
+
+// copies whole runs into the buffer, writes that are at least a buffer in
+// size skip the copy entirely unless O_DIRECT alignment has to be kept
+bool CFileDataSink::Write(const std::vector<char> &buf) noexcept{
+    if(DFileDescriptor < 0){
+        return false;
+    }
+    const char *Data = buf.data();
+    std::size_t Remaining = buf.size();
+    while(Remaining){
+        if(!DLength && !DDirect && Remaining >= DCapacity){
+            if(WriteAll(Data, Remaining) != Remaining){
+                return false;
+            }
+            if(DSyncPolicy == ESyncPolicy::EveryWrite){
+                return fdatasync(DFileDescriptor) == 0;
+            }
+            return true;
+        }
+        std::size_t Length = std::min(Remaining, DCapacity - DLength);
+        std::memcpy(DBuffer + DLength, Data, Length);
+        DLength += Length;
+        Data += Length;
+        Remaining -= Length;
+        if(DLength == DCapacity && !FlushBuffer(false)){
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CFileDataSink::Flush() noexcept{
+    if(DFileDescriptor < 0){
+        return false;
+    }
+    if(!FlushBuffer(true)){
+        return false;
+    }
+    if(DSyncPolicy == ESyncPolicy::OnFlush){
+        return fdatasync(DFileDescriptor) == 0;
+    }
+    return true;
+}
+
+// flushes and closes the file, further writes fail
+bool CFileDataSink::Close() noexcept{
+    if(DFileDescriptor < 0){
+        return false;
+    }
+    bool Result = Flush();
+    if(close(DFileDescriptor) != 0){
+        Result = false;
+    }
+    DFileDescriptor = -1;
+    return Result;
+}
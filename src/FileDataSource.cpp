@@ -0,0 +1,127 @@
+#include "FileDataSource.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+// opens the file for streaming reads, a file that cannot be opened behaves as
+// an empty source and IsOpen() returns false
+CFileDataSource::CFileDataSource(const std::string &filename, std::size_t buffersize)
+    : DFileDescriptor(-1), DBuffer(std::max<std::size_t>(buffersize, 1)), DIndex(0), DLength(0), DEnd(false){
+    DFileDescriptor = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if(DFileDescriptor >= 0){
+        posix_fadvise(DFileDescriptor, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    Fill();
+}
+
+CFileDataSource::~CFileDataSource(){
+    if(DFileDescriptor >= 0){
+        close(DFileDescriptor);
+    }
+}
+
+// refills the buffer once it has been consumed, the buffer is kept non-empty
+// until the end of the file so End() never has to touch the file
+bool CFileDataSource::Fill() noexcept{
+    DIndex = 0;
+    DLength = 0;
+    while(!DEnd){
+        if(DFileDescriptor < 0){
+            DEnd = true;
+            break;
+        }
+        ssize_t Length = read(DFileDescriptor, DBuffer.data(), DBuffer.size());
+        if(Length < 0 && errno == EINTR){
+            continue;
+        }
+        if(Length <= 0){
+            DEnd = true;
+            break;
+        }
+        DLength = Length;
+        return true;
+    }
+    return false;
+}
+
+bool CFileDataSource::IsOpen() const noexcept{
+    return DFileDescriptor >= 0;
+}
+
+bool CFileDataSource::End() const noexcept{
+    return DIndex >= DLength;
+}
+
+bool CFileDataSource::Get(char &ch) noexcept{
+    if(DIndex >= DLength){
+        return false;
+    }
+    ch = DBuffer[DIndex++];
+    if(DIndex == DLength){
+        Fill();
+    }
+    return true;
+}
+
+bool CFileDataSource::Peek(char &ch) noexcept{
+    if(DIndex >= DLength){
+        return false;
+    }
+    ch = DBuffer[DIndex];
+    return true;
+}
+
+bool CFileDataSource::Read(std::vector<char> &buf, std::size_t count) noexcept{
+    buf.resize(count);
+    buf.resize(ReadBlock(buf.data(), count));
+    return !buf.empty();
+}
+
+// drains the buffer and then reads large requests straight into buf
+std::size_t CFileDataSource::ReadBlock(char *buf, std::size_t count) noexcept{
+    std::size_t Total = 0;
+    while(Total < count && DIndex < DLength){
+        std::size_t Length = std::min(count - Total, DLength - DIndex);
+        std::memcpy(buf + Total, DBuffer.data() + DIndex, Length);
+        DIndex += Length;
+        Total += Length;
+        if(DIndex < DLength){
+            break;
+        }
+        if(count - Total >= DBuffer.size()){
+            // bypass the buffer for the bulk of a large request
+            while(Total < count && !DEnd){
+                ssize_t Received = read(DFileDescriptor, buf + Total, count - Total);
+                if(Received < 0 && errno == EINTR){
+                    continue;
+                }
+                if(Received <= 0){
+                    DEnd = true;
+                    break;
+                }
+                Total += Received;
+                if(count - Total < DBuffer.size()){
+                    break;
+                }
+            }
+        }
+        Fill();
+    }
+    return Total;
+}
+
+bool CFileDataSource::Blocking() const noexcept{
+    return true;
+}
+
+// moves the file position and refills the buffer from there
+bool CFileDataSource::Seek(std::size_t offset) noexcept{
+    if(DFileDescriptor < 0 || lseek(DFileDescriptor, offset, SEEK_SET) < 0){
+        return false;
+    }
+    DEnd = false;
+    Fill();
+    return true;
+}
@@ -0,0 +1,120 @@
+#define ZLIB_CONST
+#include "GzipDataSink.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cstring>
+
+// deflates everything written into a single gzip member on the wrapped sink
+struct CGzipDataSink::SImplementation{
+    std::shared_ptr<CDataSink> Sink;
+    z_stream Stream;
+    std::vector<char> Input; // small writes are collected here before deflating
+    std::size_t InputLength;
+    std::vector<char> Output;
+    std::size_t OutputSize;
+    bool Open;
+
+    SImplementation(std::shared_ptr<CDataSink> sink, int level, std::size_t buffersize)
+        : Sink(std::move(sink)), Input(std::max<std::size_t>(buffersize, 1)), InputLength(0),
+          Output(std::max<std::size_t>(buffersize, 1)), OutputSize(Output.size()), Open(false){
+        std::memset(&Stream, 0, sizeof(Stream));
+        Open = Sink && deflateInit2(&Stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+
+    ~SImplementation(){
+        Close();
+    }
+
+    // runs the compressor over data, every full output block goes to the sink
+    bool Deflate(const char *data, std::size_t length, int flush){
+        Stream.next_in = reinterpret_cast<const Bytef *>(data);
+        Stream.avail_in = length;
+        do{
+            Stream.next_out = reinterpret_cast<Bytef *>(Output.data());
+            Stream.avail_out = OutputSize;
+            if(deflate(&Stream, flush) == Z_STREAM_ERROR){
+                return false;
+            }
+            std::size_t Produced = OutputSize - Stream.avail_out;
+            if(Produced){
+                Output.resize(Produced);
+                bool Written = Sink->Write(Output);
+                Output.resize(OutputSize);
+                if(!Written){
+                    return false;
+                }
+            }
+        }while(!Stream.avail_out);
+        return true;
+    }
+
+    bool DeflateInput(int flush){
+        std::size_t Length = InputLength;
+        InputLength = 0;
+        return Deflate(Input.data(), Length, flush);
+    }
+
+    bool Put(char ch){
+        if(!Open){
+            return false;
+        }
+        Input[InputLength++] = ch;
+        return InputLength < Input.size() || DeflateInput(Z_NO_FLUSH);
+    }
+
+    bool Write(const std::vector<char> &buf){
+        if(!Open){
+            return false;
+        }
+        if(InputLength && !DeflateInput(Z_NO_FLUSH)){
+            return false;
+        }
+        return Deflate(buf.data(), buf.size(), Z_NO_FLUSH);
+    }
+
+    bool Flush(){
+        if(!Open){
+            return false;
+        }
+        return DeflateInput(Z_SYNC_FLUSH) && Sink->Flush();
+    }
+
+    bool Close(){
+        if(!Open){
+            return false;
+        }
+        bool Result = DeflateInput(Z_FINISH);
+        deflateEnd(&Stream);
+        Open = false;
+        return Sink->Flush() && Result;
+    }
+};
+
+// compressed output goes to sink, level is the zlib compression level and
+// buffersize the size of the input and output blocks
+CGzipDataSink::CGzipDataSink(std::shared_ptr< CDataSink > sink, int level, std::size_t buffersize)
+    : DImplementation(std::make_unique<SImplementation>(std::move(sink), level, buffersize)){
+
+}
+
+// closing writes the gzip trailer if Close was not called
+CGzipDataSink::~CGzipDataSink() = default;
+
+// finishes the gzip member, further writes fail
+bool CGzipDataSink::Close() noexcept{
+    return DImplementation->Close();
+}
+
+bool CGzipDataSink::Put(const char &ch) noexcept{
+    return DImplementation->Put(ch);
+}
+
+bool CGzipDataSink::Write(const std::vector<char> &buf) noexcept{
+    return DImplementation->Write(buf);
+}
+
+// emits everything written so far as complete deflate blocks and flushes the
+// wrapped sink, the gzip member stays open
+bool CGzipDataSink::Flush() noexcept{
+    return DImplementation->Flush();
+}
@@ -0,0 +1,151 @@
+#define ZLIB_CONST
+#include "GzipDataSource.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cstring>
+
+// inflates the wrapped source one output block at a time, gzip and zlib
+// headers are detected automatically and concatenated gzip members are read
+// back to back like gunzip does
+struct CGzipDataSource::SImplementation{
+    std::shared_ptr<CDataSource> Source;
+    z_stream Stream;
+    std::vector<char> Input; // compressed block for sources that cannot lend theirs
+    std::vector<char> Output; // decompressed block being consumed
+    std::size_t Index;
+    std::size_t Length;
+    bool Finished; // compressed input exhausted or corrupt
+    bool Pending; // inside a member that has not reached its end yet
+    bool Failed;
+
+    SImplementation(std::shared_ptr<CDataSource> src, std::size_t buffersize)
+        : Source(std::move(src)), Input(std::max<std::size_t>(buffersize, 1)), Output(std::max<std::size_t>(buffersize, 1)),
+          Index(0), Length(0), Finished(false), Pending(false), Failed(false){
+        std::memset(&Stream, 0, sizeof(Stream));
+        if(inflateInit2(&Stream, 15 + 32) != Z_OK){
+            Finished = Failed = true;
+        }
+    }
+
+    ~SImplementation(){
+        inflateEnd(&Stream);
+    }
+
+    // points the decompressor at the next compressed block
+    bool FeedInput(){
+        const char *Data = nullptr;
+        std::size_t Count = Source->Borrow(Data, Input.size());
+        if(!Count){
+            Count = Source->ReadBlock(Input.data(), Input.size());
+            Data = Input.data();
+        }
+        Stream.next_in = reinterpret_cast<const Bytef *>(Data);
+        Stream.avail_in = Count;
+        return Count != 0;
+    }
+
+    // decompresses the next non-empty block, returns false at the end
+    bool Fill(){
+        Index = Length = 0;
+        while(!Finished && !Length){
+            if(!Stream.avail_in && !FeedInput()){
+                // running out of input inside a member means it was truncated
+                Failed = Pending;
+                Finished = true;
+                break;
+            }
+            Stream.next_out = reinterpret_cast<Bytef *>(Output.data());
+            Stream.avail_out = Output.size();
+            int Result = inflate(&Stream, Z_NO_FLUSH);
+            Length = Output.size() - Stream.avail_out;
+            if(Result == Z_STREAM_END){
+                Pending = false;
+                inflateReset(&Stream);
+            }
+            else if(Result == Z_OK || Result == Z_BUF_ERROR){
+                Pending = true;
+            }
+            else{
+                Finished = Failed = true;
+            }
+        }
+        return Length != 0;
+    }
+
+    bool Available(){
+        return Index < Length || Fill();
+    }
+
+    std::size_t ReadBlock(char *buf, std::size_t count){
+        std::size_t Total = 0;
+        while(Total < count && Available()){
+            std::size_t Count = std::min(count - Total, Length - Index);
+            std::memcpy(buf + Total, Output.data() + Index, Count);
+            Index += Count;
+            Total += Count;
+        }
+        return Total;
+    }
+};
+
+// src provides the compressed bytes, buffersize is the size of both the
+// compressed and the decompressed blocks
+CGzipDataSource::CGzipDataSource(std::shared_ptr< CDataSource > src, std::size_t buffersize)
+    : DImplementation(std::make_unique<SImplementation>(std::move(src), buffersize)){
+
+}
+
+CGzipDataSource::~CGzipDataSource() = default;
+
+// true if the compressed data was corrupt or truncated
+bool CGzipDataSource::Error() const noexcept{
+    return DImplementation->Failed;
+}
+
+// may decompress the next block to find out whether more data follows
+bool CGzipDataSource::End() const noexcept{
+    return !DImplementation->Available();
+}
+
+bool CGzipDataSource::Get(char &ch) noexcept{
+    if(!DImplementation->Available()){
+        return false;
+    }
+    ch = DImplementation->Output[DImplementation->Index++];
+    return true;
+}
+
+bool CGzipDataSource::Peek(char &ch) noexcept{
+    if(!DImplementation->Available()){
+        return false;
+    }
+    ch = DImplementation->Output[DImplementation->Index];
+    return true;
+}
+
+bool CGzipDataSource::Read(std::vector<char> &buf, std::size_t count) noexcept{
+    buf.resize(count);
+    buf.resize(DImplementation->ReadBlock(buf.data(), count));
+    return !buf.empty();
+}
+
+std::size_t CGzipDataSource::ReadBlock(char *buf, std::size_t count) noexcept{
+    return DImplementation->ReadBlock(buf, count);
+}
+
+// lends the rest of the decompressed block, it stays valid until the next
+// call on the source
+std::size_t CGzipDataSource::Borrow(const char *&data, std::size_t count) noexcept{
+    if(!DImplementation->Available()){
+        return 0;
+    }
+    std::size_t Count = std::min(count, DImplementation->Length - DImplementation->Index);
+    data = DImplementation->Output.data() + DImplementation->Index;
+    DImplementation->Index += Count;
+    return Count;
+}
+
+// decompression is worth moving off the parsing thread
+bool CGzipDataSource::Blocking() const noexcept{
+    return true;
+}
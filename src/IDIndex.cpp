@@ -0,0 +1,145 @@
+#include "IDIndex.h"
+#include <algorithm>
+
+namespace{
+
+// spreads the id bits over the top of the word so the shift picks a slot
+inline std::size_t HashID(uint64_t id, unsigned shift){
+    return static_cast<std::size_t>((id * 0x9E3779B97F4A7C15ULL) >> shift);
+}
+
+// fills the 1 based Eytzinger array with an in order walk of the implicit
+// tree, so the sorted entries land at their breadth first positions
+void Place(const std::vector< std::pair<uint64_t, std::size_t> > &sorted, std::size_t &next, std::size_t slot, std::vector<uint64_t> &keys, std::vector<uint64_t> &positions){
+    while(slot < keys.size()){
+        Place(sorted, next, slot * 2, keys, positions);
+        keys[slot] = sorted[next].first;
+        positions[slot] = sorted[next].second;
+        next++;
+        slot = slot * 2 + 1;
+    }
+}
+
+}
+
+CIDIndex::CIDIndex(EKind kind) : DKind(kind), DCount(0), DShift(64){
+
+}
+
+// indexes ids by their position in the vector, replaces any earlier build
+void CIDIndex::Build(const std::vector<uint64_t> &ids){
+    std::vector< std::pair<uint64_t, std::size_t> > Entries;
+    Entries.reserve(ids.size());
+    for(std::size_t Index = 0; Index < ids.size(); Index++){
+        Entries.emplace_back(ids[Index], Index);
+    }
+    // sorting by id then position and keeping the first of each id gives the
+    // same answer as a front to back scan
+    std::sort(Entries.begin(), Entries.end());
+    Entries.erase(std::unique(Entries.begin(), Entries.end(), [](const auto &left, const auto &right){
+        return left.first == right.first;
+    }), Entries.end());
+    DCount = Entries.size();
+    DKeys.clear();
+    DPositions.clear();
+    if(DKind == EKind::Eytzinger){
+        BuildEytzinger(Entries);
+    }
+    else{
+        BuildHash(Entries);
+    }
+    DKeys.shrink_to_fit();
+    DPositions.shrink_to_fit();
+}
+
+void CIDIndex::BuildEytzinger(std::vector< std::pair<uint64_t, std::size_t> > &entries){
+    DKeys.resize(entries.size() + 1);
+    DPositions.resize(entries.size() + 1, NotFound);
+    std::size_t Next = 0;
+    Place(entries, Next, 1, DKeys, DPositions);
+}
+
+// the table is a power of two at least twice the entry count, an empty slot
+// has NotFound as its position
+void CIDIndex::BuildHash(const std::vector< std::pair<uint64_t, std::size_t> > &entries){
+    std::size_t Capacity = 2;
+    DShift = 63;
+    while(Capacity < entries.size() * 2){
+        Capacity *= 2;
+        DShift--;
+    }
+    DKeys.resize(Capacity);
+    DPositions.resize(Capacity, NotFound);
+    std::size_t Mask = Capacity - 1;
+    for(const auto &Entry : entries){
+        std::size_t Slot = HashID(Entry.first, DShift);
+        while(DPositions[Slot] != NotFound){
+            Slot = (Slot + 1) & Mask;
+        }
+        DKeys[Slot] = Entry.first;
+        DPositions[Slot] = Entry.second;
+    }
+}
+
+CIDIndex::EKind CIDIndex::Kind() const noexcept{
+    return DKind;
+}
+
+// number of distinct ids indexed
+std::size_t CIDIndex::Count() const noexcept{
+    return DCount;
+}
+
+// returns the position of the id or NotFound
+std::size_t CIDIndex::Find(uint64_t id) const noexcept{
+    if(!DCount){
+        return NotFound;
+    }
+    return DKind == EKind::Eytzinger ? FindEytzinger(DKeys.data(), DPositions.data(), DKeys.size(), id) : FindHash(id);
+}
+
+// searches 1 based Eytzinger arrays of slots entries, slot 0 is unused, it
+// descends left or right by comparison alone, the slots a few levels down are
+// prefetched since they share a cache line, the trailing ones of the final
+// slot count the right turns taken after the last left turn, shifting them
+// off lands on the smallest key not less than the id
+std::size_t CIDIndex::FindEytzinger(const uint64_t *keys, const uint64_t *positions, std::size_t slots, uint64_t id) noexcept{
+    std::size_t Slot = 1;
+    while(Slot < slots){
+        __builtin_prefetch(keys + std::min(Slot * 8, slots - 1));
+        Slot = Slot * 2 + (keys[Slot] < id);
+    }
+    Slot >>= __builtin_ffsll(~static_cast<unsigned long long>(Slot));
+    return Slot && keys[Slot] == id ? static_cast<std::size_t>(positions[Slot]) : NotFound;
+}
+
+std::size_t CIDIndex::FindHash(uint64_t id) const noexcept{
+    std::size_t Mask = DKeys.size() - 1;
+    std::size_t Slot = HashID(id, DShift);
+    while(DPositions[Slot] != NotFound){
+        if(DKeys[Slot] == id){
+            return static_cast<std::size_t>(DPositions[Slot]);
+        }
+        Slot = (Slot + 1) & Mask;
+    }
+    return NotFound;
+}
+
+// bytes held by the index arrays
+std::size_t CIDIndex::MemoryUsage() const noexcept{
+    return (DKeys.capacity() + DPositions.capacity()) * sizeof(uint64_t);
+}
+
+// the raw arrays, laid out as Eytzinger slots or hash slots depending on the
+// kind
+std::size_t CIDIndex::SlotCount() const noexcept{
+    return DKeys.size();
+}
+
+const uint64_t *CIDIndex::Keys() const noexcept{
+    return DKeys.data();
+}
+
+const uint64_t *CIDIndex::Positions() const noexcept{
+    return DPositions.data();
+}
@@ -0,0 +1,146 @@
+#include "MmapDataSource.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+
+// maps the file read only, a file that cannot be opened or mapped behaves as
+// an empty source and IsOpen() returns false, access sets the paging hint
+CMmapDataSource::CMmapDataSource(const std::string &filename, EAccess access) : DData(nullptr), DSize(0), DIndex(0), DOpen(false){
+    int FileDescriptor = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if(FileDescriptor < 0){
+        return;
+    }
+    struct stat FileStat;
+    if(fstat(FileDescriptor, &FileStat) == 0){
+        if(FileStat.st_size == 0){
+            // empty files cannot be mapped but are still valid sources
+            DOpen = true;
+        }
+        else{
+            void *Mapping = mmap(nullptr, FileStat.st_size, PROT_READ, MAP_PRIVATE, FileDescriptor, 0);
+            if(Mapping != MAP_FAILED){
+                DData = static_cast<const char *>(Mapping);
+                DSize = FileStat.st_size;
+                DOpen = true;
+                Advise(access);
+            }
+        }
+    }
+    // the mapping stays valid after the descriptor is closed
+    close(FileDescriptor);
+}
+
+CMmapDataSource::~CMmapDataSource(){
+    if(DData){
+        munmap(const_cast<char *>(DData), DSize);
+    }
+}
+
+// sets the paging hint for the mapping, parsers walk the file front to back
+// and get readahead just ahead of the pages they fault in, nothing is asked
+// for up front so large files are not read in at open, random access turns
+// readahead off so only the touched pages are read
+bool CMmapDataSource::Advise(EAccess access) noexcept{
+    if(!DData){
+        return false;
+    }
+    void *Mapping = const_cast<char *>(DData);
+    if(access == EAccess::Random){
+        return madvise(Mapping, DSize, MADV_RANDOM) == 0;
+    }
+    return madvise(Mapping, DSize, MADV_SEQUENTIAL) == 0;
+}
+
+bool CMmapDataSource::IsOpen() const noexcept{
+    return DOpen;
+}
+
+// returns the start of the mapped file, the whole file is one contiguous span
+const char *CMmapDataSource::Data() const noexcept{
+    return DData;
+}
+
+std::size_t CMmapDataSource::Size() const noexcept{
+    return DSize;
+}
+
+// returns the offset of the next byte Get will return
+std::size_t CMmapDataSource::Position() const noexcept{
+    return DIndex;
+}
+
+// consumes up to count bytes that the caller has read through Data(), returns
+// the number of bytes actually skipped
+std::size_t CMmapDataSource::Advance(std::size_t count) noexcept{
+    std::size_t Remaining = DSize - DIndex;
+    if(count > Remaining){
+        count = Remaining;
+    }
+    DIndex += count;
+    return count;
+}
+
+bool CMmapDataSource::End() const noexcept{
+    return DIndex >= DSize;
+}
+
+bool CMmapDataSource::Get(char &ch) noexcept{
+    if(DIndex < DSize){
+        ch = DData[DIndex];
+        DIndex++;
+        return true;
+    }
+    return false;
+}
+
+bool CMmapDataSource::Peek(char &ch) noexcept{
+    if(DIndex < DSize){
+        ch = DData[DIndex];
+        return true;
+    }
+    return false;
+}
+
+bool CMmapDataSource::Read(std::vector<char> &buf, std::size_t count) noexcept{
+    std::size_t Remaining = DSize - DIndex;
+    if(count > Remaining){
+        count = Remaining;
+    }
+    buf.assign(DData + DIndex, DData + DIndex + count);
+    DIndex += count;
+    return !buf.empty();
+}
+
+std::size_t CMmapDataSource::ReadBlock(char *buf, std::size_t count) noexcept{
+    std::size_t Remaining = DSize - DIndex;
+    if(count > Remaining){
+        count = Remaining;
+    }
+    if(count){
+        std::memcpy(buf, DData + DIndex, count);
+    }
+    DIndex += count;
+    return count;
+}
+
+// borrowed data points straight into the mapping and stays valid for the
+// lifetime of the source
+std::size_t CMmapDataSource::Borrow(const char *&data, std::size_t count) noexcept{
+    std::size_t Remaining = DSize - DIndex;
+    if(count > Remaining){
+        count = Remaining;
+    }
+    data = DData + DIndex;
+    DIndex += count;
+    return count;
+}
+
+bool CMmapDataSource::Seek(std::size_t offset) noexcept{
+    if(offset > DSize){
+        return false;
+    }
+    DIndex = offset;
+    return true;
+}
@@ -0,0 +1,545 @@
+#include "OSMXMLTokenizer.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+
+namespace{
+
+bool IsSpace(char ch){
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+// names are limited to ASCII, anything else is left to the full parser
+bool IsNameStart(char ch){
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_' || ch == ':';
+}
+
+bool IsNameChar(char ch){
+    return IsNameStart(ch) || (ch >= '0' && ch <= '9') || ch == '-' || ch == '.';
+}
+
+// returns the length of the valid UTF-8 sequence at data, or 0 if it is
+// malformed or encodes a character XML does not allow
+std::size_t UTF8Length(const char *data, const char *end){
+    const unsigned char *Bytes = reinterpret_cast<const unsigned char *>(data);
+    std::size_t Available = end - data;
+    std::size_t Length;
+    if(Bytes[0] < 0xC2){
+        return 0;
+    }
+    else if(Bytes[0] < 0xE0){
+        Length = 2;
+    }
+    else if(Bytes[0] < 0xF0){
+        Length = 3;
+    }
+    else if(Bytes[0] < 0xF5){
+        Length = 4;
+    }
+    else{
+        return 0;
+    }
+    if(Available < Length){
+        return 0;
+    }
+    for(std::size_t Index = 1; Index < Length; Index++){
+        if((Bytes[Index] & 0xC0) != 0x80){
+            return 0;
+        }
+    }
+    if((Bytes[0] == 0xE0 && Bytes[1] < 0xA0) || (Bytes[0] == 0xF0 && Bytes[1] < 0x90)){
+        return 0; // overlong
+    }
+    if((Bytes[0] == 0xED && Bytes[1] >= 0xA0) || (Bytes[0] == 0xF4 && Bytes[1] >= 0x90)){
+        return 0; // surrogate or past U+10FFFF
+    }
+    if(Bytes[0] == 0xEF && Bytes[1] == 0xBF && Bytes[2] >= 0xBE){
+        return 0; // U+FFFE and U+FFFF
+    }
+    return Length;
+}
+
+void AppendUTF8(uint32_t code, std::string &out){
+    if(code < 0x80){
+        out.push_back(static_cast<char>(code));
+    }
+    else if(code < 0x800){
+        out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+    else if(code < 0x10000){
+        out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+    else{
+        out.push_back(static_cast<char>(0xF0 | (code >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+}
+
+// decodes the entity reference starting at the '&' in data, returns the
+// length of the reference or 0 if it is not one we know
+std::size_t DecodeReference(const char *data, const char *end, std::string &out){
+    const char *Semicolon = static_cast<const char *>(std::memchr(data, ';', std::min<std::size_t>(end - data, 12)));
+    if(!Semicolon){
+        return 0;
+    }
+    std::string_view Name(data + 1, Semicolon - data - 1);
+    std::size_t Length = Semicolon + 1 - data;
+    if(Name == "amp"){
+        out.push_back('&');
+    }
+    else if(Name == "lt"){
+        out.push_back('<');
+    }
+    else if(Name == "gt"){
+        out.push_back('>');
+    }
+    else if(Name == "quot"){
+        out.push_back('"');
+    }
+    else if(Name == "apos"){
+        out.push_back('\'');
+    }
+    else if(Name.size() >= 2 && Name[0] == '#'){
+        bool Hex = Name[1] == 'x';
+        std::size_t Start = Hex ? 2 : 1;
+        if(Start == Name.size()){
+            return 0;
+        }
+        uint32_t Code = 0;
+        for(std::size_t Index = Start; Index < Name.size(); Index++){
+            char Ch = Name[Index];
+            uint32_t Digit;
+            if(Ch >= '0' && Ch <= '9'){
+                Digit = Ch - '0';
+            }
+            else if(Hex && Ch >= 'a' && Ch <= 'f'){
+                Digit = Ch - 'a' + 10;
+            }
+            else if(Hex && Ch >= 'A' && Ch <= 'F'){
+                Digit = Ch - 'A' + 10;
+            }
+            else{
+                return 0;
+            }
+            Code = Code * (Hex ? 16 : 10) + Digit;
+            if(Code > 0x10FFFF){
+                return 0;
+            }
+        }
+        bool Valid = Code == 0x9 || Code == 0xA || Code == 0xD || (Code >= 0x20 && Code <= 0xD7FF) || (Code >= 0xE000 && Code <= 0xFFFD) || Code >= 0x10000;
+        if(!Valid){
+            return 0;
+        }
+        AppendUTF8(Code, out);
+    }
+    else{
+        return 0;
+    }
+    return Length;
+}
+
+}
+
+struct COSMXMLTokenizer::SImplementation{
+    SHandler &Handler;
+    std::string Pending; // start of a token cut off at the end of the previous data
+    std::string Rest; // input from the construct the tokenizer stopped at
+    bool Failed; // an unexpected construct was found
+    bool AtStart; // nothing of the document has been consumed yet
+    bool RootSeen; // the root element has started
+    std::vector<std::string> Open; // names of the open elements, Open[0] is the root
+    std::size_t OpenCount;
+    std::string Scratch; // NUL separated name and attribute text of a start tag
+    std::vector<std::size_t> Offsets; // attribute text offsets into Scratch
+    std::vector<const char *> Attributes; // attribute array handed to the handler
+    std::string Text; // decoded character data
+
+    SImplementation(SHandler &handler) : Handler(handler), Failed(false), AtStart(true), RootSeen(false), OpenCount(0){
+
+    }
+
+    // appends the text in [begin, end) to out resolving entities and
+    // normalizing line endings, attribute values also turn whitespace into
+    // spaces, returns false on anything that is not well formed
+    bool Decode(const char *begin, const char *end, bool attribute, std::string &out){
+        const char *Cursor = begin;
+        while(Cursor < end){
+            unsigned char Ch = *Cursor;
+            if(Ch >= 0x20 && Ch < 0x80 && Ch != '&' && Ch != '<' && Ch != '>'){
+                out.push_back(Ch);
+                Cursor++;
+            }
+            else if(Ch == '&'){
+                std::size_t Length = DecodeReference(Cursor, end, out);
+                if(!Length){
+                    return false;
+                }
+                Cursor += Length;
+            }
+            else if(Ch == '\r'){
+                out.push_back(attribute ? ' ' : '\n');
+                Cursor++;
+                if(Cursor < end && *Cursor == '\n'){
+                    Cursor++;
+                }
+            }
+            else if(Ch == '\n' || Ch == '\t'){
+                out.push_back(attribute ? ' ' : Ch);
+                Cursor++;
+            }
+            else if(Ch == '>'){
+                if(!attribute && Cursor - begin >= 2 && Cursor[-1] == ']' && Cursor[-2] == ']'){
+                    return false;
+                }
+                out.push_back(Ch);
+                Cursor++;
+            }
+            else if(Ch >= 0x80){
+                std::size_t Length = UTF8Length(Cursor, end);
+                if(!Length){
+                    return false;
+                }
+                out.append(Cursor, Length);
+                Cursor += Length;
+            }
+            else{
+                return false; // '<' or a control character
+            }
+        }
+        return true;
+    }
+
+    // character data between tags, outside the root only whitespace is allowed
+    // and it is not reported
+    bool ScanText(const char *begin, const char *end){
+        if(!OpenCount){
+            for(const char *Cursor = begin; Cursor < end; Cursor++){
+                if(!IsSpace(*Cursor)){
+                    return false;
+                }
+            }
+            return true;
+        }
+        Text.clear();
+        if(!Decode(begin, end, false, Text)){
+            return false;
+        }
+        Handler.CharData(Text.data(), Text.size());
+        return true;
+    }
+
+    // scans the name at cursor, returns nullptr if it does not start a name
+    static const char *ScanName(const char *cursor, const char *end){
+        if(cursor == end || !IsNameStart(*cursor)){
+            return nullptr;
+        }
+        while(cursor < end && IsNameChar(*cursor)){
+            cursor++;
+        }
+        return cursor;
+    }
+
+    static const char *SkipSpace(const char *cursor, const char *end){
+        while(cursor < end && IsSpace(*cursor)){
+            cursor++;
+        }
+        return cursor;
+    }
+
+    enum class EResult{Complete, Incomplete, Unexpected};
+
+    // start tag at begin, next is set past it when it is complete
+    EResult ScanStartTag(const char *begin, const char *end, const char *&next){
+        const char *Cursor = begin + 1;
+        const char *NameEnd = ScanName(Cursor, end);
+        if(!NameEnd){
+            return Cursor == end ? EResult::Incomplete : EResult::Unexpected;
+        }
+        if(NameEnd == end){
+            return EResult::Incomplete;
+        }
+        Scratch.assign(Cursor, NameEnd - Cursor);
+        Scratch.push_back('\0');
+        Offsets.clear();
+        Cursor = NameEnd;
+        bool Empty;
+        while(true){
+            const char *Space = Cursor;
+            Cursor = SkipSpace(Cursor, end);
+            if(Cursor == end){
+                return EResult::Incomplete;
+            }
+            if(*Cursor == '>'){
+                Cursor++;
+                Empty = false;
+                break;
+            }
+            if(*Cursor == '/'){
+                if(Cursor + 1 == end){
+                    return EResult::Incomplete;
+                }
+                if(Cursor[1] != '>'){
+                    return EResult::Unexpected;
+                }
+                Cursor += 2;
+                Empty = true;
+                break;
+            }
+            if(Cursor == Space){
+                return EResult::Unexpected; // attributes have to be separated by whitespace
+            }
+            NameEnd = ScanName(Cursor, end);
+            if(!NameEnd){
+                return EResult::Unexpected;
+            }
+            Offsets.push_back(Scratch.size());
+            Scratch.append(Cursor, NameEnd - Cursor);
+            Scratch.push_back('\0');
+            Cursor = SkipSpace(NameEnd, end);
+            if(Cursor == end){
+                return EResult::Incomplete;
+            }
+            if(*Cursor != '='){
+                return EResult::Unexpected;
+            }
+            Cursor = SkipSpace(Cursor + 1, end);
+            if(Cursor == end){
+                return EResult::Incomplete;
+            }
+            char Quote = *Cursor;
+            if(Quote != '"' && Quote != '\''){
+                return EResult::Unexpected;
+            }
+            Cursor++;
+            const char *Close = static_cast<const char *>(std::memchr(Cursor, Quote, end - Cursor));
+            if(!Close){
+                return EResult::Incomplete;
+            }
+            Offsets.push_back(Scratch.size());
+            if(!Decode(Cursor, Close, true, Scratch)){
+                return EResult::Unexpected;
+            }
+            Scratch.push_back('\0');
+            Cursor = Close + 1;
+        }
+        if(!OpenCount && RootSeen){
+            return EResult::Unexpected; // a second root element
+        }
+        RootSeen = true;
+        next = Cursor;
+
+        Attributes.clear();
+        for(auto Offset : Offsets){
+            Attributes.push_back(Scratch.data() + Offset);
+        }
+        Attributes.push_back(nullptr);
+        if(Empty){
+            Handler.StartElement(Scratch.data(), Attributes.data());
+            Handler.EndElement(Scratch.data());
+            return EResult::Complete;
+        }
+        if(OpenCount == Open.size()){
+            Open.emplace_back();
+        }
+        Open[OpenCount++].assign(Scratch.data());
+        Handler.StartElement(Scratch.data(), Attributes.data());
+        return EResult::Complete;
+    }
+
+    // end tag at begin, it has to close the innermost open element
+    EResult ScanEndTag(const char *begin, const char *end, const char *&next){
+        const char *Cursor = begin + 2;
+        const char *NameEnd = ScanName(Cursor, end);
+        if(!NameEnd){
+            return Cursor == end ? EResult::Incomplete : EResult::Unexpected;
+        }
+        const char *Close = SkipSpace(NameEnd, end);
+        if(Close == end){
+            return EResult::Incomplete;
+        }
+        if(*Close != '>' || !OpenCount || Open[OpenCount - 1].compare(0, std::string::npos, Cursor, NameEnd - Cursor) != 0){
+            return EResult::Unexpected;
+        }
+        next = Close + 1;
+        OpenCount--;
+        Handler.EndElement(Open[OpenCount].c_str());
+        return EResult::Complete;
+    }
+
+    // the XML declaration, only UTF-8 documents are handled here
+    EResult ScanDeclaration(const char *begin, const char *end, const char *&next){
+        const char *Close = begin + 2;
+        while(true){
+            Close = static_cast<const char *>(std::memchr(Close, '>', end - Close));
+            if(!Close){
+                return EResult::Incomplete;
+            }
+            if(Close[-1] == '?'){
+                break;
+            }
+            Close++;
+        }
+        std::string_view Declaration(begin, Close + 1 - begin);
+        std::size_t Encoding = Declaration.find("encoding");
+        if(Encoding != std::string_view::npos){
+            std::size_t Quote = Declaration.find_first_of("\"'", Encoding);
+            if(Quote == std::string_view::npos){
+                return EResult::Unexpected;
+            }
+            std::size_t Closing = Declaration.find(Declaration[Quote], Quote + 1);
+            if(Closing == std::string_view::npos){
+                return EResult::Unexpected;
+            }
+            std::string Name(Declaration.substr(Quote + 1, Closing - Quote - 1));
+            for(auto &Ch : Name){
+                Ch = std::tolower(static_cast<unsigned char>(Ch));
+            }
+            if(Name != "utf-8"){
+                return EResult::Unexpected;
+            }
+        }
+        next = Close + 1;
+        return EResult::Complete;
+    }
+
+    // consumes the complete tokens in [begin, end), used is set to the bytes
+    // consumed, on false it is the offset of the construct that stopped us
+    bool Scan(const char *begin, const char *end, bool final, std::size_t &used){
+        const char *Cursor = begin;
+        bool Success = true;
+        while(Cursor < end){
+            const char *Next = nullptr;
+            EResult Result;
+            if(*Cursor != '<'){
+                const char *Less = static_cast<const char *>(std::memchr(Cursor, '<', end - Cursor));
+                if(!Less && !final){
+                    break; // the text may continue in the next data
+                }
+                Next = Less ? Less : end;
+                if(AtStart && Less && Less + 1 == end && !final){
+                    Result = EResult::Incomplete; // whether a declaration follows is not known yet
+                }
+                else if(AtStart && Less && Less[1] == '?'){
+                    // expat rejects a declaration after whitespace, the
+                    // whitespace goes with the hand over so it sees it too
+                    Result = EResult::Unexpected;
+                }
+                else{
+                    Result = ScanText(Cursor, Next) ? EResult::Complete : EResult::Unexpected;
+                }
+            }
+            else if(Cursor + 1 == end){
+                Result = EResult::Incomplete;
+            }
+            else if(Cursor[1] == '/'){
+                Result = ScanEndTag(Cursor, end, Next);
+            }
+            else if(Cursor[1] == '?'){
+                bool Declaration = AtStart && end - Cursor >= 6 && !std::memcmp(Cursor, "<?xml", 5) && IsSpace(Cursor[5]);
+                if(!Declaration && AtStart && end - Cursor < 6 && !std::memcmp(Cursor, "<?xml", end - Cursor)){
+                    Result = EResult::Incomplete;
+                }
+                else{
+                    Result = Declaration ? ScanDeclaration(Cursor, end, Next) : EResult::Unexpected;
+                }
+            }
+            else if(Cursor[1] == '!'){
+                Result = EResult::Unexpected;
+            }
+            else{
+                Result = ScanStartTag(Cursor, end, Next);
+            }
+            if(Result == EResult::Incomplete){
+                Success = !final;
+                break;
+            }
+            if(Result == EResult::Unexpected){
+                Success = false;
+                break;
+            }
+            AtStart = false;
+            Cursor = Next;
+        }
+        used = Cursor - begin;
+        return Success;
+    }
+
+    // keeps everything from the unexpected construct on for the caller
+    EStatus Fail(const char *begin, const char *end, const char *more, const char *moreend){
+        Rest.assign(begin, end - begin);
+        Rest.append(more, moreend - more);
+        Pending.clear();
+        Failed = true;
+        return EStatus::Unexpected;
+    }
+
+    EStatus Parse(const char *data, std::size_t length, bool final){
+        if(Failed){
+            Rest.append(data, length);
+            return EStatus::Unexpected;
+        }
+        const char *Cursor = data;
+        const char *End = data + length;
+        // a token cut off by the previous data is completed in Pending, only
+        // the new data up to the next '>' is copied each time
+        while(!Pending.empty() && (Cursor != End || final)){
+            const char *Close = Cursor != End ? static_cast<const char *>(std::memchr(Cursor, '>', End - Cursor)) : nullptr;
+            const char *Stop = Close ? Close + 1 : End;
+            Pending.append(Cursor, Stop - Cursor);
+            Cursor = Stop;
+            std::size_t Used = 0;
+            if(!Scan(Pending.data(), Pending.data() + Pending.size(), final && Cursor == End, Used)){
+                return Fail(Pending.data() + Used, Pending.data() + Pending.size(), Cursor, End);
+            }
+            Pending.erase(0, Used);
+            if(Cursor == End){
+                break;
+            }
+        }
+        if(Pending.empty() && Cursor != End){
+            std::size_t Used = 0;
+            if(!Scan(Cursor, End, final, Used)){
+                return Fail(Cursor + Used, End, End, End);
+            }
+            Pending.assign(Cursor + Used, End);
+        }
+        if(final && (!Pending.empty() || !RootSeen || OpenCount)){
+            return Fail(Pending.data(), Pending.data() + Pending.size(), End, End);
+        }
+        return EStatus::Ok;
+    }
+};
+
+COSMXMLTokenizer::COSMXMLTokenizer(SHandler &handler) : DImplementation(std::make_unique<SImplementation>(handler)){
+
+}
+
+COSMXMLTokenizer::~COSMXMLTokenizer() = default;
+
+// parses the next data of the document, final marks the end of the input,
+// once Unexpected is returned the input from the construct the tokenizer
+// could not handle on is kept in Remainder() and nothing more is parsed
+COSMXMLTokenizer::EStatus COSMXMLTokenizer::Parse(const char *data, std::size_t length, bool final){
+    return DImplementation->Parse(data, length, final);
+}
+
+std::string_view COSMXMLTokenizer::Remainder() const noexcept{
+    return DImplementation->Rest;
+}
+
+// returns the names of the elements that are open, outermost first
+std::vector< std::string > COSMXMLTokenizer::OpenElements() const{
+    return std::vector< std::string >(DImplementation->Open.begin(), DImplementation->Open.begin() + DImplementation->OpenCount);
+}
+
+// returns true once the root element has been closed, only whitespace may
+// follow it
+bool COSMXMLTokenizer::RootClosed() const noexcept{
+    return DImplementation->RootSeen && !DImplementation->OpenCount;
+}
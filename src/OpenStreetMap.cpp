@@ -4,65 +4,309 @@
 #include <vector>
 #include <unordered_map>
 #include <string>
-#include <iostream>
+#include <charconv>
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <array>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 
 // struct for COpenStreetMap
 struct COpenStreetMap::SImplementation {
     // the inner classes for node and way implementations
-    class SNodeImpl;
+    struct SStringPool;
+    struct SAttributes;
+    struct SNodeStore;
+    class SNodeHandle;
     class SWayImpl;
-    // the vectors to hold nodes and different ways
-    std::vector<std::shared_ptr<SNodeImpl>> nodeList;
+    class SFilterScope;
+    struct SChunk;
+    struct SRawBatch;
+    class SPipeline;
+    struct SSymbols;
+    class SLoader;
+    class SRecorder;
+
+    // attributes are pairs of key and value ids from the string pool, each
+    // element's attributes are ordered by the text of their keys
+    using TStringID = uint32_t;
+    using TKeyValue = std::pair<TStringID, TStringID>;
+
+    // every distinct attribute key and value is stored once
+    std::shared_ptr<SStringPool> strings;
+    // the nodes are kept in parallel arrays and handed out through handles
+    std::shared_ptr<SNodeStore> nodes;
+    // the vector to hold the ways
     std::vector<std::shared_ptr<SWayImpl>> wayList;
+    // the indexes from id to position in the lists, built once loading is done
+    CIDIndex nodeIndex;
+    CIDIndex wayIndex;
+
+    SImplementation(CIDIndex::EKind index);
+
+    // parses an id, negative ids such as those of unsaved edits wrap around
+    // as they do in PBF files, returns false unless the whole text is a number
+    static bool ParseID(std::string_view text, uint64_t &value) {
+        const char *end = text.data() + text.size();
+        if (!text.empty() && text[0] == '-') {
+            int64_t signedValue = 0;
+            auto result = std::from_chars(text.data(), end, signedValue);
+            value = static_cast<uint64_t>(signedValue);
+            return result.ec == std::errc() && result.ptr == end;
+        }
+        auto result = std::from_chars(text.data(), end, value);
+        return result.ec == std::errc() && result.ptr == end;
+    }
+
+    // parses a coordinate, returns false unless the whole text is a number
+    static bool ParseDouble(std::string_view text, double &value) {
+        const char *end = text.data() + text.size();
+        auto result = std::from_chars(text.data(), end, value);
+        return result.ec == std::errc() && result.ptr == end;
+    }
+
+    // orders the attributes of one element by the text text returns for a key
+    // id, of attributes with the same key the later one is kept, elements have
+    // few attributes so they are insertion sorted
+    template <typename TText> static void SortAttributes(std::vector<TKeyValue> &attributes, const TText &text) {
+        std::size_t count = 0;
+        for (std::size_t index = 0; index < attributes.size(); index++) {
+            TKeyValue attribute = attributes[index];
+            std::size_t position = count;
+            while (position && text(attribute.first) < text(attributes[position - 1].first)) {
+                position--;
+            }
+            if (position && text(attribute.first) == text(attributes[position - 1].first)) {
+                attributes[position - 1].second = attribute.second;
+                continue;
+            }
+            std::move_backward(attributes.begin() + position, attributes.begin() + count, attributes.begin() + count + 1);
+            attributes[position] = attribute;
+            count++;
+        }
+        attributes.resize(count);
+    }
+
+    void BuildChunk(const CPBFReader::SBlock &block, SChunk &chunk, std::vector<TStringID> &stringids, std::vector<TKeyValue> &attributes) const;
+    void Append(SChunk &chunk);
+    void Finish();
+};
+
+// interning pool for attribute keys and values, the strings are spread over
+// shards by hash so builder threads can intern at the same time, an id is the
+// string's position in its shard followed by the shard, strings never move
+// once added
+struct COpenStreetMap::SImplementation::SStringPool {
+    static constexpr TStringID InvalidID = std::numeric_limits<TStringID>::max();
+    static constexpr unsigned ShardBits = 6;
+    static constexpr TStringID ShardMask = (1 << ShardBits) - 1;
+
+    struct SShard {
+        std::mutex mutex; // held while the shard is searched or grown
+        std::deque<std::string> values; // the strings by position
+        std::unordered_map<std::string_view, TStringID> ids; // the id of each string, keyed by views of values
+    };
+    std::array<SShard, 1 << ShardBits> shards;
+
+    // returns the id of the string, adding it if it is new, safe to call from
+    // several threads
+    TStringID Intern(std::string_view str) {
+        TStringID shardIndex = static_cast<TStringID>(std::hash<std::string_view>()(str) >> (std::numeric_limits<std::size_t>::digits - ShardBits));
+        SShard &shard = shards[shardIndex];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.ids.find(str);
+        if (it != shard.ids.end()) {
+            return it->second;
+        }
+        TStringID id = static_cast<TStringID>(shard.values.size() << ShardBits) | shardIndex;
+        shard.values.emplace_back(str);
+        shard.ids.emplace(shard.values.back(), id);
+        return id;
+    }
+
+    // returns the string of an id, not safe while another thread interns
+    const std::string &Value(TStringID id) const noexcept {
+        return shards[id & ShardMask].values[id >> ShardBits];
+    }
+
+    // bytes held by the strings and the lookup tables
+    std::size_t MemoryUsage() const noexcept {
+        std::size_t bytes = 0;
+        for (const auto &shard : shards) {
+            bytes += shard.values.size() * sizeof(std::string) + shard.ids.bucket_count() * sizeof(void *);
+            bytes += shard.ids.size() * (sizeof(std::pair<std::string_view, TStringID>) + sizeof(void *));
+            for (const auto &value : shard.values) {
+                // only strings too long for the small string buffer allocate
+                bytes += value.capacity() > 15 ? value.capacity() + 1 : 0;
+            }
+        }
+        return bytes;
+    }
 };
 
-// node class implementation
-class COpenStreetMap::SImplementation::SNodeImpl : public CStreetMap::SNode {
+// view of the attributes of one node or way, ordered by key so a key is
+// found with a binary search and an attribute by index directly
+struct COpenStreetMap::SImplementation::SAttributes {
+    const SStringPool *pool; // pool the ids refer to
+    const TKeyValue *data; // first attribute
+    std::size_t count; // number of attributes
+
+    // returns the attribute with the key or nullptr
+    const TKeyValue *Find(const std::string &key) const noexcept {
+        const TKeyValue *end = data + count;
+        const TKeyValue *it = std::lower_bound(data, end, key, [this](const TKeyValue &attribute, const std::string &key) {
+            return pool->Value(attribute.first) < key;
+        });
+        return it != end && pool->Value(it->first) == key ? it : nullptr;
+    }
+
+    std::string Key(std::size_t index) const noexcept {
+        return index < count ? pool->Value(data[index].first) : "";
+    }
+
+    bool Has(const std::string &key) const noexcept {
+        return Find(key) != nullptr;
+    }
+
+    std::string Value(const std::string &key) const noexcept {
+        const TKeyValue *attribute = Find(key);
+        return attribute ? pool->Value(attribute->second) : "";
+    }
+};
+
+// node storage as parallel arrays, a node is its position in them, the few
+// nodes with attributes other than id, lat and lon are listed in ascending
+// order in a side table so untagged nodes cost only their id and location
+struct COpenStreetMap::SImplementation::SNodeStore {
+    std::shared_ptr<const SStringPool> strings; // pool the attribute ids refer to
+    std::vector<TNodeID> ids; // id of each node
+    std::vector<double> lats; // latitude of each node
+    std::vector<double> lons; // longitude of each node
+    std::vector<std::size_t> taggedNodes; // positions of the nodes with attributes
+    std::vector<std::size_t> attributeStarts; // start of each tagged node's attributes, one extra at the end
+    std::vector<TKeyValue> attributes; // attributes of the tagged nodes back to back
+
+    SNodeStore(std::shared_ptr<const SStringPool> pool) : strings(std::move(pool)), attributeStarts(1, 0) {}
+
+    // appends a node, attributes are ordered by key and may be empty
+    void Add(TNodeID id, TLocation location, const std::vector<TKeyValue> &nodeAttributes) {
+        if (!nodeAttributes.empty()) {
+            taggedNodes.push_back(ids.size());
+            attributes.insert(attributes.end(), nodeAttributes.begin(), nodeAttributes.end());
+            attributeStarts.push_back(attributes.size());
+        }
+        ids.push_back(id);
+        lats.push_back(location.first);
+        lons.push_back(location.second);
+    }
+
+    // appends the nodes of a store that refers to the same pool
+    void Append(const SNodeStore &other) {
+        std::size_t base = ids.size(), attributeBase = attributes.size();
+        ids.insert(ids.end(), other.ids.begin(), other.ids.end());
+        lats.insert(lats.end(), other.lats.begin(), other.lats.end());
+        lons.insert(lons.end(), other.lons.begin(), other.lons.end());
+        for (auto node : other.taggedNodes) {
+            taggedNodes.push_back(base + node);
+        }
+        for (std::size_t index = 1; index < other.attributeStarts.size(); index++) {
+            attributeStarts.push_back(attributeBase + other.attributeStarts[index]);
+        }
+        attributes.insert(attributes.end(), other.attributes.begin(), other.attributes.end());
+    }
+
+    void Clear() {
+        ids.clear();
+        lats.clear();
+        lons.clear();
+        taggedNodes.clear();
+        attributeStarts.assign(1, 0);
+        attributes.clear();
+    }
+
+    // finds the attributes of the node at a position, the view is empty for
+    // an untagged node
+    SAttributes Attributes(std::size_t node) const noexcept {
+        auto it = std::lower_bound(taggedNodes.begin(), taggedNodes.end(), node);
+        if (it == taggedNodes.end() || *it != node) {
+            return {strings.get(), nullptr, 0};
+        }
+        std::size_t tagged = it - taggedNodes.begin();
+        return {strings.get(), attributes.data() + attributeStarts[tagged], attributeStarts[tagged + 1] - attributeStarts[tagged]};
+    }
+
+    // bytes held by the arrays, the strings are counted with the pool
+    std::size_t MemoryUsage() const noexcept {
+        std::size_t bytes = ids.capacity() * sizeof(TNodeID) + (lats.capacity() + lons.capacity()) * sizeof(double);
+        return bytes + (taggedNodes.capacity() + attributeStarts.capacity()) * sizeof(std::size_t) + attributes.capacity() * sizeof(TKeyValue);
+    }
+
+    // releases the spare capacity left from growing the arrays while loading
+    void Shrink() {
+        ids.shrink_to_fit();
+        lats.shrink_to_fit();
+        lons.shrink_to_fit();
+        taggedNodes.shrink_to_fit();
+        attributeStarts.shrink_to_fit();
+        attributes.shrink_to_fit();
+    }
+};
+
+// node handed out by NodeByIndex and NodeByID, a position in the node store
+// that it keeps alive, so it stays valid after the map is gone
+class COpenStreetMap::SImplementation::SNodeHandle : public CStreetMap::SNode {
 public:
-    TNodeID nodeID; // id for node
-    TLocation nodeLocation; // location (lat, long) for node
-    std::unordered_map<std::string, std::string> nodeAttributes; // attributes for node
+    std::shared_ptr<const SNodeStore> store; // store that holds the node
+    std::size_t node; // position of the node in the store
+
+    SNodeHandle(std::shared_ptr<const SNodeStore> nodeStore, std::size_t index) : store(std::move(nodeStore)), node(index) {}
 
     // override methods for node
     TNodeID ID() const noexcept override { 
-        return nodeID; // return the node id
+        return store->ids[node]; // return the node id
     }
     TLocation Location() const noexcept override { 
-        return nodeLocation; // return the location of the node
+        return {store->lats[node], store->lons[node]}; // return the location of the node
     }
     std::size_t AttributeCount() const noexcept override {
-        return nodeAttributes.size(); // return the size of nodeAttributes
+        return store->Attributes(node).count;
     }
     
-    // get attribute key by index
+    // get attribute key by index, attributes are ordered by key
     std::string GetAttributeKey(std::size_t index) const noexcept override {
-        // if the index is less than the size of nodeAttributes
-        if (index < nodeAttributes.size()) {
-            auto it = nodeAttributes.begin(); // iterator to the beginning of nodeAttributes
-            std::advance(it, index); // advance the iterator to the index
-            return it->first; // return the key
-        }
-        return "";
+        return store->Attributes(node).Key(index);
     }
 
     // check if the node has a specific attribute
     bool HasAttribute(const std::string &key) const noexcept override { 
-        return nodeAttributes.find(key) != nodeAttributes.end(); // return true if the key is found in nodeAttributes
+        return store->Attributes(node).Has(key);
     }
     
     // get attribute value by key
     std::string GetAttribute(const std::string &key) const noexcept override {
-        auto it = nodeAttributes.find(key); // iterator to find the key in nodeAttributes
-        return (it != nodeAttributes.end()) ? it->second : "";
+        return store->Attributes(node).Value(key);
     }
 };
 
+COpenStreetMap::SImplementation::SImplementation(CIDIndex::EKind index) : strings(std::make_shared<SStringPool>()),
+    nodes(std::make_shared<SNodeStore>(strings)), nodeIndex(index), wayIndex(index) {}
+
 // implementation of way class, this inherits from CStreetMap::SWay
 class COpenStreetMap::SImplementation::SWayImpl : public CStreetMap::SWay {
 public:
     TWayID wayID; // id for way
     std::vector<TNodeID> nodeIDs; // vector to hold node ids for way
-    std::unordered_map<std::string, std::string> wayAttributes; // attributes for way
+    std::shared_ptr<const SStringPool> strings; // pool the attribute ids refer to
+    std::vector<TKeyValue> wayAttributes; // attributes for way ordered by key
+
+    SWayImpl(std::shared_ptr<const SStringPool> pool) : wayID(0), strings(std::move(pool)) {}
+
+    SAttributes Attributes() const noexcept {
+        return {strings.get(), wayAttributes.data(), wayAttributes.size()};
+    }
 
     // override methods for way
     TWayID ID() const noexcept override { 
@@ -87,145 +331,647 @@ public:
         return wayAttributes.size(); // return the size of wayAttributes
     }
     
-    // get attribute key by index
+    // get attribute key by index, attributes are ordered by key
     std::string GetAttributeKey(std::size_t index) const noexcept override {
-        // if the index is less than the size of wayAttributes
-        if (index < wayAttributes.size()) {
-            auto it = wayAttributes.begin(); // iterator to the beginning of wayAttributes
-            std::advance(it, index); // advance the iterator to the index
-            return it->first;
-        }
-        return "";
+        return Attributes().Key(index);
     }
 
     // check if the way has a specific attribute
     bool HasAttribute(const std::string &key) const noexcept override { 
-        return wayAttributes.find(key) != wayAttributes.end(); // return true if the key is found in wayAttributes
+        return Attributes().Has(key);
     }
     
     // get attribute value by key
     std::string GetAttribute(const std::string &key) const noexcept override {
-        auto it = wayAttributes.find(key); // iterator to find the key in wayAttributes
-        if (it != wayAttributes.end()) { // if the key is found in wayAttributes
-            return it->second;
+        return Attributes().Value(key);
+    }
+};
+
+// applies a filter to a reader for the lifetime of the scope and restores
+// the reader's previous filter afterwards, also when loading throws
+class COpenStreetMap::SImplementation::SFilterScope {
+    CXMLReader &reader;
+    CXMLReader::SFilter previous;
+
+public:
+    SFilterScope(CXMLReader &target, const CXMLReader::SFilter &filter) : reader(target), previous(target.Filter()) {
+        reader.SetFilter(filter);
+    }
+
+    ~SFilterScope() {
+        reader.SetFilter(previous);
+    }
+};
+
+// trims the node store and indexes the ids of the loaded nodes and ways
+void COpenStreetMap::SImplementation::Finish() {
+    nodes->Shrink();
+    nodeIndex.Build(nodes->ids);
+    std::vector<uint64_t> ids;
+    ids.reserve(wayList.size());
+    for (const auto &way : wayList) {
+        ids.push_back(way->wayID);
+    }
+    wayIndex.Build(ids);
+}
+
+// the nodes and ways of one block, built on a builder thread and appended
+// to the map as they are
+struct COpenStreetMap::SImplementation::SChunk {
+    SNodeStore nodes;
+    std::vector<std::shared_ptr<SWayImpl>> ways;
+
+    SChunk(std::shared_ptr<const SStringPool> pool) : nodes(std::move(pool)) {}
+};
+
+// builds the nodes and ways of a block, the block's strings are interned
+// once each, only the pool is touched so several threads can build at once
+void COpenStreetMap::SImplementation::BuildChunk(const CPBFReader::SBlock &block, SChunk &chunk, std::vector<TStringID> &stringids, std::vector<TKeyValue> &attributes) const {
+    chunk.nodes.Clear();
+    chunk.ways.clear();
+    stringids.assign(block.DStrings.size(), SStringPool::InvalidID);
+    auto intern = [&](uint32_t index) {
+        if (stringids[index] == SStringPool::InvalidID) {
+            stringids[index] = strings->Intern(block.DStrings[index]);
+        }
+        return stringids[index];
+    };
+    // gathers the tags of one element ordered by key, they are ordered on
+    // the block's own strings before the ids are looked up
+    auto gather = [&](const std::vector<CPBFReader::SBlock::TTag> &tags, std::size_t begin, std::size_t end) {
+        attributes.assign(tags.begin() + begin, tags.begin() + end);
+        SortAttributes(attributes, [&](uint32_t index) -> const std::string & {
+            return block.DStrings[index];
+        });
+        for (auto &attribute : attributes) {
+            attribute = {intern(attribute.first), intern(attribute.second)};
         }
-        return "";
+    };
+    for (std::size_t index = 0; index < block.DNodeIDs.size(); index++) {
+        gather(block.DNodeTags, block.DNodeTagStarts[index], block.DNodeTagStarts[index + 1]);
+        chunk.nodes.Add(block.DNodeIDs[index], {block.DNodeLats[index], block.DNodeLons[index]}, attributes);
+    }
+    for (std::size_t index = 0; index < block.DWayIDs.size(); index++) {
+        auto way = std::make_shared<SWayImpl>(strings);
+        way->wayID = block.DWayIDs[index];
+        way->nodeIDs.assign(block.DWayRefs.begin() + block.DWayRefStarts[index], block.DWayRefs.begin() + block.DWayRefStarts[index + 1]);
+        gather(block.DWayTags, block.DWayTagStarts[index], block.DWayTagStarts[index + 1]);
+        way->wayAttributes = attributes;
+        chunk.ways.push_back(std::move(way));
+    }
+}
+
+// appends a built chunk after the nodes and ways already loaded
+void COpenStreetMap::SImplementation::Append(SChunk &chunk) {
+    nodes->Append(chunk.nodes);
+    wayList.insert(wayList.end(), std::make_move_iterator(chunk.ways.begin()), std::make_move_iterator(chunk.ways.end()));
+    chunk.ways.clear();
+}
+
+// a run of nodes or of ways as the parser saw them, the values are kept as
+// text so number conversion and string lookups can be left to builder threads
+struct COpenStreetMap::SImplementation::SRawBatch {
+    static constexpr std::size_t MaxElements = 4096;
+    static constexpr std::size_t MaxText = 1024 * 1024;
+
+    using TSpan = std::pair<std::size_t, std::size_t>; // offset and length in text
+    struct SElement {
+        TSpan id, lat, lon;
+        std::size_t attributeEnd; // end of the element's run in attributes
+        std::size_t refEnd; // end of the element's run in refs
+    };
+
+    bool ways = false; // the elements are ways rather than nodes
+    std::string text; // the text of every value in the batch
+    std::vector<SElement> elements;
+    std::vector<std::pair<TSpan, TSpan>> attributes; // keys and values
+    std::vector<TSpan> refs;
+
+    // copies a value into the batch
+    TSpan Add(std::string_view str) {
+        TSpan span(text.size(), str.size());
+        text.append(str);
+        return span;
+    }
+
+    std::string_view View(TSpan span) const {
+        return std::string_view(text).substr(span.first, span.second);
+    }
+
+    bool Full() const noexcept {
+        return elements.size() >= MaxElements || text.size() >= MaxText;
+    }
+
+    void Clear() {
+        text.clear();
+        elements.clear();
+        attributes.clear();
+        refs.clear();
     }
+
+    void Build(CPBFReader::SBlock &block) const;
 };
 
-// constructor for COpenStreetMap that takes a shared pointer to CXMLReader
-COpenStreetMap::COpenStreetMap(std::shared_ptr<CXMLReader> xmlReader) {
-    // initialize the implementation
-    DImplementation = std::make_unique<SImplementation>();
-    
-    SXMLEntity xmlEntity; // variable to hold the xml entity
-    
-    std::shared_ptr<SImplementation::SNodeImpl> currNode = nullptr; // this points to current node
-    std::shared_ptr<SImplementation::SWayImpl> currWay = nullptr; // this points to current way
-
-    // read the xml entities
-    while (xmlReader->ReadEntity(xmlEntity)) {
-        // entity is a start element
-        if (xmlEntity.DType == SXMLEntity::EType::StartElement) {
-            
-            // if the entity is a node
-            if (xmlEntity.DNameData == "node") {
-                // it will create a new NodeImplemntation object
-                currNode = std::make_shared<SImplementation::SNodeImpl>();
-                currWay = nullptr; // no way is associated with node
-
-                // parse attributes of node and assign to currNode
-                for (const auto& attributes : xmlEntity.DAttributes) {
-                    if (attributes.first == "id") {
-                        currNode->nodeID = std::stoull(attributes.second); // assign the id to the node
-                    } 
-                    // if the key is not id, then assign the value to the key
-                    else if (attributes.first == "lat") {
-                        currNode->nodeLocation.first = std::stod(attributes.second); // assign the latitude to the node
-                    } 
-                    // if the key is not id or lat, then assign the value to the key
-                    else if (attributes.first == "lon") {
-                        currNode->nodeLocation.second = std::stod(attributes.second); // assign the longitude to the node
-                    } 
-                    // if the key is not id, lat, or lon, then assign the value to the key
-                    else {
-                        currNode->nodeAttributes[attributes.first] = attributes.second; // assign the value to the key
-                    }
+// converts the batch into a block with its own string table, the same form
+// PBF blocks are built from, a node without a well formed id, lat and lon or
+// a way without a well formed id and refs is dropped
+void COpenStreetMap::SImplementation::SRawBatch::Build(CPBFReader::SBlock &block) const {
+    block.Clear();
+    std::unordered_map<std::string_view, uint32_t> indexes;
+    auto index = [&](TSpan span) {
+        auto result = indexes.emplace(View(span), static_cast<uint32_t>(block.DStrings.size()));
+        if (result.second) {
+            block.DStrings.emplace_back(View(span));
+        }
+        return result.first->second;
+    };
+    auto &tags = ways ? block.DWayTags : block.DNodeTags;
+    auto &tagStarts = ways ? block.DWayTagStarts : block.DNodeTagStarts;
+    std::size_t attribute = 0, ref = 0;
+    for (const auto &element : elements) {
+        uint64_t id = 0;
+        bool valid = ParseID(View(element.id), id);
+        if (ways) {
+            std::size_t refStart = block.DWayRefs.size();
+            for (; ref < element.refEnd; ref++) {
+                uint64_t nodeID = 0;
+                valid = ParseID(View(refs[ref]), nodeID) && valid;
+                block.DWayRefs.push_back(nodeID);
+            }
+            if (!valid) {
+                block.DWayRefs.resize(refStart);
+                attribute = element.attributeEnd;
+                continue;
+            }
+            block.DWayIDs.push_back(id);
+            block.DWayRefStarts.push_back(block.DWayRefs.size());
+        }
+        else {
+            double lat = 0.0, lon = 0.0;
+            if (!valid || !ParseDouble(View(element.lat), lat) || !ParseDouble(View(element.lon), lon)) {
+                attribute = element.attributeEnd;
+                continue;
+            }
+            block.DNodeIDs.push_back(id);
+            block.DNodeLats.push_back(lat);
+            block.DNodeLons.push_back(lon);
+        }
+        for (; attribute < element.attributeEnd; attribute++) {
+            uint32_t key = index(attributes[attribute].first);
+            tags.emplace_back(key, index(attributes[attribute].second));
+        }
+        tagStarts.push_back(tags.size());
+    }
+}
+
+// the builder workers turn submitted batches into chunks of finished nodes
+// and ways while the merge thread appends the chunks to the map in the order
+// they were submitted, at most two batches per worker are in flight, the
+// first exception thrown on a worker stops the pipeline, later batches are
+// dropped and Finish rethrows it
+class COpenStreetMap::SImplementation::SPipeline {
+    struct SJob {
+        SRawBatch batch;
+        SChunk chunk;
+        bool done = false;
+
+        SJob(std::shared_ptr<const SStringPool> pool) : chunk(std::move(pool)) {}
+    };
+
+    SImplementation &impl;
+    std::size_t window;
+    std::deque<std::shared_ptr<SJob>> inFlight; // jobs in submission order
+    std::deque<std::shared_ptr<SJob>> queue; // jobs no builder has taken
+    std::vector<std::thread> builders;
+    std::thread merger;
+    std::mutex mutex;
+    std::condition_variable workReady;
+    std::condition_variable workDone;
+    std::condition_variable space;
+    bool submitted = false; // the last batch has been submitted
+    bool stop = false;
+    std::exception_ptr error; // first exception thrown on a worker
+
+    // keeps the exception being handled if it is the first and wakes every
+    // thread so they stop, the mutex has to be held
+    void Fail() {
+        if (!error) {
+            error = std::current_exception();
+        }
+        stop = true;
+        workReady.notify_all();
+        workDone.notify_all();
+        space.notify_all();
+    }
+
+    void Build() {
+        CPBFReader::SBlock block;
+        std::vector<TStringID> stringids;
+        std::vector<TKeyValue> attributes;
+        while (true) {
+            std::shared_ptr<SJob> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                workReady.wait(lock, [&] { return stop || !queue.empty(); });
+                if (stop) {
+                    return;
                 }
-            } 
-
-            // if the entity is a way, then create a new WayImplementation
-            else if (xmlEntity.DNameData == "way") {
-                currWay = std::make_shared<SImplementation::SWayImpl>(); // create a new way
-                currNode = nullptr; // node is not associated with way
-
-                // parse attributes of way and assign to currWay
-                for (const auto& attributes : xmlEntity.DAttributes) {
-                    // if the key is id, then assign the value to the wayID
-                    if (attributes.first == "id") {
-                        currWay->wayID = std::stoull(attributes.second); // assign the id to the way
-                    } 
-                    // if the key is not id, then assign the value to the key
-                    else {
-                        currWay->wayAttributes[attributes.first] = attributes.second; // assign the value to the key
-                    }
+                job = queue.front();
+                queue.pop_front();
+            }
+            try {
+                job->batch.Build(block);
+                job->batch = SRawBatch();
+                impl.BuildChunk(block, job->chunk, stringids, attributes);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                Fail();
+                return;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            job->done = true;
+            workDone.notify_all();
+        }
+    }
+
+    void Merge() {
+        while (true) {
+            std::shared_ptr<SJob> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                workDone.wait(lock, [&] { return stop || (inFlight.empty() ? submitted : inFlight.front()->done); });
+                if (stop || inFlight.empty()) {
+                    return;
+                }
+                job = inFlight.front();
+                inFlight.pop_front();
+                space.notify_one();
+            }
+            try {
+                impl.Append(job->chunk);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                Fail();
+                return;
+            }
+        }
+    }
+
+    // waits until every submitted batch is appended or the pipeline failed
+    // and joins the threads
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            submitted = true;
+        }
+        workDone.notify_all();
+        if (merger.joinable()) {
+            merger.join();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        workReady.notify_all();
+        for (auto &builder : builders) {
+            if (builder.joinable()) {
+                builder.join();
+            }
+        }
+    }
+
+public:
+    SPipeline(SImplementation &implementation, std::size_t threads) : impl(implementation), window(threads * 2) {
+        try {
+            for (std::size_t index = 0; index < threads; index++) {
+                builders.emplace_back(&SPipeline::Build, this);
+            }
+            merger = std::thread(&SPipeline::Merge, this);
+        }
+        catch (...) {
+            Stop();
+            throw;
+        }
+    }
+
+    ~SPipeline() {
+        Stop();
+    }
+
+    // queues the batch and leaves it empty, waits while the window is full
+    void Submit(SRawBatch &batch) {
+        auto job = std::make_shared<SJob>(impl.strings);
+        std::swap(job->batch, batch);
+        std::unique_lock<std::mutex> lock(mutex);
+        space.wait(lock, [&] { return stop || inFlight.size() < window; });
+        if (stop) {
+            return;
+        }
+        inFlight.push_back(job);
+        queue.push_back(job);
+        workReady.notify_one();
+    }
+
+    // waits until every submitted batch is appended, stops the threads and
+    // rethrows the first exception a worker threw
+    void Finish() {
+        Stop();
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+// symbol ids of the names the loaders look for, interned up front so
+// elements are matched on their ids
+struct COpenStreetMap::SImplementation::SSymbols {
+    using TSymbolID = SXMLEntity::TSymbolID;
+
+    TSymbolID node, way, nd, tag;
+    TSymbolID id, lat, lon, ref, k, v;
+
+    // returns the symbol id of a name, a name that does not fit in a full
+    // symbol table gets an id no name has instead of the invalid id that
+    // every such name shares
+    static TSymbolID Symbol(CXMLReader &reader, std::string_view name) {
+        TSymbolID id = reader.Symbol(name);
+        return id != SXMLEntity::InvalidSymbolID ? id : SXMLEntity::InvalidSymbolID - 1;
+    }
+
+    SSymbols(CXMLReader &reader) :
+        node(Symbol(reader, "node")), way(Symbol(reader, "way")), nd(Symbol(reader, "nd")), tag(Symbol(reader, "tag")),
+        id(Symbol(reader, "id")), lat(Symbol(reader, "lat")), lon(Symbol(reader, "lon")), ref(Symbol(reader, "ref")),
+        k(Symbol(reader, "k")), v(Symbol(reader, "v")) {}
+};
+
+// visitor that adds the nodes and ways to the map as the parser reports
+// them, id, lat and lon of a node and the id of a way are kept apart while
+// their other attributes and their tags with a key become attributes, a
+// later one replacing an earlier one with the same key, a node without a
+// well formed id, lat and lon or a way without a well formed id and refs is
+// dropped
+class COpenStreetMap::SImplementation::SLoader : public CXMLVisitor {
+public:
+    SImplementation &impl; // map being loaded
+    SSymbols symbols;
+    bool inNode = false; // a node is being read
+    bool inWay = false; // a way is being read
+    bool valid = false; // the id, location and refs read so far are well formed
+    TNodeID nodeID = 0; // id of the node being read
+    TLocation location; // location of the node being read
+    std::shared_ptr<SWayImpl> way; // the way being read
+    std::vector<TKeyValue> attributes; // attributes of the node or way being read
+
+    SLoader(SImplementation &implementation, CXMLReader &reader) : impl(implementation), symbols(reader) {}
+
+    void Close() {
+        if (valid) {
+            SortAttributes(attributes, [this](TStringID id) -> const std::string & {
+                return impl.strings->Value(id);
+            });
+            if (inNode) {
+                impl.nodes->Add(nodeID, location, attributes);
+            }
+            else {
+                way->wayAttributes = attributes;
+                impl.wayList.push_back(std::move(way));
+            }
+        }
+        inNode = inWay = false;
+    }
+
+    void StartElement(std::string_view name, TSymbolID nameid, const std::vector<TAttribute> &elementAttributes, const std::vector<TSymbolID> &attributeids) override {
+        if (nameid == symbols.node || nameid == symbols.way) {
+            inWay = nameid == symbols.way;
+            inNode = !inWay;
+            attributes.clear();
+            if (inWay) {
+                way = std::make_shared<SWayImpl>(impl.strings);
+            }
+            bool hasID = false, hasLat = false, hasLon = false;
+            uint64_t id = 0;
+            for (std::size_t index = 0; index < elementAttributes.size(); index++) {
+                const auto& attribute = elementAttributes[index];
+                if (attributeids[index] == symbols.id) {
+                    hasID = ParseID(attribute.second, id);
+                }
+                else if (inNode && attributeids[index] == symbols.lat) {
+                    hasLat = ParseDouble(attribute.second, location.first);
+                }
+                else if (inNode && attributeids[index] == symbols.lon) {
+                    hasLon = ParseDouble(attribute.second, location.second);
                 }
-            } 
-            // if the entity is a nd
-            else if (xmlEntity.DNameData == "nd" && currWay) {
-                
-                // parse attributes of nd and assign to currWay
-                for (const auto& attributes : xmlEntity.DAttributes) {
-                    // if the key is ref, then assign the value to the nodeIDs
-                    if (attributes.first == "ref") {
-                        currWay->nodeIDs.push_back(std::stoull(attributes.second)); // assign the id to the way
-                    }
+                else {
+                    TStringID key = impl.strings->Intern(attribute.first);
+                    attributes.emplace_back(key, impl.strings->Intern(attribute.second));
+                }
+            }
+            valid = hasID && (inWay || (hasLat && hasLon));
+            if (inWay) {
+                way->wayID = id;
+            }
+            else {
+                nodeID = id;
+            }
+        }
+        else if (nameid == symbols.nd && inWay) {
+            for (std::size_t index = 0; index < elementAttributes.size(); index++) {
+                uint64_t ref = 0;
+                if (attributeids[index] == symbols.ref) {
+                    valid = ParseID(elementAttributes[index].second, ref) && valid;
+                    way->nodeIDs.push_back(ref);
+                }
+            }
+        }
+        else if (nameid == symbols.tag && (inNode || inWay)) {
+            std::string_view key, value;
+            for (std::size_t index = 0; index < elementAttributes.size(); index++) {
+                if (attributeids[index] == symbols.k) {
+                    key = elementAttributes[index].second;
                 }
-            } 
-            // if the entity is a tag
-            else if (xmlEntity.DNameData == "tag") {
-                std::string key, value; // variables to hold key and value
-
-                // parse attributes of tag and assign to key and value
-                for (const auto& attributes : xmlEntity.DAttributes) {
-                    // if the key is k, then assign the value to the key
-                    if (attributes.first == "k") {
-                        key = attributes.second; // assign the value to the key
-                    } 
-                    // if the key is empty, then assign the value to the key
-                    else if (attributes.first == "v") {
-                        value = attributes.second; // assign the value to the key
-                    }
+                else if (attributeids[index] == symbols.v) {
+                    value = elementAttributes[index].second;
                 }
+            }
+            if (!key.empty()) {
+                TStringID keyid = impl.strings->Intern(key);
+                attributes.emplace_back(keyid, impl.strings->Intern(value));
+            }
+        }
+    }
+
+    void EndElement(std::string_view name, TSymbolID nameid) override {
+        if ((nameid == symbols.node && inNode) || (nameid == symbols.way && inWay)) {
+            Close();
+        }
+    }
+};
+
+// visitor that records the nodes and ways from the parser's events into
+// batches for the pipeline, the elements are kept as text the way SLoader
+// would read them and converted on the builder threads
+class COpenStreetMap::SImplementation::SRecorder : public CXMLVisitor {
+public:
+    SPipeline &pipeline; // pipeline that receives the full batches
+    SSymbols symbols;
+    SRawBatch batch; // batch being filled
+    bool inNode = false; // a node is being read
+    bool inWay = false; // a way is being read
+    SRawBatch::SElement element; // the node or way being read
+    std::size_t textMark = 0, attributeMark = 0, refMark = 0; // batch sizes when the element started
+
+    SRecorder(SPipeline &target, CXMLReader &reader) : pipeline(target), symbols(reader) {}
+
+    // submits the batch if it holds any elements, the batch is left empty
+    void Flush() {
+        if (!batch.elements.empty()) {
+            pipeline.Submit(batch);
+        }
+        batch.Clear();
+    }
 
-                // if the key is not empty, then assign the value to the key
-                if (!key.empty()) {
-                    // if the entity is a node and currNode is not null, then assign the value to the key
-                    if  (currNode) {
-                        currNode->nodeAttributes[key] = value; // assign the value to the key
-                    } 
-                    // if the entity is a way and currWay is not null, then assign the value to the key
-                    else if (currWay) {
-                        currWay->wayAttributes[key] = value; // assign the value to the key
-                    }
+    // drops what was recorded for an element that never ended
+    void Discard() {
+        if (inNode || inWay) {
+            batch.text.resize(textMark);
+            batch.attributes.resize(attributeMark);
+            batch.refs.resize(refMark);
+        }
+        inNode = inWay = false;
+    }
+
+    // starts a node or way, a batch only holds one kind so the nodes and ways
+    // are merged in the order they were read
+    void Open(bool way) {
+        Discard();
+        if (batch.ways != way) {
+            Flush();
+            batch.ways = way;
+        }
+        inNode = !way;
+        inWay = way;
+        element = SRawBatch::SElement();
+        textMark = batch.text.size();
+        attributeMark = batch.attributes.size();
+        refMark = batch.refs.size();
+    }
+
+    void Close() {
+        element.attributeEnd = batch.attributes.size();
+        element.refEnd = batch.refs.size();
+        batch.elements.push_back(element);
+        inNode = inWay = false;
+        if (batch.Full()) {
+            Flush();
+        }
+    }
+
+    void StartElement(std::string_view name, TSymbolID nameid, const std::vector<TAttribute> &attributes, const std::vector<TSymbolID> &attributeids) override {
+        if (nameid == symbols.node || nameid == symbols.way) {
+            Open(nameid == symbols.way);
+            for (std::size_t index = 0; index < attributes.size(); index++) {
+                const auto& attribute = attributes[index];
+                if (attributeids[index] == symbols.id) {
+                    element.id = batch.Add(attribute.second);
+                }
+                else if (inNode && attributeids[index] == symbols.lat) {
+                    element.lat = batch.Add(attribute.second);
+                }
+                else if (inNode && attributeids[index] == symbols.lon) {
+                    element.lon = batch.Add(attribute.second);
+                }
+                else {
+                    auto key = batch.Add(attribute.first);
+                    batch.attributes.emplace_back(key, batch.Add(attribute.second));
+                }
+            }
+        }
+        else if (nameid == symbols.nd && inWay) {
+            for (std::size_t index = 0; index < attributes.size(); index++) {
+                if (attributeids[index] == symbols.ref) {
+                    batch.refs.push_back(batch.Add(attributes[index].second));
+                }
+            }
+        }
+        else if (nameid == symbols.tag && (inNode || inWay)) {
+            std::string_view key, value;
+            for (std::size_t index = 0; index < attributes.size(); index++) {
+                if (attributeids[index] == symbols.k) {
+                    key = attributes[index].second;
+                }
+                else if (attributeids[index] == symbols.v) {
+                    value = attributes[index].second;
                 }
             }
-        } 
-        // if the entity is an end element
-        else if (xmlEntity.DType == SXMLEntity::EType::EndElement) {
-            
-            // if the entity is a node and currNode is not null, then add it to the nodeList
-            if (xmlEntity.DNameData == "node" && currNode) {
-                DImplementation->nodeList.push_back(currNode);
-                currNode = nullptr; // reset currNode
-            } 
-            // if the entity is a way and currWay is not null, then add it to the wayList
-            else if (xmlEntity.DNameData == "way" && currWay) {
-                DImplementation->wayList.push_back(currWay);
-                currWay = nullptr; // reset currWay
+            if (!key.empty()) {
+                auto keyspan = batch.Add(key);
+                batch.attributes.emplace_back(keyspan, batch.Add(value));
             }
         }
     }
+
+    void EndElement(std::string_view name, TSymbolID nameid) override {
+        if ((nameid == symbols.node && inNode) || (nameid == symbols.way && inWay)) {
+            Close();
+        }
+    }
+};
+
+// constructor for COpenStreetMap that takes a shared pointer to CXMLReader,
+// the map is built from the reader's events without materializing entities,
+// index selects how NodeByID and WayByID look ids up, threads is the number
+// of builder workers with 0 using one per hardware thread, with one the
+// nodes and ways are added as they are parsed, with more the parser only
+// records them while the workers parse the numbers, intern the strings and
+// build the nodes and ways that a merge thread then appends in order
+COpenStreetMap::COpenStreetMap(std::shared_ptr<CXMLReader> xmlReader, CIDIndex::EKind index, std::size_t threads) {
+    // initialize the implementation
+    DImplementation = std::make_unique<SImplementation>(index);
+
+    // only nodes and ways below the root are loaded, relations and other
+    // top level elements are dropped by the reader without being reported,
+    // the caller's filter is put back once loading is done
+    CXMLReader::SFilter filter;
+    filter.DMode = CXMLReader::SFilter::EMode::Allow;
+    filter.DNames = {"node", "way"};
+    filter.DDepth = 1;
+    filter.DDropWhitespace = true;
+    SImplementation::SFilterScope filterScope(*xmlReader, filter);
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (threads == 1) {
+        SImplementation::SLoader loader(*DImplementation, *xmlReader);
+        xmlReader->Visit(loader, true);
+    }
+    else {
+        SImplementation::SPipeline pipeline(*DImplementation, threads);
+        SImplementation::SRecorder recorder(pipeline, *xmlReader);
+        xmlReader->Visit(recorder, true);
+        recorder.Discard();
+        recorder.Flush();
+        pipeline.Finish();
+    }
+    DImplementation->Finish();
+}
+
+// constructor for COpenStreetMap that takes a shared pointer to CPBFReader,
+// the blocks are decoded on the reader's workers and added in file order
+COpenStreetMap::COpenStreetMap(std::shared_ptr<CPBFReader> pbfReader, CIDIndex::EKind index) {
+    DImplementation = std::make_unique<SImplementation>(index);
+
+    CPBFReader::SBlock block;
+    SImplementation::SChunk chunk(DImplementation->strings);
+    std::vector<SImplementation::TStringID> stringids;
+    std::vector<SImplementation::TKeyValue> attributes;
+    while (pbfReader->ReadBlock(block)) {
+        DImplementation->BuildChunk(block, chunk, stringids, attributes);
+        DImplementation->Append(chunk);
+    }
+    DImplementation->Finish();
 }
 
 // destructor for COpenStreetMap
@@ -233,7 +979,7 @@ COpenStreetMap::~COpenStreetMap() = default;
 
 // get the number of nodes
 std::size_t COpenStreetMap::NodeCount() const noexcept {
-    return DImplementation->nodeList.size(); // return the size of nodeList
+    return DImplementation->nodes->ids.size(); // return the number of stored nodes
 }
 
 // get the number of ways
@@ -243,22 +989,20 @@ std::size_t COpenStreetMap::WayCount() const noexcept {
 
 // get the node by index
 std::shared_ptr<CStreetMap::SNode> COpenStreetMap::NodeByIndex(std::size_t index) const noexcept {
-    // if the index is less than the size of nodeList
-    if (index < DImplementation->nodeList.size()) {
-        return DImplementation->nodeList[index]; // return the node by index
+    // if the index is less than the number of nodes
+    if (index < DImplementation->nodes->ids.size()) {
+        return std::make_shared<SImplementation::SNodeHandle>(DImplementation->nodes, index); // return a handle to the node
     }
     return nullptr;
 }
 
-// get node by id
+// get node by id, the first node with the id if it appears more than once
 std::shared_ptr<CStreetMap::SNode> COpenStreetMap::NodeByID(TNodeID id) const noexcept {
-    // iterate through the nodeList
-    for (auto& node : DImplementation->nodeList) {
-        if (node->ID() == id) { // if the node id is equal to the id
-            return node;
-        }
+    std::size_t index = DImplementation->nodeIndex.Find(id);
+    if (index == CIDIndex::NotFound) {
+        return nullptr;
     }
-    return nullptr;
+    return std::make_shared<SImplementation::SNodeHandle>(DImplementation->nodes, index);
 }
 
 // get way by index in wayList
@@ -269,13 +1013,28 @@ std::shared_ptr<CStreetMap::SWay> COpenStreetMap::WayByIndex(std::size_t index)
     return nullptr;
 }
 
-// get way by its id
+// get way by its id, the first way with the id if it appears more than once
 std::shared_ptr<CStreetMap::SWay> COpenStreetMap::WayByID(TWayID id) const noexcept {
-    // iterate through the wayList
-    for (auto& way : DImplementation->wayList) {
-        if (way->ID() == id) { // if the way id is equal to the id
-            return way;
-        }
+    std::size_t index = DImplementation->wayIndex.Find(id);
+    if (index == CIDIndex::NotFound) {
+        return nullptr;
     }
-    return nullptr; 
+    return DImplementation->wayList[index];
+}
+
+// bytes used by the node store, the attribute strings are counted by
+// StringMemoryUsage
+std::size_t COpenStreetMap::NodeMemoryUsage() const noexcept {
+    return DImplementation->nodes->MemoryUsage();
+}
+
+// bytes used by the pool of attribute keys and values shared by all nodes and
+// ways
+std::size_t COpenStreetMap::StringMemoryUsage() const noexcept {
+    return DImplementation->strings->MemoryUsage();
+}
+
+// bytes used by the node and way id indexes
+std::size_t COpenStreetMap::IndexMemoryUsage() const noexcept {
+    return DImplementation->nodeIndex.MemoryUsage() + DImplementation->wayIndex.MemoryUsage();
 }
@@ -0,0 +1,774 @@
+#include "PBFReader.h"
+#include <algorithm>
+#include <condition_variable>
+#include <ctime>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <zlib.h>
+
+namespace{
+
+const std::size_t MaxBlobHeaderSize = 64 * 1024; // limits from the PBF format
+const std::size_t MaxBlobSize = 32 * 1024 * 1024;
+
+// cursor over protobuf wire format data, a malformed value sets Failed and
+// the reads that follow return zero or empty values
+struct SWireReader{
+    const uint8_t *Cursor;
+    const uint8_t *End;
+    bool Failed;
+
+    SWireReader(std::string_view data) : Cursor(reinterpret_cast<const uint8_t *>(data.data())), End(Cursor + data.size()), Failed(false){}
+
+    uint64_t Varint(){
+        uint64_t Value = 0;
+        for(int Shift = 0; Shift < 64 && Cursor < End; Shift += 7){
+            uint8_t Byte = *Cursor++;
+            Value |= static_cast<uint64_t>(Byte & 0x7F) << Shift;
+            if(!(Byte & 0x80)){
+                return Value;
+            }
+        }
+        Failed = true;
+        return 0;
+    }
+
+    // zigzag decoding of the sint32 and sint64 types
+    int64_t SignedVarint(){
+        uint64_t Value = Varint();
+        return static_cast<int64_t>((Value >> 1) ^ (~(Value & 1) + 1));
+    }
+
+    std::string_view Bytes(){
+        uint64_t Length = Varint();
+        if(Failed || Length > static_cast<uint64_t>(End - Cursor)){
+            Failed = true;
+            return std::string_view();
+        }
+        std::string_view Result(reinterpret_cast<const char *>(Cursor), Length);
+        Cursor += Length;
+        return Result;
+    }
+
+    // reads the next field key, false at the end of the data or on an error
+    bool Next(uint32_t &field, uint32_t &wiretype){
+        if(Failed || Cursor >= End){
+            return false;
+        }
+        uint64_t Key = Varint();
+        field = static_cast<uint32_t>(Key >> 3);
+        wiretype = static_cast<uint32_t>(Key & 7);
+        return !Failed;
+    }
+
+    void Skip(uint32_t wiretype){
+        std::size_t Length = 0;
+        switch(wiretype){
+            case 0: Varint(); return;
+            case 1: Length = 8; break;
+            case 2: Bytes(); return;
+            case 5: Length = 4; break;
+            default: Failed = true; return;
+        }
+        if(Length > static_cast<std::size_t>(End - Cursor)){
+            Failed = true;
+            return;
+        }
+        Cursor += Length;
+    }
+};
+
+// appends the values of a repeated varint field, which may be packed or be
+// a single unpacked value
+bool AppendVarints(SWireReader &reader, uint32_t wiretype, std::vector<uint64_t> &values){
+    if(wiretype == 0){
+        values.push_back(reader.Varint());
+        return !reader.Failed;
+    }
+    if(wiretype != 2){
+        return false;
+    }
+    SWireReader Packed(reader.Bytes());
+    while(!reader.Failed && Packed.Cursor < Packed.End){
+        values.push_back(Packed.Varint());
+        if(Packed.Failed){
+            return false;
+        }
+    }
+    return !reader.Failed;
+}
+
+// zigzag decodes values in place and adds them up when they are deltas
+void DecodeSigned(std::vector<uint64_t> &values, bool delta){
+    uint64_t Sum = 0;
+    for(auto &Value : values){
+        uint64_t Decoded = (Value >> 1) ^ (~(Value & 1) + 1);
+        Sum = delta ? Sum + Decoded : Decoded;
+        Value = Sum;
+    }
+}
+
+// coordinates are in nanodegrees, the exact integer is divided so the result
+// is the double nearest the decimal value, as reading the XML text gives
+struct SCoordinates{
+    int64_t Granularity = 100;
+    int64_t LatOffset = 0;
+    int64_t LonOffset = 0;
+
+    double Lat(uint64_t value) const{
+        return static_cast<double>(LatOffset + Granularity * static_cast<int64_t>(value)) / 1e9;
+    }
+
+    double Lon(uint64_t value) const{
+        return static_cast<double>(LonOffset + Granularity * static_cast<int64_t>(value)) / 1e9;
+    }
+};
+
+// formats seconds since the epoch the way OSM XML writes timestamps
+std::string FormatTimestamp(int64_t seconds){
+    std::time_t Time = static_cast<std::time_t>(seconds);
+    std::tm Parts;
+    char Text[32];
+    if(!gmtime_r(&Time, &Parts) || !std::strftime(Text, sizeof(Text), "%Y-%m-%dT%H:%M:%SZ", &Parts)){
+        return std::string();
+    }
+    return Text;
+}
+
+// the author metadata of a node or way, fields missing from the file are
+// left unset
+struct SInfo{
+    std::optional<int64_t> Version;
+    std::optional<int64_t> Timestamp; // in units of the block's date granularity
+    std::optional<int64_t> UID;
+    std::optional<uint64_t> User; // index into the string table
+    std::optional<int64_t> Changeset;
+};
+
+// decodes one primitive block, the scratch vectors are reused between groups
+class CBlockDecoder{
+    private:
+        CPBFReader::SBlock &Block;
+        SCoordinates Coordinates;
+        int64_t DateGranularity = 1000; // milliseconds per timestamp unit
+        std::size_t TableSize = 0; // strings that came from the file's table
+        std::unordered_map<std::string, uint32_t> Added; // strings appended for metadata
+        std::vector<uint64_t> Keys, Values, IDs, Lats, Lons;
+        std::vector<uint64_t> Versions, Timestamps, Changesets, UIDs, Users;
+
+        // index of a string that is not in the file's table, such as a
+        // metadata key or a number formatted as text
+        uint32_t AddString(std::string str){
+            auto Result = Added.emplace(std::move(str), static_cast<uint32_t>(Block.DStrings.size()));
+            if(Result.second){
+                Block.DStrings.push_back(Result.first->first);
+            }
+            return Result.first->second;
+        }
+
+        void AddMetadata(std::vector<CPBFReader::SBlock::TTag> &tags, const char *key, std::string value){
+            uint32_t Key = AddString(key);
+            tags.emplace_back(Key, AddString(std::move(value)));
+        }
+
+        // the metadata is added ahead of the tags under the names the XML
+        // format uses for the attributes, in the order osmium writes them
+        bool AppendInfo(const SInfo &info, std::vector<CPBFReader::SBlock::TTag> &tags){
+            if(info.Version){
+                AddMetadata(tags, "version", std::to_string(*info.Version));
+            }
+            if(info.Timestamp){
+                AddMetadata(tags, "timestamp", FormatTimestamp(*info.Timestamp * DateGranularity / 1000));
+            }
+            if(info.UID){
+                AddMetadata(tags, "uid", std::to_string(*info.UID));
+            }
+            if(info.User){
+                if(*info.User >= TableSize){
+                    return false;
+                }
+                tags.emplace_back(AddString("user"), static_cast<uint32_t>(*info.User));
+            }
+            if(info.Changeset){
+                AddMetadata(tags, "changeset", std::to_string(*info.Changeset));
+            }
+            return true;
+        }
+
+        bool DecodeInfo(std::string_view data, SInfo &info){
+            SWireReader Reader(data);
+            uint32_t Field, WireType;
+            while(Reader.Next(Field, WireType)){
+                if(Field == 1 && WireType == 0){
+                    info.Version = static_cast<int32_t>(Reader.Varint());
+                }
+                else if(Field == 2 && WireType == 0){
+                    info.Timestamp = static_cast<int64_t>(Reader.Varint());
+                }
+                else if(Field == 3 && WireType == 0){
+                    info.Changeset = static_cast<int64_t>(Reader.Varint());
+                }
+                else if(Field == 4 && WireType == 0){
+                    info.UID = static_cast<int32_t>(Reader.Varint());
+                }
+                else if(Field == 5 && WireType == 0){
+                    info.User = static_cast<uint32_t>(Reader.Varint());
+                }
+                else{
+                    Reader.Skip(WireType);
+                }
+            }
+            return !Reader.Failed;
+        }
+
+        // every array of the dense metadata has one value per node, versions
+        // are plain while the rest are delta coded
+        bool DecodeDenseInfo(std::string_view data){
+            SWireReader Reader(data);
+            uint32_t Field, WireType;
+            bool Success = true;
+            while(Success && Reader.Next(Field, WireType)){
+                switch(Field){
+                    case 1: Success = AppendVarints(Reader, WireType, Versions); break;
+                    case 2: Success = AppendVarints(Reader, WireType, Timestamps); break;
+                    case 3: Success = AppendVarints(Reader, WireType, Changesets); break;
+                    case 4: Success = AppendVarints(Reader, WireType, UIDs); break;
+                    case 5: Success = AppendVarints(Reader, WireType, Users); break;
+                    default: Reader.Skip(WireType); break;
+                }
+            }
+            DecodeSigned(Timestamps, true);
+            DecodeSigned(Changesets, true);
+            DecodeSigned(UIDs, true);
+            DecodeSigned(Users, true);
+            return Success && !Reader.Failed;
+        }
+
+        bool AppendTags(std::vector<CPBFReader::SBlock::TTag> &tags){
+            if(Keys.size() != Values.size()){
+                return false;
+            }
+            for(std::size_t Index = 0; Index < Keys.size(); Index++){
+                if(Keys[Index] >= TableSize || Values[Index] >= TableSize){
+                    return false;
+                }
+                tags.emplace_back(static_cast<uint32_t>(Keys[Index]), static_cast<uint32_t>(Values[Index]));
+            }
+            return true;
+        }
+
+        bool DecodeNode(std::string_view data){
+            SWireReader Reader(data);
+            uint32_t Field, WireType;
+            uint64_t ID = 0, Lat = 0, Lon = 0;
+            SInfo Info;
+            bool Success = true;
+            Keys.clear();
+            Values.clear();
+            while(Reader.Next(Field, WireType)){
+                if(Field == 1 && WireType == 0){
+                    ID = static_cast<uint64_t>(Reader.SignedVarint());
+                }
+                else if(Field == 2){
+                    AppendVarints(Reader, WireType, Keys);
+                }
+                else if(Field == 3){
+                    AppendVarints(Reader, WireType, Values);
+                }
+                else if(Field == 4 && WireType == 2){
+                    Success &= DecodeInfo(Reader.Bytes(), Info);
+                }
+                else if(Field == 8 && WireType == 0){
+                    Lat = static_cast<uint64_t>(Reader.SignedVarint());
+                }
+                else if(Field == 9 && WireType == 0){
+                    Lon = static_cast<uint64_t>(Reader.SignedVarint());
+                }
+                else{
+                    Reader.Skip(WireType);
+                }
+            }
+            if(Reader.Failed || !Success || !AppendInfo(Info, Block.DNodeTags) || !AppendTags(Block.DNodeTags)){
+                return false;
+            }
+            Block.DNodeIDs.push_back(ID);
+            Block.DNodeLats.push_back(Coordinates.Lat(Lat));
+            Block.DNodeLons.push_back(Coordinates.Lon(Lon));
+            Block.DNodeTagStarts.push_back(Block.DNodeTags.size());
+            return true;
+        }
+
+        // ids and coordinates are delta coded, the tags of all nodes are one
+        // run of key and value indexes with a zero after each node's tags
+        bool DecodeDenseNodes(std::string_view data){
+            SWireReader Reader(data);
+            uint32_t Field, WireType;
+            bool Success = true;
+            IDs.clear();
+            Lats.clear();
+            Lons.clear();
+            Keys.clear();
+            for(auto *Values : {&Versions, &Timestamps, &Changesets, &UIDs, &Users}){
+                Values->clear();
+            }
+            while(Reader.Next(Field, WireType)){
+                if(Field == 1){
+                    AppendVarints(Reader, WireType, IDs);
+                }
+                else if(Field == 5 && WireType == 2){
+                    Success &= DecodeDenseInfo(Reader.Bytes());
+                }
+                else if(Field == 8){
+                    AppendVarints(Reader, WireType, Lats);
+                }
+                else if(Field == 9){
+                    AppendVarints(Reader, WireType, Lons);
+                }
+                else if(Field == 10){
+                    AppendVarints(Reader, WireType, Keys);
+                }
+                else{
+                    Reader.Skip(WireType);
+                }
+            }
+            if(Reader.Failed || !Success || IDs.size() != Lats.size() || IDs.size() != Lons.size()){
+                return false;
+            }
+            // a metadata array is either missing or has a value for every node
+            for(auto *Values : {&Versions, &Timestamps, &Changesets, &UIDs, &Users}){
+                if(!Values->empty() && Values->size() != IDs.size()){
+                    return false;
+                }
+            }
+            DecodeSigned(IDs, true);
+            DecodeSigned(Lats, true);
+            DecodeSigned(Lons, true);
+            std::size_t KeyValue = 0;
+            for(std::size_t Index = 0; Index < IDs.size(); Index++){
+                SInfo Info;
+                if(!Versions.empty()){
+                    Info.Version = static_cast<int32_t>(Versions[Index]);
+                }
+                if(!Timestamps.empty()){
+                    Info.Timestamp = static_cast<int64_t>(Timestamps[Index]);
+                }
+                if(!UIDs.empty()){
+                    Info.UID = static_cast<int32_t>(UIDs[Index]);
+                }
+                if(!Users.empty()){
+                    Info.User = static_cast<uint32_t>(Users[Index]);
+                }
+                if(!Changesets.empty()){
+                    Info.Changeset = static_cast<int64_t>(Changesets[Index]);
+                }
+                if(!AppendInfo(Info, Block.DNodeTags)){
+                    return false;
+                }
+                // nodes past the end of a shorter run have no tags
+                while(KeyValue < Keys.size() && Keys[KeyValue]){
+                    if(KeyValue + 1 >= Keys.size() || Keys[KeyValue] >= TableSize || Keys[KeyValue + 1] >= TableSize){
+                        return false;
+                    }
+                    Block.DNodeTags.emplace_back(static_cast<uint32_t>(Keys[KeyValue]), static_cast<uint32_t>(Keys[KeyValue + 1]));
+                    KeyValue += 2;
+                }
+                KeyValue++;
+                Block.DNodeIDs.push_back(IDs[Index]);
+                Block.DNodeLats.push_back(Coordinates.Lat(Lats[Index]));
+                Block.DNodeLons.push_back(Coordinates.Lon(Lons[Index]));
+                Block.DNodeTagStarts.push_back(Block.DNodeTags.size());
+            }
+            return true;
+        }
+
+        bool DecodeWay(std::string_view data){
+            SWireReader Reader(data);
+            uint32_t Field, WireType;
+            uint64_t ID = 0;
+            SInfo Info;
+            bool Success = true;
+            Keys.clear();
+            Values.clear();
+            IDs.clear();
+            while(Reader.Next(Field, WireType)){
+                if(Field == 1 && WireType == 0){
+                    ID = Reader.Varint();
+                }
+                else if(Field == 2){
+                    AppendVarints(Reader, WireType, Keys);
+                }
+                else if(Field == 3){
+                    AppendVarints(Reader, WireType, Values);
+                }
+                else if(Field == 4 && WireType == 2){
+                    Success &= DecodeInfo(Reader.Bytes(), Info);
+                }
+                else if(Field == 8){
+                    AppendVarints(Reader, WireType, IDs);
+                }
+                else{
+                    Reader.Skip(WireType);
+                }
+            }
+            if(Reader.Failed || !Success || !AppendInfo(Info, Block.DWayTags) || !AppendTags(Block.DWayTags)){
+                return false;
+            }
+            DecodeSigned(IDs, true);
+            Block.DWayIDs.push_back(ID);
+            Block.DWayRefs.insert(Block.DWayRefs.end(), IDs.begin(), IDs.end());
+            Block.DWayRefStarts.push_back(Block.DWayRefs.size());
+            Block.DWayTagStarts.push_back(Block.DWayTags.size());
+            return true;
+        }
+
+        bool DecodeGroup(std::string_view data){
+            SWireReader Reader(data);
+            uint32_t Field, WireType;
+            bool Success = true;
+            while(Success && Reader.Next(Field, WireType)){
+                if(Field == 1 && WireType == 2){
+                    Success = DecodeNode(Reader.Bytes());
+                }
+                else if(Field == 2 && WireType == 2){
+                    Success = DecodeDenseNodes(Reader.Bytes());
+                }
+                else if(Field == 3 && WireType == 2){
+                    Success = DecodeWay(Reader.Bytes());
+                }
+                else{
+                    Reader.Skip(WireType);
+                }
+            }
+            return Success && !Reader.Failed;
+        }
+
+    public:
+        CBlockDecoder(CPBFReader::SBlock &block) : Block(block){}
+
+        // the string table and coordinate settings are read first since
+        // the groups refer to them wherever they appear in the block
+        bool Decode(std::string_view data){
+            Block.Clear();
+            SWireReader Reader(data);
+            uint32_t Field, WireType;
+            std::vector<std::string_view> Groups;
+            while(Reader.Next(Field, WireType)){
+                if(Field == 1 && WireType == 2){
+                    SWireReader Table(Reader.Bytes());
+                    while(Table.Next(Field, WireType)){
+                        if(Field == 1 && WireType == 2){
+                            Block.DStrings.emplace_back(Table.Bytes());
+                        }
+                        else{
+                            Table.Skip(WireType);
+                        }
+                    }
+                    if(Table.Failed){
+                        return false;
+                    }
+                    TableSize = Block.DStrings.size();
+                }
+                else if(Field == 2 && WireType == 2){
+                    Groups.push_back(Reader.Bytes());
+                }
+                else if(Field == 17 && WireType == 0){
+                    Coordinates.Granularity = static_cast<int64_t>(Reader.Varint());
+                }
+                else if(Field == 18 && WireType == 0){
+                    DateGranularity = static_cast<int64_t>(Reader.Varint());
+                }
+                else if(Field == 19 && WireType == 0){
+                    Coordinates.LatOffset = static_cast<int64_t>(Reader.Varint());
+                }
+                else if(Field == 20 && WireType == 0){
+                    Coordinates.LonOffset = static_cast<int64_t>(Reader.Varint());
+                }
+                else{
+                    Reader.Skip(WireType);
+                }
+            }
+            if(Reader.Failed){
+                return false;
+            }
+            for(auto Group : Groups){
+                if(!DecodeGroup(Group)){
+                    return false;
+                }
+            }
+            return true;
+        }
+};
+
+// unpacks a blob into output, raw and zlib compressed data are supported
+bool InflateBlob(std::string_view blob, std::vector<char> &output){
+    SWireReader Reader(blob);
+    uint32_t Field, WireType;
+    std::string_view Raw, Compressed;
+    uint64_t RawSize = 0;
+    bool Unsupported = false;
+    while(Reader.Next(Field, WireType)){
+        if(Field == 1 && WireType == 2){
+            Raw = Reader.Bytes();
+        }
+        else if(Field == 2 && WireType == 0){
+            RawSize = Reader.Varint();
+        }
+        else if(Field == 3 && WireType == 2){
+            Compressed = Reader.Bytes();
+        }
+        else{
+            // lzma, bzip2, lz4 and zstd data
+            Unsupported |= Field >= 4 && Field <= 7;
+            Reader.Skip(WireType);
+        }
+    }
+    if(Reader.Failed || Unsupported){
+        return false;
+    }
+    if(Compressed.empty()){
+        output.assign(Raw.begin(), Raw.end());
+        return true;
+    }
+    if(RawSize > MaxBlobSize){
+        return false;
+    }
+    output.resize(RawSize);
+    uLongf Length = static_cast<uLongf>(RawSize);
+    if(uncompress(reinterpret_cast<Bytef *>(output.data()), &Length, reinterpret_cast<const Bytef *>(Compressed.data()), static_cast<uLong>(Compressed.size())) != Z_OK){
+        return false;
+    }
+    return Length == RawSize;
+}
+
+// the header block lists the features a reader needs, any this reader does
+// not know would change what the data means
+bool CheckHeader(std::string_view block){
+    SWireReader Reader(block);
+    uint32_t Field, WireType;
+    while(Reader.Next(Field, WireType)){
+        if(Field == 4 && WireType == 2){
+            std::string_view Feature = Reader.Bytes();
+            if(Feature != "OsmSchema-V0.6" && Feature != "DenseNodes"){
+                return false;
+            }
+        }
+        else{
+            Reader.Skip(WireType);
+        }
+    }
+    return !Reader.Failed;
+}
+
+}
+
+void CPBFReader::SBlock::Clear(){
+    DStrings.clear();
+    DNodeIDs.clear();
+    DNodeLats.clear();
+    DNodeLons.clear();
+    DNodeTagStarts.assign(1, 0);
+    DNodeTags.clear();
+    DWayIDs.clear();
+    DWayRefStarts.assign(1, 0);
+    DWayRefs.clear();
+    DWayTagStarts.assign(1, 0);
+    DWayTags.clear();
+}
+
+// the calling thread reads the blobs from the source and queues them, up to
+// two per worker are in flight so memory stays bounded while the workers
+// inflate and decode them, blocks are handed out in the order they were read
+struct CPBFReader::SImplementation{
+    struct SJob{
+        std::vector<char> Blob;
+        SBlock Block;
+        bool Done = false;
+        bool Success = false;
+    };
+
+    std::shared_ptr< CDataSource > Source;
+    std::size_t Threads;
+    std::deque< std::shared_ptr< SJob > > InFlight; // jobs in file order
+    std::deque< std::shared_ptr< SJob > > Queue; // jobs no worker has taken
+    std::vector< std::thread > Pool;
+    std::mutex Mutex;
+    std::condition_variable WorkReady;
+    std::condition_variable WorkDone;
+    bool Stop = false;
+    bool SourceDone = false; // the last blob has been read
+    bool Failed = false; // the file is malformed or uses unsupported features
+
+    SImplementation(std::shared_ptr< CDataSource > src, std::size_t threads) : Source(std::move(src)){
+        Threads = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+        SourceDone = !Source;
+    }
+
+    ~SImplementation(){
+        {
+            std::lock_guard<std::mutex> Lock(Mutex);
+            Stop = true;
+        }
+        WorkReady.notify_all();
+        for(auto &Thread : Pool){
+            Thread.join();
+        }
+    }
+
+    void Worker(){
+        std::vector<char> Inflated;
+        while(true){
+            std::shared_ptr< SJob > Job;
+            {
+                std::unique_lock<std::mutex> Lock(Mutex);
+                WorkReady.wait(Lock, [&]{ return Stop || !Queue.empty(); });
+                if(Stop){
+                    return;
+                }
+                Job = Queue.front();
+                Queue.pop_front();
+            }
+            CBlockDecoder Decoder(Job->Block);
+            bool Success = InflateBlob(std::string_view(Job->Blob.data(), Job->Blob.size()), Inflated) && Decoder.Decode(std::string_view(Inflated.data(), Inflated.size()));
+            std::lock_guard<std::mutex> Lock(Mutex);
+            Job->Blob = std::vector<char>();
+            Job->Success = Success;
+            Job->Done = true;
+            WorkDone.notify_all();
+        }
+    }
+
+    bool ReadExact(char *data, std::size_t length){
+        while(length){
+            std::size_t Length = Source->ReadBlock(data, length);
+            if(!Length){
+                return false;
+            }
+            data += Length;
+            length -= Length;
+        }
+        return true;
+    }
+
+    // reads the next blob of the file, the type comes from its header, false
+    // at the end of the file, where SourceDone is set, or on malformed framing
+    bool ReadBlob(std::string &type, std::vector<char> &blob){
+        char Prefix[4];
+        std::size_t Length = Source->ReadBlock(Prefix, 1);
+        if(!Length){
+            SourceDone = true;
+            return false;
+        }
+        if(!ReadExact(Prefix + 1, 3)){
+            return false;
+        }
+        uint32_t HeaderSize = 0;
+        for(int Index = 0; Index < 4; Index++){
+            HeaderSize = (HeaderSize << 8) | static_cast<uint8_t>(Prefix[Index]);
+        }
+        std::vector<char> Header(HeaderSize);
+        if(HeaderSize > MaxBlobHeaderSize || !ReadExact(Header.data(), Header.size())){
+            return false;
+        }
+        SWireReader Reader(std::string_view(Header.data(), Header.size()));
+        uint32_t Field, WireType;
+        uint64_t DataSize = 0;
+        type.clear();
+        while(Reader.Next(Field, WireType)){
+            if(Field == 1 && WireType == 2){
+                type = Reader.Bytes();
+            }
+            else if(Field == 3 && WireType == 0){
+                DataSize = Reader.Varint();
+            }
+            else{
+                Reader.Skip(WireType);
+            }
+        }
+        if(Reader.Failed || DataSize > MaxBlobSize){
+            return false;
+        }
+        blob.resize(DataSize);
+        return ReadExact(blob.data(), blob.size());
+    }
+
+    // queues blobs until the window is full, the header blob is checked here
+    // and blobs of unknown types are skipped
+    void Fill(){
+        std::string Type;
+        std::vector<char> Blob, Inflated;
+        while(!SourceDone && !Failed && InFlight.size() < Threads * 2){
+            if(!ReadBlob(Type, Blob)){
+                Failed = !SourceDone;
+                SourceDone = true;
+                break;
+            }
+            if(Type == "OSMHeader"){
+                if(!InflateBlob(std::string_view(Blob.data(), Blob.size()), Inflated) || !CheckHeader(std::string_view(Inflated.data(), Inflated.size()))){
+                    Failed = true;
+                    SourceDone = true;
+                }
+                continue;
+            }
+            if(Type != "OSMData"){
+                continue;
+            }
+            if(Pool.empty()){
+                for(std::size_t Index = 0; Index < Threads; Index++){
+                    Pool.emplace_back(&SImplementation::Worker, this);
+                }
+            }
+            auto Job = std::make_shared<SJob>();
+            Job->Blob.swap(Blob);
+            InFlight.push_back(Job);
+            std::lock_guard<std::mutex> Lock(Mutex);
+            Queue.push_back(Job);
+            WorkReady.notify_one();
+        }
+    }
+
+    bool ReadBlock(SBlock &block){
+        Fill();
+        if(InFlight.empty()){
+            return false;
+        }
+        auto Job = InFlight.front();
+        InFlight.pop_front();
+        {
+            std::unique_lock<std::mutex> Lock(Mutex);
+            WorkDone.wait(Lock, [&]{ return Job->Done; });
+        }
+        if(!Job->Success){
+            Failed = true;
+            SourceDone = true;
+            InFlight.clear();
+            return false;
+        }
+        std::swap(block, Job->Block);
+        return true;
+    }
+};
+
+// reads the PBF data from src, threads is the number of decoding workers
+// with 0 using one per hardware thread
+CPBFReader::CPBFReader(std::shared_ptr< CDataSource > src, std::size_t threads)
+    : DImplementation(std::make_unique<SImplementation>(std::move(src), threads)){
+
+}
+
+CPBFReader::~CPBFReader() = default;
+
+// true once every block has been read, false while blocks remain or after
+// malformed data stopped the reader
+bool CPBFReader::End() const{
+    return DImplementation->SourceDone && DImplementation->InFlight.empty() && !DImplementation->Failed;
+}
+
+// replaces block with the next decoded block, returns false at the end of the
+// file or when the file is malformed
+bool CPBFReader::ReadBlock(SBlock &block){
+    return DImplementation->ReadBlock(block);
+}
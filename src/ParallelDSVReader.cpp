@@ -0,0 +1,265 @@
+#include "ParallelDSVReader.h"
+#include "DSVScanner.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// splits a contiguous input into chunks that start on row boundaries and
+// parses the chunks on a set of worker threads, the quote state at each
+// nominal chunk start comes from a parallel pre-pass counting quote parity so
+// quoted newlines never split a row
+struct CParallelDSVReader::SImplementation{
+    // rows of one chunk kept for ordered delivery
+    struct SParsedChunk{
+        std::vector<std::string_view> Fields;
+        std::vector<std::size_t> RowEnds;
+        std::string Unquoted;
+        bool Done = false;
+    };
+
+    std::shared_ptr<CMmapDataSource> Mapping; // keeps a mapped input alive
+    const char *Begin;
+    const char *End;
+    char Delimiter;
+    std::size_t Threads;
+    std::size_t ChunkSize;
+    bool Valid;
+    bool Prepared;
+    std::vector<std::pair<const char *, const char *>> Chunks;
+
+    SImplementation(const char *data, std::size_t size, char delimiter, std::size_t threads, std::size_t chunksize)
+        : Begin(data), End(data + size), Delimiter(delimiter), ChunkSize(std::max<std::size_t>(chunksize, 1)), Valid(true), Prepared(false){
+        Threads = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // stops and joins the worker threads when leaving scope, so a callback
+    // that throws on the calling thread unwinds instead of terminating
+    struct SPoolGuard{
+        std::vector<std::thread> DPool;
+        std::function<void()> DStop;
+
+        ~SPoolGuard(){
+            DStop();
+            for(auto &Thread : DPool){
+                Thread.join();
+            }
+        }
+    };
+
+    // runs task for every index in [0, count) spread over the worker threads,
+    // the first exception from a task stops the others from taking more work
+    // and is rethrown on the calling thread once every worker has joined
+    template <typename TTask> void RunParallel(std::size_t count, const TTask &task){
+        std::atomic<std::size_t> Next(0);
+        std::mutex ErrorMutex;
+        std::exception_ptr Error;
+        auto Worker = [&]{
+            try{
+                for(std::size_t Index; (Index = Next++) < count;){
+                    task(Index);
+                }
+            }
+            catch(...){
+                std::lock_guard<std::mutex> Lock(ErrorMutex);
+                if(!Error){
+                    Error = std::current_exception();
+                }
+                Next = count;
+            }
+        };
+        {
+            SPoolGuard Guard{{}, [&]{ Next = count; }};
+            for(std::size_t Index = 1; Index < std::min(Threads, count); Index++){
+                Guard.DPool.emplace_back(Worker);
+            }
+            Worker();
+        }
+        if(Error){
+            std::rethrow_exception(Error);
+        }
+    }
+
+    // finds the row aligned chunk boundaries
+    void Prepare(){
+        if(Prepared){
+            return;
+        }
+        Prepared = true;
+        std::size_t Size = End - Begin;
+        std::size_t Count = std::max<std::size_t>((Size + ChunkSize - 1) / ChunkSize, 1);
+        std::vector<char> Parity(Count);
+        RunParallel(Count, [&](std::size_t index){
+            const char *ChunkBegin = Begin + std::min(index * ChunkSize, Size);
+            Parity[index] = DSVScanner::QuoteParity(ChunkBegin, Begin + std::min((index + 1) * ChunkSize, Size));
+        });
+        std::vector<char> InQuotes(Count, false);
+        for(std::size_t Index = 1; Index < Count; Index++){
+            InQuotes[Index] = InQuotes[Index - 1] ^ Parity[Index - 1];
+        }
+        // each chunk after the first starts just past the first row end at or
+        // after its nominal start, so boundaries are in increasing order
+        std::vector<const char *> Starts(Count + 1, End);
+        Starts[0] = Begin;
+        RunParallel(Count - 1, [&](std::size_t index){
+            bool Quotes = InQuotes[index + 1];
+            const char *RowEnd = DSVScanner::FindRowEnd(Begin + (index + 1) * ChunkSize, End, Quotes);
+            if(RowEnd != End){
+                const char *Start = RowEnd + 1;
+                if(*RowEnd == '\r' && Start != End && *Start == '\n'){
+                    Start++;
+                }
+                Starts[index + 1] = Start;
+            }
+        });
+        for(std::size_t Index = 0; Index < Count; Index++){
+            Chunks.emplace_back(Starts[Index], Starts[Index + 1]);
+        }
+    }
+
+    // calls handler with the text of each row in the chunk
+    template <typename THandler> void ForEachRow(std::size_t chunk, const THandler &handler){
+        const char *Cursor = Chunks[chunk].first;
+        const char *Limit = Chunks[chunk].second;
+        while(Cursor < Limit){
+            bool Quotes = false;
+            const char *RowEnd = DSVScanner::FindRowEnd(Cursor, Limit, Quotes);
+            handler(Cursor, RowEnd);
+            if(RowEnd == Limit){
+                break;
+            }
+            Cursor = RowEnd + 1;
+            if(*RowEnd == '\r' && Cursor != Limit && *Cursor == '\n'){
+                Cursor++;
+            }
+        }
+    }
+
+    bool ParseChunks(const TChunkCallback &callback){
+        if(!Valid){
+            return false;
+        }
+        Prepare();
+        RunParallel(Chunks.size(), [&](std::size_t chunk){
+            std::vector<std::size_t> Ends;
+            std::string Unquoted;
+            TRow Row;
+            ForEachRow(chunk, [&](const char *begin, const char *end){
+                Unquoted.clear();
+                Unquoted.reserve(end - begin);
+                DSVScanner::SplitRow(begin, end, Delimiter, Ends, Unquoted, Row);
+                callback(chunk, Row);
+            });
+        });
+        return true;
+    }
+
+    // workers parse chunks into per chunk storage while the calling thread
+    // hands finished chunks to the callback in input order, workers stay at
+    // most two chunks per thread ahead of the callback so memory is bounded
+    bool ParseOrdered(const TRowCallback &callback){
+        if(!Valid){
+            return false;
+        }
+        Prepare();
+        std::vector<SParsedChunk> Parsed(Chunks.size());
+        std::mutex Mutex;
+        std::condition_variable Condition;
+        std::size_t Next = 0; // next chunk a worker takes
+        std::size_t Delivered = 0; // chunks handed to the callback
+        std::size_t Window = Threads * 2;
+        bool Stop = false;
+        auto Worker = [&]{
+            std::vector<std::size_t> Ends;
+            TRow Row;
+            while(true){
+                std::size_t Chunk;
+                {
+                    std::unique_lock<std::mutex> Lock(Mutex);
+                    Condition.wait(Lock, [&]{ return Stop || Next >= Chunks.size() || Next < Delivered + Window; });
+                    if(Stop || Next >= Chunks.size()){
+                        return;
+                    }
+                    Chunk = Next++;
+                }
+                SParsedChunk &Result = Parsed[Chunk];
+                // copies of unquoted fields are bounded by the chunk, the room
+                // is only reserved once a field needs one
+                std::size_t Reserve = Chunks[Chunk].second - Chunks[Chunk].first;
+                ForEachRow(Chunk, [&](const char *begin, const char *end){
+                    DSVScanner::SplitRow(begin, end, Delimiter, Ends, Result.Unquoted, Row, Reserve);
+                    Result.Fields.insert(Result.Fields.end(), Row.begin(), Row.end());
+                    Result.RowEnds.push_back(Result.Fields.size());
+                });
+                std::lock_guard<std::mutex> Lock(Mutex);
+                Result.Done = true;
+                Condition.notify_all();
+            }
+        };
+        SPoolGuard Guard{{}, [&]{
+            std::lock_guard<std::mutex> Lock(Mutex);
+            Stop = true;
+            Condition.notify_all();
+        }};
+        for(std::size_t Index = 0; Index < std::min(Threads, Chunks.size()); Index++){
+            Guard.DPool.emplace_back(Worker);
+        }
+        TRow Row;
+        for(auto &Result : Parsed){
+            {
+                std::unique_lock<std::mutex> Lock(Mutex);
+                Condition.wait(Lock, [&]{ return Result.Done; });
+            }
+            std::size_t Start = 0;
+            for(auto RowEnd : Result.RowEnds){
+                Row.assign(Result.Fields.begin() + Start, Result.Fields.begin() + RowEnd);
+                callback(Row);
+                Start = RowEnd;
+            }
+            Result = SParsedChunk();
+            std::lock_guard<std::mutex> Lock(Mutex);
+            Delivered++;
+            Condition.notify_all();
+        }
+        return true;
+    }
+};
+
+// data must stay valid while the reader is used, threads of 0 uses one
+// worker per hardware thread, chunksize is the nominal bytes per chunk
+CParallelDSVReader::CParallelDSVReader(std::string_view data, char delimiter, std::size_t threads, std::size_t chunksize)
+    : DImplementation(std::make_unique<SImplementation>(data.data(), data.size(), delimiter, threads, chunksize)){
+
+}
+
+// parses the unread part of a mapped file, the mapping is kept alive
+CParallelDSVReader::CParallelDSVReader(std::shared_ptr< CMmapDataSource > src, char delimiter, std::size_t threads, std::size_t chunksize)
+    : DImplementation(std::make_unique<SImplementation>(src ? src->Data() + src->Position() : nullptr, src ? src->Size() - src->Position() : 0, delimiter, threads, chunksize)){
+    DImplementation->Mapping = src;
+    DImplementation->Valid = src && src->IsOpen();
+}
+
+CParallelDSVReader::~CParallelDSVReader() = default;
+
+// returns the number of row aligned chunks, some may be empty when a row is
+// longer than the chunk size
+std::size_t CParallelDSVReader::ChunkCount() const{
+    DImplementation->Prepare();
+    return DImplementation->Chunks.size();
+}
+
+// calls callback for every row, rows of one chunk arrive in order on one
+// thread but chunks are parsed concurrently, returns false if the input could
+// not be opened
+bool CParallelDSVReader::ParseChunks(const TChunkCallback &callback){
+    return DImplementation->ParseChunks(callback);
+}
+
+// calls callback for every row in input order on the calling thread while the
+// chunks are parsed in parallel, returns false if the input could not be opened
+bool CParallelDSVReader::ParseOrdered(const TRowCallback &callback){
+    return DImplementation->ParseOrdered(callback);
+}
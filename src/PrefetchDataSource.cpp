@@ -0,0 +1,208 @@
+#include "PrefetchDataSource.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+// a producer thread fills a ring of fixed size blocks from the wrapped source
+// while the consumer drains them, blocks are handed over through the head and
+// tail counters alone, the mutex is only taken when one side has to sleep
+struct CPrefetchDataSource::SImplementation{
+    struct SBlock{
+        std::vector<char> Data;
+        std::size_t Length = 0;
+    };
+
+    std::shared_ptr<CDataSource> Source;
+    std::vector<SBlock> Ring;
+    std::atomic<std::size_t> Head; // blocks published by the producer
+    std::atomic<std::size_t> Tail; // blocks released by the consumer
+    std::atomic<bool> Finished; // producer reached the end of the source
+    std::atomic<bool> Stop; // consumer is shutting down
+    std::atomic<bool> ProducerWaiting;
+    std::atomic<bool> ConsumerWaiting;
+    std::mutex Mutex;
+    std::condition_variable Condition;
+    std::thread Producer;
+
+    // consumer side view of the block at Tail
+    bool Holding;
+    const char *Cursor;
+    const char *Limit;
+
+    SImplementation(std::shared_ptr<CDataSource> src, std::size_t blocksize, std::size_t blockcount)
+        : Source(std::move(src)), Ring(std::max<std::size_t>(blockcount, 2)), Head(0), Tail(0), Finished(false), Stop(false),
+          ProducerWaiting(false), ConsumerWaiting(false), Holding(false), Cursor(nullptr), Limit(nullptr){
+        for(auto &Block : Ring){
+            Block.Data.resize(std::max<std::size_t>(blocksize, 1));
+        }
+        Producer = std::thread([this]{ Produce(); });
+    }
+
+    ~SImplementation(){
+        Halt();
+    }
+
+    void Halt(){
+        Stop = true;
+        Wake(ProducerWaiting);
+        if(Producer.joinable()){
+            Producer.join();
+        }
+    }
+
+    // stops the producer, repositions the wrapped source and starts reading
+    // ahead again from the new position with an empty ring, when the wrapped
+    // source cannot seek the ring is kept and reading carries on unchanged
+    bool Seek(std::size_t offset){
+        Halt();
+        Stop = false;
+        if(!Source->Seek(offset)){
+            if(!Finished){
+                Producer = std::thread([this]{ Produce(); });
+            }
+            return false;
+        }
+        Head = 0;
+        Tail = 0;
+        Finished = false;
+        Holding = false;
+        Cursor = nullptr;
+        Limit = nullptr;
+        Producer = std::thread([this]{ Produce(); });
+        return true;
+    }
+
+    // wakes the other side if it announced that it is about to sleep
+    void Wake(std::atomic<bool> &waiting){
+        if(waiting.load()){
+            std::lock_guard<std::mutex> Lock(Mutex);
+            Condition.notify_all();
+        }
+    }
+
+    // sleeps until ready() holds, the flag is raised before the final check so
+    // a concurrent Wake cannot be lost
+    template <typename TPredicate> void Wait(std::atomic<bool> &waiting, TPredicate ready){
+        if(ready()){
+            return;
+        }
+        std::unique_lock<std::mutex> Lock(Mutex);
+        waiting = true;
+        while(!ready()){
+            Condition.wait(Lock);
+        }
+        waiting = false;
+    }
+
+    void Produce(){
+        while(true){
+            Wait(ProducerWaiting, [this]{ return Stop.load() || Head.load() - Tail.load() < Ring.size(); });
+            if(Stop){
+                break;
+            }
+            SBlock &Block = Ring[Head.load() % Ring.size()];
+            Block.Length = Source->ReadBlock(Block.Data.data(), Block.Data.size());
+            if(!Block.Length){
+                Finished = true;
+                Wake(ConsumerWaiting);
+                break;
+            }
+            Head++;
+            Wake(ConsumerWaiting);
+        }
+    }
+
+    // releases the block being read and moves to the next one, returns false
+    // once the producer has delivered everything
+    bool NextBlock(){
+        if(Holding){
+            Holding = false;
+            Tail++;
+            Wake(ProducerWaiting);
+        }
+        Wait(ConsumerWaiting, [this]{ return Head.load() != Tail.load() || Finished.load(); });
+        if(Head.load() == Tail.load()){
+            return false;
+        }
+        const SBlock &Block = Ring[Tail.load() % Ring.size()];
+        Holding = true;
+        Cursor = Block.Data.data();
+        Limit = Cursor + Block.Length;
+        return true;
+    }
+
+    bool Available(){
+        return Cursor != Limit || NextBlock();
+    }
+
+    std::size_t ReadBlock(char *buf, std::size_t count){
+        std::size_t Total = 0;
+        while(Total < count && Available()){
+            std::size_t Length = std::min<std::size_t>(count - Total, Limit - Cursor);
+            std::memcpy(buf + Total, Cursor, Length);
+            Cursor += Length;
+            Total += Length;
+        }
+        return Total;
+    }
+};
+
+// wraps src, blockcount blocks of blocksize bytes are read ahead of the consumer
+CPrefetchDataSource::CPrefetchDataSource(std::shared_ptr< CDataSource > src, std::size_t blocksize, std::size_t blockcount)
+    : DImplementation(std::make_unique<SImplementation>(std::move(src), blocksize, blockcount)){
+
+}
+
+CPrefetchDataSource::~CPrefetchDataSource() = default;
+
+// may wait for the producer to find out whether another block follows
+bool CPrefetchDataSource::End() const noexcept{
+    return !DImplementation->Available();
+}
+
+bool CPrefetchDataSource::Get(char &ch) noexcept{
+    if(!DImplementation->Available()){
+        return false;
+    }
+    ch = *DImplementation->Cursor++;
+    return true;
+}
+
+bool CPrefetchDataSource::Peek(char &ch) noexcept{
+    if(!DImplementation->Available()){
+        return false;
+    }
+    ch = *DImplementation->Cursor;
+    return true;
+}
+
+bool CPrefetchDataSource::Read(std::vector<char> &buf, std::size_t count) noexcept{
+    buf.resize(count);
+    buf.resize(DImplementation->ReadBlock(buf.data(), count));
+    return !buf.empty();
+}
+
+std::size_t CPrefetchDataSource::ReadBlock(char *buf, std::size_t count) noexcept{
+    return DImplementation->ReadBlock(buf, count);
+}
+
+// lends the remainder of the current block, it stays valid until the next
+// call moves past it
+std::size_t CPrefetchDataSource::Borrow(const char *&data, std::size_t count) noexcept{
+    if(!DImplementation->Available()){
+        return 0;
+    }
+    std::size_t Length = std::min<std::size_t>(count, DImplementation->Limit - DImplementation->Cursor);
+    data = DImplementation->Cursor;
+    DImplementation->Cursor += Length;
+    return Length;
+}
+
+// discards everything read ahead, fails without losing any of it when the
+// wrapped source cannot seek
+bool CPrefetchDataSource::Seek(std::size_t offset) noexcept{
+    return DImplementation->Seek(offset);
+}
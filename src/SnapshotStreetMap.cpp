@@ -0,0 +1,652 @@
+#include "SnapshotStreetMap.h"
+#include "IDIndex.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <zlib.h>
+
+namespace{
+
+const char SnapshotMagic[8] = {'O', 'S', 'M', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t ByteOrderMark = 0x01020304; // reads back differently on a host of the other byte order
+
+// the file starts with the header, the sections follow in the order of the
+// counts, each a native array padded to a multiple of 8 bytes:
+// node ids, lats, lons, tagged node positions, attribute starts (one extra)
+// and key value pairs, the node index keys and positions, way ids, node ref
+// starts (one extra), node refs, attribute starts (one extra) and key value
+// pairs, the way index keys and positions, string starts (one extra), string
+// ids in text order and the string bytes, the checksum is a crc32 of the
+// header with the checksum field zeroed followed by all the sections
+struct SHeader{
+    char DMagic[8];
+    uint32_t DVersion;
+    uint32_t DByteOrder;
+    uint64_t DNodeCount;
+    uint64_t DTaggedNodeCount;
+    uint64_t DNodeAttributeCount;
+    uint64_t DNodeIndexSlots;
+    uint64_t DWayCount;
+    uint64_t DWayNodeCount;
+    uint64_t DWayAttributeCount;
+    uint64_t DWayIndexSlots;
+    uint64_t DStringCount;
+    uint64_t DStringBytes;
+    uint32_t DChecksum;
+    uint32_t DReserved;
+};
+
+struct SKeyValue{
+    uint32_t DKey;
+    uint32_t DValue;
+};
+
+const char Padding[8] = {}; // zeros that pad each section to a multiple of 8 bytes
+const std::size_t WriteBatchSize = 1024 * 1024; // bytes handed to the sink per write
+
+// crc32 of the header with the checksum field zeroed, the sections continue it
+uLong HeaderChecksum(SHeader header){
+    header.DChecksum = 0;
+    return crc32(0L, reinterpret_cast<const Bytef *>(&header), sizeof(SHeader));
+}
+
+// crc32 takes 32 bit lengths, so large sections are fed in pieces
+uLong UpdateChecksum(uLong crc, const char *data, uint64_t length){
+    while(length){
+        uInt Piece = static_cast<uInt>(std::min<uint64_t>(length, 1 << 30));
+        crc = crc32(crc, reinterpret_cast<const Bytef *>(data), Piece);
+        data += Piece;
+        length -= Piece;
+    }
+    return crc;
+}
+
+// points out at the next section of count values, false if the file is too
+// short for it
+template <typename TValue> bool TakeArray(const char *&cursor, const char *end, uint64_t count, const TValue *&out){
+    uint64_t Available = static_cast<uint64_t>(end - cursor);
+    if(count > Available / sizeof(TValue)){
+        return false;
+    }
+    uint64_t Length = (count * sizeof(TValue) + 7) & ~uint64_t(7);
+    if(Length > Available){
+        return false;
+    }
+    out = reinterpret_cast<const TValue *>(cursor);
+    cursor += Length;
+    return true;
+}
+
+// starts of count runs in an array of total values, first zero, last total
+// and never decreasing
+bool ValidStarts(const uint64_t *starts, uint64_t count, uint64_t total){
+    if(starts[0] || starts[count] != total){
+        return false;
+    }
+    for(uint64_t Index = 0; Index < count; Index++){
+        if(starts[Index] > starts[Index + 1]){
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ValidKeyValues(const SKeyValue *pairs, uint64_t count, uint64_t strings){
+    for(uint64_t Index = 0; Index < count; Index++){
+        if(pairs[Index].DKey >= strings || pairs[Index].DValue >= strings){
+            return false;
+        }
+    }
+    return true;
+}
+
+// keys of each element's run of attributes in key order, the runs have to
+// be checked with ValidStarts first
+bool ValidAttributeOrder(const SKeyValue *pairs, const uint64_t *starts, uint64_t count){
+    for(uint64_t Index = 0; Index < count; Index++){
+        for(uint64_t Pair = starts[Index] + 1; Pair < starts[Index + 1]; Pair++){
+            if(pairs[Pair].DKey < pairs[Pair - 1].DKey){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool ValidPositions(const uint64_t *positions, uint64_t slots, uint64_t count){
+    for(uint64_t Slot = 1; Slot < slots; Slot++){
+        if(positions[Slot] >= count){
+            return false;
+        }
+    }
+    return true;
+}
+
+// walks the 1 based Eytzinger keys in order, the search only finds every id
+// if they come out strictly increasing
+bool ValidEytzinger(const uint64_t *keys, uint64_t slots){
+    uint64_t Slot = 1;
+    while(Slot * 2 < slots){
+        Slot *= 2;
+    }
+    for(uint64_t Visited = 1; Visited < slots; Visited++){
+        uint64_t Key = keys[Slot];
+        if(Slot * 2 + 1 < slots){
+            // the next key is the leftmost one below the right child
+            Slot = Slot * 2 + 1;
+            while(Slot * 2 < slots){
+                Slot *= 2;
+            }
+        }
+        else{
+            // the next key is the first ancestor reached from its left side
+            while(Slot & 1){
+                Slot >>= 1;
+            }
+            Slot >>= 1;
+        }
+        if(Visited + 1 < slots && keys[Slot] <= Key){
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+// the mapped file and the arrays in it, shared with the node and way handles
+// so they stay valid after the map is gone
+struct CSnapshotStreetMap::SImplementation{
+    struct SSnapshot;
+    struct SAttributes;
+    class SNodeHandle;
+    class SWayHandle;
+
+    std::shared_ptr<const SSnapshot> Snapshot;
+
+    SImplementation(std::shared_ptr<CMmapDataSource> src, bool verify);
+};
+
+struct CSnapshotStreetMap::SImplementation::SSnapshot{
+    std::shared_ptr<CMmapDataSource> Source;
+    SHeader Header;
+    const uint64_t *NodeIDs;
+    const double *NodeLats;
+    const double *NodeLons;
+    const uint64_t *TaggedNodes;
+    const uint64_t *NodeAttributeStarts;
+    const SKeyValue *NodeAttributes;
+    const uint64_t *NodeIndexKeys;
+    const uint64_t *NodeIndexPositions;
+    const uint64_t *WayIDs;
+    const uint64_t *WayNodeStarts;
+    const uint64_t *WayNodes;
+    const uint64_t *WayAttributeStarts;
+    const SKeyValue *WayAttributes;
+    const uint64_t *WayIndexKeys;
+    const uint64_t *WayIndexPositions;
+    const uint64_t *StringStarts;
+    const uint32_t *SortedStrings;
+    const char *StringBytes;
+
+    // lays the arrays over the mapped file, the sizes always have to fit the
+    // file, verify also checks the checksum, that every stored position and
+    // string id is in range and that the sorted strings, the index keys and
+    // the attribute keys are in order, without it the file is trusted
+    bool Map(bool verify){
+        const char *Begin = Source->Data();
+        const char *End = Begin + Source->Size();
+        if(Source->Size() < sizeof(SHeader)){
+            return false;
+        }
+        std::memcpy(&Header, Begin, sizeof(SHeader));
+        if(std::memcmp(Header.DMagic, SnapshotMagic, sizeof(SnapshotMagic)) || Header.DVersion != Version || Header.DByteOrder != ByteOrderMark){
+            return false;
+        }
+        const char *Cursor = Begin + sizeof(SHeader);
+        bool Fits = TakeArray(Cursor, End, Header.DNodeCount, NodeIDs)
+            && TakeArray(Cursor, End, Header.DNodeCount, NodeLats)
+            && TakeArray(Cursor, End, Header.DNodeCount, NodeLons)
+            && TakeArray(Cursor, End, Header.DTaggedNodeCount, TaggedNodes)
+            && TakeArray(Cursor, End, Header.DTaggedNodeCount + 1, NodeAttributeStarts)
+            && TakeArray(Cursor, End, Header.DNodeAttributeCount, NodeAttributes)
+            && TakeArray(Cursor, End, Header.DNodeIndexSlots, NodeIndexKeys)
+            && TakeArray(Cursor, End, Header.DNodeIndexSlots, NodeIndexPositions)
+            && TakeArray(Cursor, End, Header.DWayCount, WayIDs)
+            && TakeArray(Cursor, End, Header.DWayCount + 1, WayNodeStarts)
+            && TakeArray(Cursor, End, Header.DWayNodeCount, WayNodes)
+            && TakeArray(Cursor, End, Header.DWayCount + 1, WayAttributeStarts)
+            && TakeArray(Cursor, End, Header.DWayAttributeCount, WayAttributes)
+            && TakeArray(Cursor, End, Header.DWayIndexSlots, WayIndexKeys)
+            && TakeArray(Cursor, End, Header.DWayIndexSlots, WayIndexPositions)
+            && TakeArray(Cursor, End, Header.DStringCount + 1, StringStarts)
+            && TakeArray(Cursor, End, Header.DStringCount, SortedStrings)
+            && TakeArray(Cursor, End, Header.DStringBytes, StringBytes);
+        if(!Fits || Cursor != End || !Header.DNodeIndexSlots || !Header.DWayIndexSlots){
+            return false;
+        }
+        if(Header.DNodeIndexSlots > Header.DNodeCount + 1 || Header.DWayIndexSlots > Header.DWayCount + 1 || Header.DTaggedNodeCount > Header.DNodeCount){
+            return false;
+        }
+        if(!verify){
+            return true;
+        }
+        const char *Sections = Begin + sizeof(SHeader);
+        if(UpdateChecksum(HeaderChecksum(Header), Sections, End - Sections) != Header.DChecksum){
+            return false;
+        }
+        for(uint64_t Index = 0; Index < Header.DTaggedNodeCount; Index++){
+            if(TaggedNodes[Index] >= Header.DNodeCount || (Index && TaggedNodes[Index] <= TaggedNodes[Index - 1])){
+                return false;
+            }
+        }
+        for(uint64_t Index = 0; Index < Header.DStringCount; Index++){
+            if(SortedStrings[Index] >= Header.DStringCount){
+                return false;
+            }
+        }
+        bool Valid = ValidStarts(NodeAttributeStarts, Header.DTaggedNodeCount, Header.DNodeAttributeCount)
+            && ValidStarts(WayNodeStarts, Header.DWayCount, Header.DWayNodeCount)
+            && ValidStarts(WayAttributeStarts, Header.DWayCount, Header.DWayAttributeCount)
+            && ValidStarts(StringStarts, Header.DStringCount, Header.DStringBytes)
+            && ValidKeyValues(NodeAttributes, Header.DNodeAttributeCount, Header.DStringCount)
+            && ValidKeyValues(WayAttributes, Header.DWayAttributeCount, Header.DStringCount)
+            && ValidPositions(NodeIndexPositions, Header.DNodeIndexSlots, Header.DNodeCount)
+            && ValidPositions(WayIndexPositions, Header.DWayIndexSlots, Header.DWayCount);
+        // the searches rely on the order, checked once the ranges are known good
+        if(!Valid || !ValidAttributeOrder(NodeAttributes, NodeAttributeStarts, Header.DTaggedNodeCount) || !ValidAttributeOrder(WayAttributes, WayAttributeStarts, Header.DWayCount)){
+            return false;
+        }
+        for(uint64_t Index = 1; Index < Header.DStringCount; Index++){
+            if(String(SortedStrings[Index]) <= String(SortedStrings[Index - 1])){
+                return false;
+            }
+        }
+        return ValidEytzinger(NodeIndexKeys, Header.DNodeIndexSlots) && ValidEytzinger(WayIndexKeys, Header.DWayIndexSlots);
+    }
+
+    std::string_view String(uint32_t id) const noexcept{
+        return std::string_view(StringBytes + StringStarts[id], StringStarts[id + 1] - StringStarts[id]);
+    }
+
+    // binary searches the strings in text order, returns false if the string
+    // is not in the snapshot
+    bool FindString(std::string_view str, uint32_t &id) const noexcept{
+        const uint32_t *End = SortedStrings + Header.DStringCount;
+        const uint32_t *Found = std::lower_bound(SortedStrings, End, str, [this](uint32_t candidate, std::string_view str){
+            return String(candidate) < str;
+        });
+        if(Found == End || String(*Found) != str){
+            return false;
+        }
+        id = *Found;
+        return true;
+    }
+
+    SAttributes NodeAttributeList(std::size_t node) const noexcept;
+    SAttributes WayAttributeList(std::size_t way) const noexcept;
+};
+
+// attributes of one node or way, sorted by key id
+struct CSnapshotStreetMap::SImplementation::SAttributes{
+    const SSnapshot *Snapshot;
+    const SKeyValue *Data;
+    std::size_t Count;
+
+    const SKeyValue *Find(const std::string &key) const noexcept{
+        uint32_t Id;
+        if(!Count || !Snapshot->FindString(key, Id)){
+            return nullptr;
+        }
+        const SKeyValue *End = Data + Count;
+        const SKeyValue *Found = std::lower_bound(Data, End, Id, [](const SKeyValue &attribute, uint32_t key){
+            return attribute.DKey < key;
+        });
+        return Found != End && Found->DKey == Id ? Found : nullptr;
+    }
+
+    std::string Key(std::size_t index) const noexcept{
+        return index < Count ? std::string(Snapshot->String(Data[index].DKey)) : "";
+    }
+
+    std::string Value(const std::string &key) const noexcept{
+        const SKeyValue *Attribute = Find(key);
+        return Attribute ? std::string(Snapshot->String(Attribute->DValue)) : "";
+    }
+};
+
+CSnapshotStreetMap::SImplementation::SAttributes CSnapshotStreetMap::SImplementation::SSnapshot::NodeAttributeList(std::size_t node) const noexcept{
+    const uint64_t *End = TaggedNodes + Header.DTaggedNodeCount;
+    const uint64_t *Found = std::lower_bound(TaggedNodes, End, node);
+    if(Found == End || *Found != node){
+        return {this, nullptr, 0};
+    }
+    std::size_t Tagged = Found - TaggedNodes;
+    return {this, NodeAttributes + NodeAttributeStarts[Tagged], static_cast<std::size_t>(NodeAttributeStarts[Tagged + 1] - NodeAttributeStarts[Tagged])};
+}
+
+CSnapshotStreetMap::SImplementation::SAttributes CSnapshotStreetMap::SImplementation::SSnapshot::WayAttributeList(std::size_t way) const noexcept{
+    return {this, WayAttributes + WayAttributeStarts[way], static_cast<std::size_t>(WayAttributeStarts[way + 1] - WayAttributeStarts[way])};
+}
+
+class CSnapshotStreetMap::SImplementation::SNodeHandle : public CStreetMap::SNode{
+    public:
+        std::shared_ptr<const SSnapshot> DSnapshot;
+        std::size_t DIndex;
+
+        SNodeHandle(std::shared_ptr<const SSnapshot> snapshot, std::size_t index) : DSnapshot(std::move(snapshot)), DIndex(index){}
+
+        TNodeID ID() const noexcept override{
+            return DSnapshot->NodeIDs[DIndex];
+        }
+
+        TLocation Location() const noexcept override{
+            return {DSnapshot->NodeLats[DIndex], DSnapshot->NodeLons[DIndex]};
+        }
+
+        std::size_t AttributeCount() const noexcept override{
+            return DSnapshot->NodeAttributeList(DIndex).Count;
+        }
+
+        std::string GetAttributeKey(std::size_t index) const noexcept override{
+            return DSnapshot->NodeAttributeList(DIndex).Key(index);
+        }
+
+        bool HasAttribute(const std::string &key) const noexcept override{
+            return DSnapshot->NodeAttributeList(DIndex).Find(key) != nullptr;
+        }
+
+        std::string GetAttribute(const std::string &key) const noexcept override{
+            return DSnapshot->NodeAttributeList(DIndex).Value(key);
+        }
+};
+
+class CSnapshotStreetMap::SImplementation::SWayHandle : public CStreetMap::SWay{
+    public:
+        std::shared_ptr<const SSnapshot> DSnapshot;
+        std::size_t DIndex;
+
+        SWayHandle(std::shared_ptr<const SSnapshot> snapshot, std::size_t index) : DSnapshot(std::move(snapshot)), DIndex(index){}
+
+        TWayID ID() const noexcept override{
+            return DSnapshot->WayIDs[DIndex];
+        }
+
+        std::size_t NodeCount() const noexcept override{
+            return DSnapshot->WayNodeStarts[DIndex + 1] - DSnapshot->WayNodeStarts[DIndex];
+        }
+
+        TNodeID GetNodeID(std::size_t index) const noexcept override{
+            if(index < NodeCount()){
+                return DSnapshot->WayNodes[DSnapshot->WayNodeStarts[DIndex] + index];
+            }
+            return CStreetMap::InvalidNodeID;
+        }
+
+        std::size_t AttributeCount() const noexcept override{
+            return DSnapshot->WayAttributeList(DIndex).Count;
+        }
+
+        std::string GetAttributeKey(std::size_t index) const noexcept override{
+            return DSnapshot->WayAttributeList(DIndex).Key(index);
+        }
+
+        bool HasAttribute(const std::string &key) const noexcept override{
+            return DSnapshot->WayAttributeList(DIndex).Find(key) != nullptr;
+        }
+
+        std::string GetAttribute(const std::string &key) const noexcept override{
+            return DSnapshot->WayAttributeList(DIndex).Value(key);
+        }
+};
+
+CSnapshotStreetMap::SImplementation::SImplementation(std::shared_ptr<CMmapDataSource> src, bool verify){
+    if(!src || !src->IsOpen()){
+        return;
+    }
+    auto Mapped = std::make_shared<SSnapshot>();
+    Mapped->Source = std::move(src);
+    if(Mapped->Map(verify)){
+        // lookups touch scattered pages from here on, so readahead would only
+        // pull in and then evict pages nobody asked for
+        Mapped->Source->Advise(CMmapDataSource::EAccess::Random);
+        Snapshot = std::move(Mapped);
+    }
+}
+
+// serves the map from a snapshot written by Write, verify checks the checksum
+// and the stored positions and order, which reads the whole file once,
+// skipping it trusts the file, so a damaged file can then give wrong answers
+// or read out of bounds, a map that fails to open is empty and not valid,
+// src is best opened with random access so opening does not read the file
+// ahead
+CSnapshotStreetMap::CSnapshotStreetMap(std::shared_ptr<CMmapDataSource> src, bool verify) : DImplementation(std::make_unique<SImplementation>(std::move(src), verify)){
+
+}
+
+CSnapshotStreetMap::~CSnapshotStreetMap() = default;
+
+// writes the nodes, ways and attributes of any street map as a snapshot,
+// the attribute strings are interned and numbered in text order so each
+// element's attributes are ordered by key as in the maps, the sections are
+// checksummed and then written one after another so only the arrays
+// themselves are held, returns false if the sink fails
+bool CSnapshotStreetMap::Write(const CStreetMap &map, std::shared_ptr<CDataSink> sink){
+    if(!sink){
+        return false;
+    }
+    // each string is held once, the table is keyed by views of the strings,
+    // which a deque never moves
+    std::deque<std::string> Strings;
+    std::unordered_map<std::string_view, uint32_t> StringIDs;
+    auto Intern = [&](std::string str){
+        auto Found = StringIDs.find(str);
+        if(Found != StringIDs.end()){
+            return Found->second;
+        }
+        uint32_t ID = static_cast<uint32_t>(Strings.size());
+        Strings.push_back(std::move(str));
+        StringIDs.emplace(Strings.back(), ID);
+        return ID;
+    };
+    // interns the attributes of one element and appends them, they are put
+    // in key order once the strings are numbered
+    auto AppendAttributes = [&](const auto &element, std::vector<SKeyValue> &out){
+        for(std::size_t Index = 0; Index < element.AttributeCount(); Index++){
+            std::string Key = element.GetAttributeKey(Index);
+            std::string Value = element.GetAttribute(Key);
+            uint32_t KeyID = Intern(std::move(Key));
+            out.push_back({KeyID, Intern(std::move(Value))});
+        }
+        return element.AttributeCount() != 0;
+    };
+
+    std::vector<uint64_t> NodeIDs, TaggedNodes, NodeAttributeStarts(1, 0);
+    std::vector<double> NodeLats, NodeLons;
+    std::vector<SKeyValue> NodeAttributes;
+    for(std::size_t Index = 0; Index < map.NodeCount(); Index++){
+        auto Node = map.NodeByIndex(Index);
+        NodeIDs.push_back(Node->ID());
+        NodeLats.push_back(Node->Location().first);
+        NodeLons.push_back(Node->Location().second);
+        if(AppendAttributes(*Node, NodeAttributes)){
+            TaggedNodes.push_back(Index);
+            NodeAttributeStarts.push_back(NodeAttributes.size());
+        }
+    }
+    std::vector<uint64_t> WayIDs, WayNodeStarts(1, 0), WayNodes, WayAttributeStarts(1, 0);
+    std::vector<SKeyValue> WayAttributes;
+    for(std::size_t Index = 0; Index < map.WayCount(); Index++){
+        auto Way = map.WayByIndex(Index);
+        WayIDs.push_back(Way->ID());
+        for(std::size_t Node = 0; Node < Way->NodeCount(); Node++){
+            WayNodes.push_back(Way->GetNodeID(Node));
+        }
+        WayNodeStarts.push_back(WayNodes.size());
+        AppendAttributes(*Way, WayAttributes);
+        WayAttributeStarts.push_back(WayAttributes.size());
+    }
+    CIDIndex NodeIndex(CIDIndex::EKind::Eytzinger), WayIndex(CIDIndex::EKind::Eytzinger);
+    NodeIndex.Build(NodeIDs);
+    WayIndex.Build(WayIDs);
+    // the lookup table is not needed to write the strings
+    StringIDs = std::unordered_map<std::string_view, uint32_t>();
+    std::vector<uint32_t> SortedStrings(Strings.size());
+    for(uint32_t Index = 0; Index < SortedStrings.size(); Index++){
+        SortedStrings[Index] = Index;
+    }
+    std::sort(SortedStrings.begin(), SortedStrings.end(), [&](uint32_t left, uint32_t right){
+        return Strings[left] < Strings[right];
+    });
+    // the strings are renumbered in text order and written in that order, so
+    // ordering a run of attributes by key id orders it by key
+    std::vector<uint32_t> Renumbered(Strings.size());
+    for(uint32_t Index = 0; Index < SortedStrings.size(); Index++){
+        Renumbered[SortedStrings[Index]] = Index;
+    }
+    auto RenumberAttributes = [&](std::vector<SKeyValue> &pairs, const std::vector<uint64_t> &starts){
+        for(auto &Pair : pairs){
+            Pair = {Renumbered[Pair.DKey], Renumbered[Pair.DValue]};
+        }
+        for(std::size_t Index = 0; Index + 1 < starts.size(); Index++){
+            std::sort(pairs.begin() + starts[Index], pairs.begin() + starts[Index + 1], [](const SKeyValue &left, const SKeyValue &right){
+                return left.DKey < right.DKey;
+            });
+        }
+    };
+    RenumberAttributes(NodeAttributes, NodeAttributeStarts);
+    RenumberAttributes(WayAttributes, WayAttributeStarts);
+    Renumbered = std::vector<uint32_t>();
+    std::vector<uint64_t> StringStarts(1, 0);
+    for(auto ID : SortedStrings){
+        StringStarts.push_back(StringStarts.back() + Strings[ID].size());
+    }
+    // after renumbering the ids in text order simply count up
+    std::vector<uint32_t> TextOrderIDs(Strings.size());
+    for(uint32_t Index = 0; Index < TextOrderIDs.size(); Index++){
+        TextOrderIDs[Index] = Index;
+    }
+
+    // hands the sections to emit in file order, each padded to 8 bytes
+    auto EmitSections = [&](const auto &emit){
+        auto Array = [&](const auto *data, std::size_t count){
+            std::size_t Length = count * sizeof(*data);
+            emit(reinterpret_cast<const char *>(data), Length);
+            emit(Padding, (8 - Length % 8) % 8);
+        };
+        Array(NodeIDs.data(), NodeIDs.size());
+        Array(NodeLats.data(), NodeLats.size());
+        Array(NodeLons.data(), NodeLons.size());
+        Array(TaggedNodes.data(), TaggedNodes.size());
+        Array(NodeAttributeStarts.data(), NodeAttributeStarts.size());
+        Array(NodeAttributes.data(), NodeAttributes.size());
+        Array(NodeIndex.Keys(), NodeIndex.SlotCount());
+        Array(NodeIndex.Positions(), NodeIndex.SlotCount());
+        Array(WayIDs.data(), WayIDs.size());
+        Array(WayNodeStarts.data(), WayNodeStarts.size());
+        Array(WayNodes.data(), WayNodes.size());
+        Array(WayAttributeStarts.data(), WayAttributeStarts.size());
+        Array(WayAttributes.data(), WayAttributes.size());
+        Array(WayIndex.Keys(), WayIndex.SlotCount());
+        Array(WayIndex.Positions(), WayIndex.SlotCount());
+        Array(StringStarts.data(), StringStarts.size());
+        Array(TextOrderIDs.data(), TextOrderIDs.size());
+        for(auto ID : SortedStrings){
+            emit(Strings[ID].data(), Strings[ID].size());
+        }
+        emit(Padding, (8 - StringStarts.back() % 8) % 8);
+    };
+
+    SHeader Header{};
+    std::memcpy(Header.DMagic, SnapshotMagic, sizeof(SnapshotMagic));
+    Header.DVersion = Version;
+    Header.DByteOrder = ByteOrderMark;
+    Header.DNodeCount = NodeIDs.size();
+    Header.DTaggedNodeCount = TaggedNodes.size();
+    Header.DNodeAttributeCount = NodeAttributes.size();
+    Header.DNodeIndexSlots = NodeIndex.SlotCount();
+    Header.DWayCount = WayIDs.size();
+    Header.DWayNodeCount = WayNodes.size();
+    Header.DWayAttributeCount = WayAttributes.size();
+    Header.DWayIndexSlots = WayIndex.SlotCount();
+    Header.DStringCount = Strings.size();
+    Header.DStringBytes = StringStarts.back();
+    uLong Crc = HeaderChecksum(Header);
+    EmitSections([&](const char *data, std::size_t length){
+        Crc = UpdateChecksum(Crc, data, length);
+    });
+    Header.DChecksum = static_cast<uint32_t>(Crc);
+
+    // the header and sections go to the sink through one bounded buffer
+    std::vector<char> Buffer(reinterpret_cast<const char *>(&Header), reinterpret_cast<const char *>(&Header) + sizeof(SHeader));
+    Buffer.reserve(WriteBatchSize);
+    bool Success = true;
+    EmitSections([&](const char *data, std::size_t length){
+        while(length && Success){
+            std::size_t Piece = std::min(length, WriteBatchSize - Buffer.size());
+            Buffer.insert(Buffer.end(), data, data + Piece);
+            data += Piece;
+            length -= Piece;
+            if(Buffer.size() == WriteBatchSize){
+                Success = sink->Write(Buffer);
+                Buffer.clear();
+            }
+        }
+    });
+    return Success && (Buffer.empty() || sink->Write(Buffer)) && sink->Flush();
+}
+
+bool CSnapshotStreetMap::IsValid() const noexcept{
+    return DImplementation->Snapshot != nullptr;
+}
+
+std::size_t CSnapshotStreetMap::NodeCount() const noexcept{
+    return DImplementation->Snapshot ? DImplementation->Snapshot->Header.DNodeCount : 0;
+}
+
+std::size_t CSnapshotStreetMap::WayCount() const noexcept{
+    return DImplementation->Snapshot ? DImplementation->Snapshot->Header.DWayCount : 0;
+}
+
+std::shared_ptr<CStreetMap::SNode> CSnapshotStreetMap::NodeByIndex(std::size_t index) const noexcept{
+    if(index < NodeCount()){
+        return std::make_shared<SImplementation::SNodeHandle>(DImplementation->Snapshot, index);
+    }
+    return nullptr;
+}
+
+// looks the id up in the Eytzinger index stored in the snapshot
+std::shared_ptr<CStreetMap::SNode> CSnapshotStreetMap::NodeByID(TNodeID id) const noexcept{
+    const auto &Snapshot = DImplementation->Snapshot;
+    if(!Snapshot){
+        return nullptr;
+    }
+    std::size_t Index = CIDIndex::FindEytzinger(Snapshot->NodeIndexKeys, Snapshot->NodeIndexPositions, Snapshot->Header.DNodeIndexSlots, id);
+    if(Index == CIDIndex::NotFound){
+        return nullptr;
+    }
+    return std::make_shared<SImplementation::SNodeHandle>(Snapshot, Index);
+}
+
+std::shared_ptr<CStreetMap::SWay> CSnapshotStreetMap::WayByIndex(std::size_t index) const noexcept{
+    if(index < WayCount()){
+        return std::make_shared<SImplementation::SWayHandle>(DImplementation->Snapshot, index);
+    }
+    return nullptr;
+}
+
+std::shared_ptr<CStreetMap::SWay> CSnapshotStreetMap::WayByID(TWayID id) const noexcept{
+    const auto &Snapshot = DImplementation->Snapshot;
+    if(!Snapshot){
+        return nullptr;
+    }
+    std::size_t Index = CIDIndex::FindEytzinger(Snapshot->WayIndexKeys, Snapshot->WayIndexPositions, Snapshot->Header.DWayIndexSlots, id);
+    if(Index == CIDIndex::NotFound){
+        return nullptr;
+    }
+    return std::make_shared<SImplementation::SWayHandle>(Snapshot, Index);
+}
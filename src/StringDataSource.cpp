@@ -1,4 +1,6 @@
 #include "StringDataSource.h"
+#include <algorithm>
+#include <cstring>
 
 CStringDataSource::CStringDataSource(const std::string &str) : DString(str), DIndex(0){
 
@@ -26,15 +28,32 @@ bool CStringDataSource::Peek(char &ch) noexcept{
 }
 
 bool CStringDataSource::Read(std::vector<char> &buf, std::size_t count) noexcept{
-    buf.clear();
-    while(buf.size() < count){
-        char TempChar;
-        if(Get(TempChar)){
-            buf.push_back(TempChar);
-        }
-        else{
-            break;
-        }
-    }
+    std::size_t Length = std::min(count, DString.length() - std::min(DIndex, DString.length()));
+    buf.assign(DString.data() + DIndex, DString.data() + DIndex + Length);
+    DIndex += Length;
     return !buf.empty();
 }
+
+std::size_t CStringDataSource::ReadBlock(char *buf, std::size_t count) noexcept{
+    std::size_t Length = std::min(count, DString.length() - std::min(DIndex, DString.length()));
+    std::memcpy(buf, DString.data() + DIndex, Length);
+    DIndex += Length;
+    return Length;
+}
+
+// the string is owned by the source so borrowed data stays valid for the
+// lifetime of the source
+std::size_t CStringDataSource::Borrow(const char *&data, std::size_t count) noexcept{
+    std::size_t Length = std::min(count, DString.length() - std::min(DIndex, DString.length()));
+    data = DString.data() + DIndex;
+    DIndex += Length;
+    return Length;
+}
+
+bool CStringDataSource::Seek(std::size_t offset) noexcept{
+    if(offset > DString.length()){
+        return false;
+    }
+    DIndex = offset;
+    return true;
+}
@@ -1,60 +1,163 @@
 #include "XMLReader.h"
+#include "PrefetchDataSource.h"
+#include "OSMXMLTokenizer.h"
 #include <expat.h>
-#include <queue>
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <unordered_map>
 #include <memory>
+#include <typeinfo>
 #include <vector>
 
-struct CXMLReader::SImplementation {
+struct CXMLReader::SImplementation : public COSMXMLTokenizer::SHandler {
+    static const size_t InitialQueueSize = 64; // queue slots, doubled whenever the ring fills up
+    static const size_t NotSkipping = std::numeric_limits<size_t>::max(); // SkipDepth when no subtree is being dropped
+    static const size_t ReservedSymbols = 256; // ids only Symbol and SetFilter may take, so a document cannot use them all up
+
     std::shared_ptr<CDataSource> Source;  // source for XML data stream
     XML_Parser Parser; // parser object from the Expat library
-    std::queue<SXMLEntity> Queue; // queue to hold parsed XML entities
+    std::vector<SXMLEntity> Queue; // ring of parsed XML entities, slots are reused
+    size_t QueueHead; // slot of the oldest queued entity
+    size_t QueueCount; // number of queued entities
     bool Data; // flag to check if data parsing is complete
     std::string Buffer; // buffer to accumulate text data between XML tags
+    size_t BlockSize; // bytes handed to the parser per refill
+    CXMLVisitor *Visitor; // receives events directly instead of the queue while visiting
+    bool SkipCharData; // character data is dropped while visiting
+    std::vector<CXMLVisitor::TAttribute> Attributes; // attribute views handed to the visitor
+    std::vector<SXMLEntity::TSymbolID> AttributeIDs; // attribute name symbols handed to the visitor
+    std::deque<std::string> SymbolNames; // interned names, indexed by symbol id
+    std::unordered_map<std::string_view, SXMLEntity::TSymbolID> SymbolTable; // maps names to symbol ids
+    SFilter Filter; // elements to report
+    std::vector<bool> FilterListed; // filter names by symbol id
+    bool FilterUninterned; // a filter name got no symbol id and is matched by name
+    size_t Depth; // depth of the next element to start
+    size_t SkipDepth; // depth of the rejected element being dropped
+    std::unique_ptr<COSMXMLTokenizer> Tokenizer; // native tokenizer until it hands over to expat
+    std::vector<char> TokenizerBuffer; // block storage for the tokenizer when the source cannot lend
+    bool Replaying; // expat is being brought to the tokenizer's position, its events are ignored
 
     // handles both start and end element events in one unified function
-    static void ElementHandler(void *userData, const char *name, const char **element, bool isStart) {
-        auto *impl = static_cast<SImplementation *>(userData);
+    static void ElementHandler(SImplementation *impl, const char *name, SXMLEntity::TSymbolID nameid, const char **element, bool isStart) {
         impl->FlushCharData();  // flush out any accumulated character data
 
-        SXMLEntity entity;
+        if (impl->Visitor) {
+            if (isStart) {
+                impl->Attributes.clear();
+                impl->AttributeIDs.clear();
+                for (int i = 0; element && element[i] != nullptr; i += 2) {
+                    if (element[i + 1] != nullptr) {
+                        impl->Attributes.emplace_back(element[i], element[i + 1]);
+                        impl->AttributeIDs.push_back(impl->Intern(element[i]));
+                    }
+                }
+                impl->Visitor->StartElement(name, nameid, impl->Attributes, impl->AttributeIDs);
+            }
+            else {
+                impl->Visitor->EndElement(name, nameid);
+            }
+            return;
+        }
+
+        SXMLEntity &entity = impl->PushEntity();
         entity.DType = isStart ? SXMLEntity::EType::StartElement : SXMLEntity::EType::EndElement;
-        entity.DNameData = name;
+        entity.DNameData.assign(name);
+        entity.DNameID = nameid;
 
-        // if it is a start element and it has attributes, parse them
+        // if it is a start element and it has attributes, parse them into the
+        // slot's existing strings so their capacity is reused
+        size_t count = 0;
         if (isStart && element) {
             for (int i = 0; element[i] != nullptr; i += 2) {
                 if (element[i + 1] != nullptr) {
-                    entity.DAttributes.emplace_back(element[i], element[i + 1]);
+                    if (count == entity.DAttributes.size()) {
+                        entity.DAttributes.emplace_back();
+                    }
+                    entity.DAttributes[count].first.assign(element[i]);
+                    entity.DAttributes[count].second.assign(element[i + 1]);
+                    count++;
                 }
             }
         }
-
-        impl->Queue.push(entity);  // add the constructed entity to the queue
+        entity.DAttributes.resize(count);
+        entity.DAttributeIDs.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            entity.DAttributeIDs[i] = impl->Intern(entity.DAttributes[i].first);
+        }
     }
 
     // wrapper to handle the start of an XML element
+    // elements inside a dropped subtree are only counted, a rejected element
+    // starts a new dropped subtree
     static void StartElementHandler(void *userData, const char *name, const char **element) {
-        ElementHandler(userData, name, element, true);
+        auto *impl = static_cast<SImplementation *>(userData);
+        if (impl->Replaying) {
+            return;
+        }
+        size_t depth = impl->Depth++;
+        if (impl->SkipDepth != NotSkipping) {
+            return;
+        }
+        SXMLEntity::TSymbolID nameid = impl->Intern(name);
+        if (!impl->Accepts(name, nameid, depth)) {
+            impl->FlushCharData();
+            impl->SkipDepth = depth;
+            return;
+        }
+        ElementHandler(impl, name, nameid, element, true);
     }
 
-    // wrapper to handle the end of an XML element
+    // wrapper to handle the end of an XML element, the end of a rejected
+    // element stops the dropping
     static void EndElementHandler(void *userData, const char *name) {
-        ElementHandler(userData, name, nullptr, false);
+        auto *impl = static_cast<SImplementation *>(userData);
+        if (impl->Replaying) {
+            return;
+        }
+        size_t depth = --impl->Depth;
+        if (impl->SkipDepth != NotSkipping) {
+            if (depth == impl->SkipDepth) {
+                impl->SkipDepth = NotSkipping;
+            }
+            return;
+        }
+        ElementHandler(impl, name, impl->Intern(name), nullptr, false);
     }
 
     // processes character data found within XML elements
     static void CharDataHandler(void *userData, const char *j, int len) {
-        if (j && len > 0) {
-            static_cast<SImplementation *>(userData)->Buffer.append(j, len);  // Append text to the buffer.
+        auto *impl = static_cast<SImplementation *>(userData);
+        if (j && len > 0 && !impl->SkipCharData && impl->SkipDepth == NotSkipping && !impl->Replaying) {
+            impl->Buffer.append(j, len);  // Append text to the buffer.
         }
     }
 
-    // constructor sets up the parser and registers handlers for parsing events
-    SImplementation(std::shared_ptr<CDataSource> src) : Source(std::move(src)), Data(false) {
+    // constructor sets up the parser and registers handlers for parsing events,
+    // sources that may stall are filled on a background thread while we parse
+    // the native tokenizer reports through the same handlers as expat
+    void StartElement(const char *name, const char **attributes) override {
+        StartElementHandler(this, name, attributes);
+    }
+
+    void EndElement(const char *name) override {
+        EndElementHandler(this, name);
+    }
+
+    void CharData(const char *data, size_t length) override {
+        CharDataHandler(this, data, static_cast<int>(length));
+    }
+
+    SImplementation(std::shared_ptr<CDataSource> src, size_t blocksize, EBackend backend)
+        : Source(src && src->Blocking() ? std::make_shared<CPrefetchDataSource>(src) : std::move(src)), QueueHead(0), QueueCount(0), Data(false), BlockSize(std::clamp<size_t>(blocksize, 1, std::numeric_limits<int>::max())), Visitor(nullptr), SkipCharData(false), FilterUninterned(false), Depth(0), SkipDepth(NotSkipping), Replaying(false) {
+        Queue.resize(InitialQueueSize);
         Parser = XML_ParserCreate(nullptr);
         XML_SetUserData(Parser, this);
         XML_SetElementHandler(Parser, StartElementHandler, EndElementHandler);
         XML_SetCharacterDataHandler(Parser, CharDataHandler);
+        if (backend == EBackend::OSM) {
+            Tokenizer = std::make_unique<COSMXMLTokenizer>(*this);
+        }
     }
 
     // destructor cleans up the parser to prevent memory leaks
@@ -62,58 +165,243 @@ struct CXMLReader::SImplementation {
         XML_ParserFree(Parser);
     }
 
+    // returns the symbol id of name, adding it to the table if it is new, once
+    // the table is full new names get the invalid id, names from the document
+    // leave the last ReservedSymbols ids for names asked for by reserved callers
+    SXMLEntity::TSymbolID Intern(std::string_view name, bool reserved = false) {
+        auto found = SymbolTable.find(name);
+        if (found != SymbolTable.end()) {
+            return found->second;
+        }
+        if (SymbolNames.size() >= (reserved ? MaxSymbols : MaxSymbols - ReservedSymbols)) {
+            return SXMLEntity::InvalidSymbolID;
+        }
+        SXMLEntity::TSymbolID id = static_cast<SXMLEntity::TSymbolID>(SymbolNames.size());
+        SymbolNames.emplace_back(name);
+        SymbolTable.emplace(SymbolNames.back(), id);
+        return id;
+    }
+
+    // true if the filter lets the element through at depth, names without a
+    // symbol id all share the invalid id so they are compared by name
+    bool Accepts(const char *name, SXMLEntity::TSymbolID nameid, size_t depth) const {
+        if (Filter.DMode == SFilter::EMode::All || (Filter.DDepth != SFilter::AnyDepth && depth != Filter.DDepth)) {
+            return true;
+        }
+        bool listed = nameid < FilterListed.size() && FilterListed[nameid];
+        if (nameid == SXMLEntity::InvalidSymbolID && FilterUninterned) {
+            listed = std::find(Filter.DNames.begin(), Filter.DNames.end(), name) != Filter.DNames.end();
+        }
+        return listed == (Filter.DMode == SFilter::EMode::Allow);
+    }
+
+    void SetFilter(const SFilter &filter) {
+        Filter = filter;
+        FilterListed.clear();
+        FilterUninterned = false;
+        for (const auto &name : Filter.DNames) {
+            SXMLEntity::TSymbolID id = Intern(name, true);
+            if (id != SXMLEntity::InvalidSymbolID) {
+                FilterListed.resize(std::max<size_t>(FilterListed.size(), id + 1));
+                FilterListed[id] = true;
+            }
+            else {
+                FilterUninterned = true;
+            }
+        }
+    }
+
+    // true if the text has nothing but XML whitespace
+    static bool Whitespace(const std::string &text) {
+        return text.find_first_not_of(" \t\r\n") == std::string::npos;
+    }
+
+    // returns the slot for a new entity at the back of the queue, the slot
+    // still holds an old entity whose storage the caller overwrites
+    SXMLEntity &PushEntity() {
+        if (QueueCount == Queue.size()) {
+            // unroll the ring so the new slots follow the newest entity
+            std::rotate(Queue.begin(), Queue.begin() + QueueHead, Queue.end());
+            QueueHead = 0;
+            Queue.resize(Queue.size() * 2);
+        }
+        return Queue[(QueueHead + QueueCount++) % Queue.size()];
+    }
+
+    // swaps the oldest entity out to the caller, the caller's previous entity
+    // takes its slot so its storage is recycled
+    void PopEntity(SXMLEntity &entity) {
+        std::swap(entity, Queue[QueueHead]);
+        QueueHead = (QueueHead + 1) % Queue.size();
+        QueueCount--;
+    }
+
     // flushes accumulated character data into the queue as an entity
     void FlushCharData() {
-        if (!Buffer.empty()) {
-            Queue.push({SXMLEntity::EType::CharData, Buffer, {}});
+        if (Filter.DDropWhitespace && Whitespace(Buffer)) {
+            Buffer.clear();
+        }
+        if (!Buffer.empty() && Visitor) {
+            Visitor->CharData(Buffer);
+            Buffer.clear();
+        }
+        else if (!Buffer.empty()) {
+            SXMLEntity &entity = PushEntity();
+            entity.DType = SXMLEntity::EType::CharData;
+            entity.DNameData.swap(Buffer);
+            entity.DNameID = SXMLEntity::InvalidSymbolID;
+            entity.DAttributes.clear();
+            entity.DAttributeIDs.clear();
             Buffer.clear();  // Clear the buffer for new data.
         }
     }
 
+    // parses the next block of the source, the parser's handlers fill the
+    // queue or call the visitor, returns false on a parse error
+    bool ParseBlock() {
+        if (Tokenizer) {
+            return ParseTokenizerBlock();
+        }
+        // hand the parser a block borrowed straight from the source when it
+        // can lend its storage, otherwise read into the parser's own buffer
+        const char *data = nullptr;
+        size_t length = Source->Borrow(data, BlockSize);
+        if (length == 0) {
+            void *buffer = XML_GetBuffer(Parser, static_cast<int>(BlockSize));
+            if (!buffer) {
+                return false;  // the parser could not allocate its buffer
+            }
+            length = Source->ReadBlock(static_cast<char *>(buffer), BlockSize);
+            if (length && XML_ParseBuffer(Parser, static_cast<int>(length), 0) == XML_STATUS_ERROR) {
+                return false;  // handle parsing errors
+            }
+        }
+        else if (XML_Parse(Parser, data, static_cast<int>(length), 0) == XML_STATUS_ERROR) {
+            return false;  // handle parsing errors
+        }
+
+        if (length == 0) {  // no more data to read indicates the end of the data source
+            return Finish();
+        }
+        return true;
+    }
+
+    // parses the next block with the native tokenizer, it reads ahead of the
+    // handlers only by the token cut off at the end of the block
+    bool ParseTokenizerBlock() {
+        const char *data = nullptr;
+        size_t length = Source->Borrow(data, BlockSize);
+        if (length == 0) {
+            TokenizerBuffer.resize(BlockSize);
+            length = Source->ReadBlock(TokenizerBuffer.data(), BlockSize);
+            data = TokenizerBuffer.data();
+        }
+        bool final = length == 0;
+        if (Tokenizer->Parse(data, length, final) == COSMXMLTokenizer::EStatus::Unexpected) {
+            return HandOver(final);
+        }
+        Data = final;
+        return true;
+    }
+
+    // continues with expat from where the tokenizer stopped, expat is first
+    // fed start tags for the open elements, or an empty root once the root
+    // has closed, with its events ignored so it is in the same state, then the
+    // input the tokenizer did not consume
+    bool HandOver(bool final) {
+        std::string prefix = Tokenizer->RootClosed() ? "<root/>" : "";
+        for (const auto &name : Tokenizer->OpenElements()) {
+            prefix += '<';
+            prefix += name;
+            prefix += '>';
+        }
+        std::string rest(Tokenizer->Remainder());
+        Tokenizer.reset();
+        Replaying = true;
+        XML_Parse(Parser, prefix.data(), static_cast<int>(prefix.size()), 0);
+        Replaying = false;
+        if (XML_Parse(Parser, rest.data(), static_cast<int>(rest.size()), 0) == XML_STATUS_ERROR) {
+            return false;  // handle parsing errors
+        }
+        return final ? Finish() : true;
+    }
+
+    // signals the parser that parsing is complete, errors expat holds back
+    // until the end of the input such as an unclosed element surface here
+    bool Finish() {
+        if (XML_Parse(Parser, nullptr, 0, 1) == XML_STATUS_ERROR) {
+            return false;  // handle parsing errors
+        }
+        Data = true;
+        return true;
+    }
+
     // reads and parses XML data from the source, processing entities into the queue
     bool ReadEntity(SXMLEntity &entity, bool skipcdata) {
-        while (Queue.empty() && !Data) {
-            std::vector<char> buffer(4096);
-            size_t length = 0;
-            while (length < buffer.size() && !Source->End()) {
-                char ch;
-                if (Source->Get(ch)) {
-                    buffer[length++] = ch;  // fill buffer with data from the source
-                } else {
-                    break;
+        while (true) {
+            if (QueueCount) {
+                PopEntity(entity);
+                if (!(skipcdata && entity.DType == SXMLEntity::EType::CharData)) {
+                    return true;
                 }
+                continue;
             }
-
-            if (length == 0) {  // no more data to read indicates the end of the data source
-                Data = true;
-                XML_Parse(Parser, nullptr, 0, 1);  // signal the parser that parsing is complete
-                break;
+            if (Data) {
+                return false;  // return false if no more entities are available
             }
 
-            if (XML_Parse(Parser, buffer.data(), length, 0) == XML_STATUS_ERROR) {
+            if (!ParseBlock()) {
                 return false;  // handle parsing errors
             }
         }
+    }
 
-        if (!Queue.empty()) {
-            entity = Queue.front();
-            Queue.pop();
-            return !(skipcdata && entity.DType == SXMLEntity::EType::CharData) || ReadEntity(entity, skipcdata);
+    // hands every remaining event to the visitor, entities already queued by
+    // ReadEntity are delivered first so the two can be mixed
+    bool Visit(CXMLVisitor &visitor, bool skipcdata) {
+        SXMLEntity entity;
+        while (QueueCount) {
+            PopEntity(entity);
+            if (entity.DType == SXMLEntity::EType::CharData) {
+                if (!skipcdata) {
+                    visitor.CharData(entity.DNameData);
+                }
+            }
+            else if (entity.DType == SXMLEntity::EType::EndElement) {
+                visitor.EndElement(entity.DNameData, entity.DNameID);
+            }
+            else {
+                Attributes.assign(entity.DAttributes.begin(), entity.DAttributes.end());
+                visitor.StartElement(entity.DNameData, entity.DNameID, Attributes, entity.DAttributeIDs);
+            }
         }
-
-        return false;  // return false if no more entities are available
+        if (skipcdata) {
+            Buffer.clear();
+        }
+        Visitor = &visitor;
+        SkipCharData = skipcdata;
+        bool success = true;
+        while (success && !Data) {
+            success = ParseBlock();
+        }
+        Visitor = nullptr;
+        SkipCharData = false;
+        return success;
     }
 };
 
-// interface for creating an XML reader with a specific data source
-CXMLReader::CXMLReader(std::shared_ptr<CDataSource> src)
-    : DImplementation(std::make_unique<SImplementation>(std::move(src))) {}
+// interface for creating an XML reader with a specific data source, blocksize
+// is the number of bytes read from the source and parsed at a time, it is
+// kept between 1 and INT_MAX since expat takes block lengths as an int, and
+// backend selects the parser
+CXMLReader::CXMLReader(std::shared_ptr<CDataSource> src, std::size_t blocksize, EBackend backend)
+    : DImplementation(std::make_unique<SImplementation>(std::move(src), blocksize, backend)) {}
 
 CXMLReader::~CXMLReader() = default; // destructor is straightforward because the unique_ptr takes care of cleanup
 
 // returns true if all data has been parsed and the entity queue is empty
 bool CXMLReader::End() const {
-    return DImplementation->Data && DImplementation->Queue.empty();
+    return DImplementation->Data && !DImplementation->QueueCount;
 }
 
 // method to read an XML entity, with an option to skip character data
@@ -121,3 +409,56 @@ bool CXMLReader::ReadEntity(SXMLEntity &entity, bool skipcdata) {
     return DImplementation->ReadEntity(entity, skipcdata);
 }
 
+// parses the rest of the data calling the visitor for each event instead of
+// building entities, returns false if the data is not well formed, a subclass
+// that only overrides ReadEntity still works since for any subclass the
+// events are pulled through ReadEntity and End tells if they all arrived
+bool CXMLReader::Visit(CXMLVisitor &visitor, bool skipcdata) {
+    if (typeid(*this) == typeid(CXMLReader)) {
+        return DImplementation->Visit(visitor, skipcdata);
+    }
+    SXMLEntity entity;
+    std::vector<SXMLEntity::TSymbolID> attributeids;
+    while (ReadEntity(entity, skipcdata)) {
+        if (entity.DType == SXMLEntity::EType::CharData) {
+            visitor.CharData(entity.DNameData);
+            continue;
+        }
+        // the subclass may not have filled in symbol ids, so they are looked up
+        SXMLEntity::TSymbolID nameid = DImplementation->Intern(entity.DNameData);
+        if (entity.DType != SXMLEntity::EType::EndElement) {
+            attributeids.clear();
+            for (const auto &attribute : entity.DAttributes) {
+                attributeids.push_back(DImplementation->Intern(attribute.first));
+            }
+            DImplementation->Attributes.assign(entity.DAttributes.begin(), entity.DAttributes.end());
+            visitor.StartElement(entity.DNameData, nameid, DImplementation->Attributes, attributeids);
+        }
+        if (entity.DType != SXMLEntity::EType::StartElement) {
+            visitor.EndElement(entity.DNameData, nameid);
+        }
+    }
+    return End();
+}
+
+// returns the symbol id the reader uses for name, interning it if needed so
+// ids can be looked up before parsing, names asked for here may take ids a
+// document can no longer fill, the invalid id means the table is full
+SXMLEntity::TSymbolID CXMLReader::Symbol(std::string_view name) {
+    return DImplementation->Intern(name, true);
+}
+
+// returns the name of a symbol id, empty for ids the reader has not issued
+std::string_view CXMLReader::SymbolName(SXMLEntity::TSymbolID id) const {
+    return id < DImplementation->SymbolNames.size() ? std::string_view(DImplementation->SymbolNames[id]) : std::string_view();
+}
+
+// replaces the filter, it applies to everything parsed from now on
+void CXMLReader::SetFilter(const SFilter &filter) {
+    DImplementation->SetFilter(filter);
+}
+
+// returns the filter currently applied
+const CXMLReader::SFilter &CXMLReader::Filter() const {
+    return DImplementation->Filter;
+}
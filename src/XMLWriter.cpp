@@ -1,45 +1,145 @@
 #include "XMLWriter.h"
 #include <stack>
 #include <string>
+#include <string_view>
+#include <vector>
 
-// internal implementation of the CXMLWriter using a stack to manage open XML elements
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define XMLWRITER_X86
+#endif
+
+namespace {
+
+// returns true for the characters that are written as entity references
+inline bool IsSpecial(char c) {
+    return c == '<' || c == '>' || c == '&' || c == '\'' || c == '"';
+}
+
+// finds the first character in the range that has to be escaped, or end,
+// 16 bytes are compared at a time where SSE2 is available
+const char *FindSpecial(const char *begin, const char *end) {
+#ifdef XMLWRITER_X86
+    const __m128i Less = _mm_set1_epi8('<');
+    const __m128i Greater = _mm_set1_epi8('>');
+    const __m128i Ampersand = _mm_set1_epi8('&');
+    const __m128i Apostrophe = _mm_set1_epi8('\'');
+    const __m128i Quote = _mm_set1_epi8('"');
+    while (end - begin >= 16) {
+        __m128i Chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+        __m128i Matches = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(Chunk, Less), _mm_cmpeq_epi8(Chunk, Greater)),
+                                       _mm_or_si128(_mm_cmpeq_epi8(Chunk, Ampersand), _mm_cmpeq_epi8(Chunk, Apostrophe)));
+        int Mask = _mm_movemask_epi8(_mm_or_si128(Matches, _mm_cmpeq_epi8(Chunk, Quote)));
+        if (Mask) {
+            return begin + __builtin_ctz(Mask);
+        }
+        begin += 16;
+    }
+#endif
+    while (begin < end && !IsSpecial(*begin)) {
+        begin++;
+    }
+    return begin;
+}
+
+// the entity reference written in place of a special character
+std::string_view Escape(char c) {
+    switch (c) {
+        case '<':  return "&lt;";
+        case '>':  return "&gt;";
+        case '&':  return "&amp;";
+        case '\'': return "&apos;";
+        default:   return "&quot;";
+    }
+}
+
+}
+
+// internal implementation of the CXMLWriter using a stack to manage open XML
+// elements, output is built in a buffer that goes to the sink in batches
 struct CXMLWriter::SImplementation {
+    static const std::size_t BatchSize = 65536; // buffered bytes that trigger a write to the sink
+
     std::shared_ptr<CDataSink> Sink;  // destination for XML output
     std::stack<std::string> Stack;    // stack to manage the tags for proper nesting and closure
+    std::vector<char> Buffer;         // output waiting to be written to the sink
 
     // constructor that takes a data sink
     explicit SImplementation(std::shared_ptr<CDataSink> sink) 
-        : Sink(std::move(sink)) {}
-
-    // writes a string to the output possibly escaping XML special characters
-    bool WriteText(const std::string &str, bool escape) {
-        for (char c : str) {
-            if (escape) {
-                // escaping XML special characters to prevent malformation
-                switch (c) {
-                    case '<':  if (!WriteText("&lt;", false)) return false; break;
-                    case '>':  if (!WriteText("&gt;", false)) return false; break;
-                    case '&':  if (!WriteText("&amp;", false)) return false; break;
-                    case '\'': if (!WriteText("&apos;", false)) return false; break;
-                    case '"':  if (!WriteText("&quot;", false)) return false; break;
-                    default:   if (!Sink->Put(c)) return false;
-                }
-            } else {
-                if (!Sink->Put(c)) return false;
+        : Sink(std::move(sink)) {
+        Buffer.reserve(BatchSize);
+    }
+
+    // unwritten output is pushed out when the writer goes away, open elements
+    // are left open, a destructor cannot report a failed write or flush so
+    // callers that need to know call Flush() first
+    ~SImplementation() {
+        if (WriteBuffer()) {
+            Sink->Flush();
+        }
+    }
+
+    void Append(std::string_view str) {
+        Buffer.insert(Buffer.end(), str.begin(), str.end());
+    }
+
+    // appends text escaping XML special characters, the runs between them
+    // are copied in bulk
+    void AppendEscaped(std::string_view str) {
+        const char *begin = str.data();
+        const char *end = begin + str.size();
+        while (begin < end) {
+            const char *special = FindSpecial(begin, end);
+            Buffer.insert(Buffer.end(), begin, special);
+            if (special == end) {
+                break;
             }
+            Append(Escape(*special));
+            begin = special + 1;
+        }
+    }
+
+    // appends the name and attributes of a start or complete element
+    void AppendTag(const SXMLEntity &entity) {
+        Buffer.push_back('<');
+        Append(entity.DNameData);
+        for (const auto &attr : entity.DAttributes) {
+            Buffer.push_back(' ');
+            Append(attr.first);
+            Append("=\"");
+            AppendEscaped(attr.second);
+            Buffer.push_back('"');
+        }
+    }
+
+    void AppendEndTag(std::string_view name) {
+        Append("</");
+        Append(name);
+        Buffer.push_back('>');
+    }
+
+    // hands the buffered output to the sink in a single write, the output
+    // stays buffered if the write fails so a later flush can retry it
+    bool WriteBuffer() {
+        if (Buffer.empty()) {
+            return true;
+        }
+        if (!Sink->Write(Buffer)) {
+            return false;
         }
+        Buffer.clear();
         return true;
     }
 
-    // closes all open xml elements ensuring proper xml structure before ending the document
+    // closes all open xml elements ensuring proper xml structure before ending
+    // the document, then writes the buffer and flushes the sink
     bool Flush() {
         while (!Stack.empty()) {
-            if (!WriteText("</" + Stack.top() + ">", false)) {
-                return false;
-            }
+            AppendEndTag(Stack.top());
             Stack.pop();
         }
-        return true;
+        bool success = WriteBuffer();
+        return Sink->Flush() && success;
     }
 
     // writes an xml entity based on its type (tag, data, or self-closing element)
@@ -47,22 +147,14 @@ struct CXMLWriter::SImplementation {
         switch (entity.DType) {
             // handle opening tags
             case SXMLEntity::EType::StartElement:
-                if (!WriteText("<" + entity.DNameData, false)) return false;
-
-                // write attributes if any
-                for (const auto &attr : entity.DAttributes) {
-                    if (!WriteText(" " + attr.first + "=\"", false)) return false;
-                    if (!WriteText(attr.second, true)) return false;  
-                    if (!WriteText("\"", false)) return false;
-                }
-
-                if (!WriteText(">", false)) return false;
+                AppendTag(entity);
+                Buffer.push_back('>');
                 Stack.push(entity.DNameData);  // remember this tag to close it later
                 break;
 
             // handle closing tags
             case SXMLEntity::EType::EndElement:
-                if (!WriteText("</" + entity.DNameData + ">", false)) return false;
+                AppendEndTag(entity.DNameData);
                 if (!Stack.empty()) {
                     Stack.pop();
                 }
@@ -70,23 +162,16 @@ struct CXMLWriter::SImplementation {
 
             // handle character data within tags
             case SXMLEntity::EType::CharData:
-                if (!WriteText(entity.DNameData, true)) return false;  
+                AppendEscaped(entity.DNameData);
                 break;
 
             // handle self-closing tags
             case SXMLEntity::EType::CompleteElement:
-                if (!WriteText("<" + entity.DNameData, false)) return false;
-
-                for (const auto &attr : entity.DAttributes) {
-                    if (!WriteText(" " + attr.first + "=\"", false)) return false;
-                    if (!WriteText(attr.second, true)) return false;  
-                    if (!WriteText("\"", false)) return false;
-                }
-
-                if (!WriteText("/>", false)) return false;
+                AppendTag(entity);
+                Append("/>");
                 break;
         }
-        return true;
+        return Buffer.size() < BatchSize || WriteBuffer();
     }
 };
 
@@ -94,16 +179,20 @@ struct CXMLWriter::SImplementation {
 CXMLWriter::CXMLWriter(std::shared_ptr<CDataSink> sink)
     : DImplementation(std::make_unique<SImplementation>(std::move(sink))) {}
 
-// destructor ensures resources are cleaned up properly
+// destructor writes any buffered output to the sink, errors are dropped so
+// call Flush() beforehand to find out whether everything was written
 CXMLWriter::~CXMLWriter() = default;
 
-// flush method to make sure all opened tags are closed
+// closes all open tags, writes the buffered output and flushes the sink,
+// returns false if a write fails
 bool CXMLWriter::Flush() {
     return DImplementation->Flush();
 }
 
-// writes an xml entity to the output based on the provided description and attributes
+// writes an xml entity to the output based on the provided description and
+// attributes, output is buffered and reaches the sink in batches, a false
+// return means a batch could not be written, it stays buffered for the next
+// flush
 bool CXMLWriter::WriteEntity(const SXMLEntity &entity) {
     return DImplementation->WriteEntity(entity);
 }
-
@@ -109,3 +109,18 @@ TEST_F(CSVBusSystemTest, EmptyData) {
     EXPECT_EQ(busSystem.RouteByIndex(0), nullptr);
     EXPECT_EQ(busSystem.RouteByName("Route1"), nullptr);
 }
+
+// Test case to check loading stops and routes from CSV text with headers
+TEST_F(CSVBusSystemTest, LoadFromCSV) {
+    auto stopReader = std::make_shared<CDSVReader>(std::make_shared<CStringDataSource>("stop_id,node_id\r\n1,100\r\n2,200\r\n"), ',');
+    auto routeReader = std::make_shared<CDSVReader>(std::make_shared<CStringDataSource>("route,stop_id\nA,1\nA,2\nB,2\nA,1\n"), ',');
+    CCSVBusSystem busSystem(stopReader, routeReader);
+    
+    EXPECT_EQ(busSystem.StopCount(), 2);
+    EXPECT_EQ(busSystem.StopByID(2)->NodeID(), 200);
+    EXPECT_EQ(busSystem.RouteCount(), 2);
+    ASSERT_NE(busSystem.RouteByName("A"), nullptr);
+    EXPECT_EQ(busSystem.RouteByName("A")->StopCount(), 3);
+    EXPECT_EQ(busSystem.RouteByName("A")->GetStopID(2), 1);
+    EXPECT_EQ(busSystem.RouteByName("B")->GetStopID(0), 2);
+}
@@ -1 +1,336 @@
+#include "OpenStreetMap.h"
+#include "StringDataSource.h"
+#include "MmapDataSource.h"
+#include "StreetMapTest.h"
+#include "gtest/gtest.h"
+#include <string>
+#include <memory>
 
+TEST(OpenStreetMapTest, SimpleMapTest) {
+    auto src = std::make_shared<CStringDataSource>(
+        "<?xml version='1.0' encoding='UTF-8'?>\n"
+        "<osm version=\"0.6\">\n"
+        "  <node id=\"1\" lat=\"38.5\" lon=\"-121.7\"/>\n"
+        "  <node id=\"2\" lat=\"38.6\" lon=\"-121.8\">\n"
+        "    <tag k=\"highway\" v=\"traffic_signals\"/>\n"
+        "  </node>\n"
+        "  <way id=\"10\">\n"
+        "    <nd ref=\"1\"/>\n"
+        "    <nd ref=\"2\"/>\n"
+        "    <tag k=\"name\" v=\"Main &amp; 1st\"/>\n"
+        "  </way>\n"
+        "  <relation id=\"20\">\n"
+        "    <member type=\"way\" ref=\"10\" role=\"outer\"/>\n"
+        "    <tag k=\"type\" v=\"multipolygon\"/>\n"
+        "  </relation>\n"
+        "</osm>\n");
+    COpenStreetMap map(std::make_shared<CXMLReader>(src));
+
+    ASSERT_EQ(map.NodeCount(), 2);
+    ASSERT_EQ(map.WayCount(), 1);
+    auto node = map.NodeByIndex(1);
+    ASSERT_TRUE(node);
+    EXPECT_EQ(node->ID(), 2);
+    EXPECT_EQ(node->Location(), CStreetMap::TLocation(38.6, -121.8));
+    EXPECT_EQ(node->GetAttribute("highway"), "traffic_signals");
+    EXPECT_EQ(map.NodeByID(1)->AttributeCount(), 0);
+    EXPECT_EQ(map.NodeByID(3), nullptr);
+    auto way = map.WayByID(10);
+    ASSERT_TRUE(way);
+    EXPECT_EQ(way->NodeCount(), 2);
+    EXPECT_EQ(way->GetNodeID(1), 2);
+    CStreetMap::TNodeID invalid = CStreetMap::InvalidNodeID;
+    EXPECT_EQ(way->GetNodeID(2), invalid);
+    EXPECT_EQ(way->GetAttribute("name"), "Main & 1st");
+    EXPECT_FALSE(way->HasAttribute("type"));
+}
+
+TEST(OpenStreetMapTest, DavisMapTest) {
+    // count the elements with the entity interface and compare with the map
+    auto counter = std::make_shared<CXMLReader>(std::make_shared<CMmapDataSource>("data/davis.osm"));
+    SXMLEntity entity;
+    std::size_t nodes = 0, ways = 0;
+    while (counter->ReadEntity(entity, true)) {
+        if (entity.DType == SXMLEntity::EType::StartElement) {
+            nodes += entity.DNameData == "node";
+            ways += entity.DNameData == "way";
+        }
+    }
+    COpenStreetMap map(std::make_shared<CXMLReader>(std::make_shared<CMmapDataSource>("data/davis.osm")));
+
+    EXPECT_GT(nodes, 0);
+    EXPECT_GT(ways, 0);
+    EXPECT_EQ(map.NodeCount(), nodes);
+    EXPECT_EQ(map.WayCount(), ways);
+    for (std::size_t index = 0; index < map.WayCount(); index++) {
+        EXPECT_GT(map.WayByIndex(index)->NodeCount(), 0);
+    }
+}
+
+TEST(OpenStreetMapTest, OSMBackendTest) {
+    // the native backend must build the same map as expat
+    COpenStreetMap expected(std::make_shared<CXMLReader>(std::make_shared<CMmapDataSource>("data/davis.osm")));
+    std::size_t blocksize = CXMLReader::DefaultBlockSize;
+    COpenStreetMap map(std::make_shared<CXMLReader>(std::make_shared<CMmapDataSource>("data/davis.osm"), blocksize, CXMLReader::EBackend::OSM));
+
+    ExpectSameStreetMap(map, expected);
+}
+
+TEST(OpenStreetMapTest, IndexTest) {
+    // both index kinds answer every id the same way a scan of the lists would
+    for (auto kind : {CIDIndex::EKind::Eytzinger, CIDIndex::EKind::Hash}) {
+        COpenStreetMap map(std::make_shared<CXMLReader>(std::make_shared<CMmapDataSource>("data/davis.osm")), kind);
+
+        EXPECT_GT(map.IndexMemoryUsage(), 0);
+        for (std::size_t index = 0; index < map.NodeCount(); index++) {
+            // node handles are made per call, so compare what they refer to
+            auto node = map.NodeByIndex(index), found = map.NodeByID(node->ID());
+            ASSERT_TRUE(found);
+            EXPECT_EQ(found->ID(), node->ID());
+            EXPECT_EQ(found->Location(), node->Location());
+        }
+        for (std::size_t index = 0; index < map.WayCount(); index++) {
+            auto way = map.WayByIndex(index);
+            EXPECT_EQ(map.WayByID(way->ID()), way);
+        }
+        EXPECT_EQ(map.NodeByID(0), nullptr);
+        EXPECT_EQ(map.WayByID(0), nullptr);
+    }
+}
+
+TEST(OpenStreetMapTest, NodeStoreTest) {
+    auto src = std::make_shared<CStringDataSource>(
+        "<osm>\n"
+        "  <node id=\"5\" lat=\"1.5\" lon=\"2.5\"/>\n"
+        "  <node id=\"6\" lat=\"3.5\" lon=\"4.5\" version=\"2\">\n"
+        "    <tag k=\"name\" v=\"first\"/>\n"
+        "    <tag k=\"amenity\" v=\"bench\"/>\n"
+        "    <tag k=\"name\" v=\"second\"/>\n"
+        "  </node>\n"
+        "  <node id=\"7\" lat=\"5.5\" lon=\"6.5\"/>\n"
+        "</osm>\n");
+    std::shared_ptr<CStreetMap::SNode> tagged, plain;
+    {
+        COpenStreetMap map(std::make_shared<CXMLReader>(src));
+        ASSERT_EQ(map.NodeCount(), 3);
+        tagged = map.NodeByID(6);
+        plain = map.NodeByIndex(2);
+        EXPECT_EQ(map.NodeByIndex(3), nullptr);
+        EXPECT_GT(map.NodeMemoryUsage(), 0);
+    }
+    // handles keep the node store alive after the map is gone
+    ASSERT_TRUE(tagged);
+    EXPECT_EQ(tagged->Location(), CStreetMap::TLocation(3.5, 4.5));
+    // attributes are ordered by key, a repeated key replaces the value
+    ASSERT_EQ(tagged->AttributeCount(), 3);
+    EXPECT_EQ(tagged->GetAttributeKey(0), "amenity");
+    EXPECT_EQ(tagged->GetAttributeKey(1), "name");
+    EXPECT_EQ(tagged->GetAttributeKey(2), "version");
+    EXPECT_EQ(tagged->GetAttributeKey(3), "");
+    EXPECT_EQ(tagged->GetAttribute("name"), "second");
+    EXPECT_TRUE(tagged->HasAttribute("amenity"));
+    EXPECT_FALSE(tagged->HasAttribute("highway"));
+    ASSERT_TRUE(plain);
+    EXPECT_EQ(plain->ID(), 7);
+    EXPECT_EQ(plain->AttributeCount(), 0);
+    EXPECT_EQ(plain->GetAttribute("name"), "");
+
+    // untagged nodes cost their id and location, tagged ones a little more
+    COpenStreetMap davis(std::make_shared<CXMLReader>(std::make_shared<CMmapDataSource>("data/davis.osm")));
+    EXPECT_LT(davis.NodeMemoryUsage(), davis.NodeCount() * 32);
+    EXPECT_GT(davis.StringMemoryUsage(), 0);
+}
+
+TEST(OpenStreetMapTest, AttributeTest) {
+    auto src = std::make_shared<CStringDataSource>(
+        "<osm>\n"
+        "  <way id=\"1\" version=\"3\">\n"
+        "    <tag k=\"oneway\" v=\"yes\"/>\n"
+        "    <tag k=\"highway\" v=\"residential\"/>\n"
+        "  </way>\n"
+        "  <way id=\"2\">\n"
+        "    <tag k=\"highway\" v=\"yes\"/>\n"
+        "    <tag k=\"name\" v=\"\"/>\n"
+        "    <tag k=\"oneway\" v=\"no\"/>\n"
+        "    <tag k=\"highway\" v=\"service\"/>\n"
+        "  </way>\n"
+        "</osm>\n");
+    COpenStreetMap map(std::make_shared<CXMLReader>(src));
+
+    ASSERT_EQ(map.WayCount(), 2);
+    auto first = map.WayByID(1), second = map.WayByID(2);
+    // keys are shared between ways and each way's attributes are ordered by key
+    ASSERT_EQ(first->AttributeCount(), 3);
+    EXPECT_EQ(first->GetAttributeKey(0), "highway");
+    EXPECT_EQ(first->GetAttributeKey(1), "oneway");
+    EXPECT_EQ(first->GetAttributeKey(2), "version");
+    EXPECT_EQ(first->GetAttributeKey(3), "");
+    EXPECT_EQ(first->GetAttribute("highway"), "residential");
+    ASSERT_EQ(second->AttributeCount(), 3);
+    EXPECT_EQ(second->GetAttributeKey(0), "highway");
+    EXPECT_EQ(second->GetAttributeKey(1), "name");
+    EXPECT_EQ(second->GetAttributeKey(2), "oneway");
+    EXPECT_EQ(second->GetAttribute("highway"), "service");
+    EXPECT_EQ(second->GetAttribute("oneway"), "no");
+    EXPECT_TRUE(second->HasAttribute("name"));
+    EXPECT_EQ(second->GetAttribute("name"), "");
+    // keys seen elsewhere in the map and keys never seen are both absent
+    EXPECT_FALSE(second->HasAttribute("version"));
+    EXPECT_FALSE(second->HasAttribute("surface"));
+    EXPECT_EQ(second->GetAttribute("surface"), "");
+}
+
+TEST(OpenStreetMapTest, PipelineTest) {
+    // the pipelined loader must build the same map as the serial one, in the
+    // same order and with attribute keys in the same order
+    std::string text =
+        "<osm>\n"
+        "  <node id=\"1\" lat=\"38.5\" lon=\"-121.7\" version=\"2\">\n"
+        "    <tag k=\"highway\" v=\"stop\"/>\n"
+        "    <tag k=\"\" v=\"dropped\"/>\n"
+        "    <tag k=\"highway\" v=\"crossing\"/>\n"
+        "  </node>\n"
+        "  <way id=\"10\" lat=\"kept\">\n"
+        "    <nd ref=\"1\"/>\n"
+        "    <nd ref=\"2\"/>\n"
+        "    <tag k=\"name\" v=\"Main\"/>\n"
+        "  </way>\n"
+        "  <node id=\"2\" lat=\"38.6\" lon=\"-121.8\"/>\n"
+        "  <way id=\"11\">\n"
+        "    <nd ref=\"2\"/>\n"
+        "    <tag k=\"oneway\" v=\"yes\"/>\n"
+        "    <tag k=\"highway\" v=\"service\"/>\n"
+        "  </way>\n"
+        "</osm>\n";
+    COpenStreetMap serial(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(text)), CIDIndex::EKind::Eytzinger, 1);
+    COpenStreetMap davis(std::make_shared<CXMLReader>(std::make_shared<CMmapDataSource>("data/davis.osm")), CIDIndex::EKind::Eytzinger, 1);
+    ASSERT_EQ(serial.NodeCount(), 2);
+    EXPECT_EQ(serial.NodeByID(1)->GetAttribute("highway"), "crossing");
+    EXPECT_EQ(serial.WayByID(10)->GetAttribute("lat"), "kept");
+    for (std::size_t threads : {2, 4}) {
+        COpenStreetMap map(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(text)), CIDIndex::EKind::Eytzinger, threads);
+        ExpectSameStreetMap(map, serial);
+        EXPECT_EQ(map.WayByID(11)->GetNodeID(0), 2);
+        // davis spans several batches of nodes
+        COpenStreetMap pipelined(std::make_shared<CXMLReader>(std::make_shared<CMmapDataSource>("data/davis.osm")), CIDIndex::EKind::Hash, threads);
+        ExpectSameStreetMap(pipelined, davis);
+        EXPECT_EQ(pipelined.WayByID(davis.WayByIndex(0)->ID()), pipelined.WayByIndex(0));
+    }
+}
+
+TEST(OpenStreetMapTest, FilterRestoreTest) {
+    // loading narrows the reader's filter only while it parses
+    auto reader = std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>("<osm><node id=\"1\" lat=\"1\" lon=\"2\"/><relation id=\"2\"/></osm>"));
+    CXMLReader::SFilter filter;
+    filter.DMode = CXMLReader::SFilter::EMode::Deny;
+    filter.DNames = {"bounds"};
+    filter.DDepth = 3;
+    reader->SetFilter(filter);
+    COpenStreetMap map(reader);
+
+    EXPECT_EQ(map.NodeCount(), 1);
+    EXPECT_EQ(reader->Filter().DMode, filter.DMode);
+    EXPECT_EQ(reader->Filter().DNames, filter.DNames);
+    EXPECT_EQ(reader->Filter().DDepth, filter.DDepth);
+    EXPECT_FALSE(reader->Filter().DDropWhitespace);
+
+    auto plain = std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>("<osm/>"));
+    COpenStreetMap empty(plain);
+    EXPECT_EQ(plain->Filter().DMode, CXMLReader::SFilter::EMode::All);
+    EXPECT_TRUE(plain->Filter().DNames.empty());
+}
+
+TEST(OpenStreetMapTest, MalformedTest) {
+    // elements with a missing or malformed id, coordinate or ref are dropped
+    auto src = std::make_shared<CStringDataSource>(
+        "<osm>\n"
+        "  <node id=\"1\" lat=\"38.5\" lon=\"-121.7\"/>\n"
+        "  <node id=\"x\" lat=\"38.5\" lon=\"-121.7\"/>\n"
+        "  <node id=\"3\" lat=\"38.5abc\" lon=\"-121.7\"/>\n"
+        "  <node id=\"4\" lat=\"38.5\"><tag k=\"a\" v=\"b\"/></node>\n"
+        "  <node lat=\"38.5\" lon=\"-121.7\"/>\n"
+        "  <node id=\"-6\" lat=\"1\" lon=\"2\"><tag k=\"c\" v=\"d\"/></node>\n"
+        "  <way id=\"10\"><nd ref=\"1\"/><tag k=\"e\" v=\"f\"/></way>\n"
+        "  <way id=\"11\"><nd ref=\"1\"/><nd ref=\"q\"/></way>\n"
+        "  <way id=\"12 \"><nd ref=\"1\"/></way>\n"
+        "</osm>\n");
+    COpenStreetMap map(std::make_shared<CXMLReader>(src));
+
+    ASSERT_EQ(map.NodeCount(), 2);
+    EXPECT_EQ(map.NodeByIndex(0)->ID(), 1);
+    EXPECT_EQ(map.NodeByIndex(1)->ID(), static_cast<CStreetMap::TNodeID>(-6));
+    EXPECT_EQ(map.NodeByIndex(1)->GetAttribute("c"), "d");
+    EXPECT_EQ(map.NodeByID(4), nullptr);
+    ASSERT_EQ(map.WayCount(), 1);
+    EXPECT_EQ(map.WayByIndex(0)->ID(), 10);
+    EXPECT_EQ(map.WayByIndex(0)->GetAttribute("e"), "f");
+}
+
+// reader standing in for a parser that only provides ReadEntity
+class CEntityListReader : public CXMLReader {
+    std::vector<SXMLEntity> entities;
+    std::size_t next = 0;
+
+public:
+    CEntityListReader(std::vector<SXMLEntity> list) : CXMLReader(std::make_shared<CStringDataSource>("")), entities(std::move(list)) {}
+
+    bool End() const override {
+        return next == entities.size();
+    }
+
+    bool ReadEntity(SXMLEntity &entity, bool skipcdata) override {
+        if (next == entities.size()) {
+            return false;
+        }
+        entity = entities[next++];
+        return true;
+    }
+};
+
+TEST(OpenStreetMapTest, ReadEntityReaderTest) {
+    // a reader that only overrides ReadEntity still loads through Visit
+    auto element = [](SXMLEntity::EType type, const std::string &name, std::vector<SXMLEntity::TAttribute> attributes) {
+        SXMLEntity entity;
+        entity.DType = type;
+        entity.DNameData = name;
+        entity.DAttributes = std::move(attributes);
+        return entity;
+    };
+    using EType = SXMLEntity::EType;
+    auto reader = std::make_shared<CEntityListReader>(std::vector<SXMLEntity>{
+        element(EType::StartElement, "osm", {}),
+        element(EType::CompleteElement, "node", {{"id", "1"}, {"lat", "38.5"}, {"lon", "-121.7"}}),
+        element(EType::StartElement, "way", {{"id", "10"}}),
+        element(EType::CompleteElement, "nd", {{"ref", "1"}}),
+        element(EType::CompleteElement, "tag", {{"k", "name"}, {"v", "Main"}}),
+        element(EType::EndElement, "way", {}),
+        element(EType::EndElement, "osm", {})});
+    COpenStreetMap map(reader);
+
+    ASSERT_EQ(map.NodeCount(), 1);
+    EXPECT_EQ(map.NodeByID(1)->Location(), CStreetMap::TLocation(38.5, -121.7));
+    ASSERT_EQ(map.WayCount(), 1);
+    EXPECT_EQ(map.WayByID(10)->GetNodeID(0), 1);
+    EXPECT_EQ(map.WayByID(10)->GetAttribute("name"), "Main");
+}
+
+TEST(OpenStreetMapTest, FullSymbolTableTest) {
+    // a reader whose symbol table the document has filled still loads, and
+    // the names that got no symbol are not taken for nodes or ways
+    std::string xml = "<osm>";
+    for (std::size_t index = 0; index < CXMLReader::MaxSymbols; index++) {
+        xml += "<a" + std::to_string(index) + "/>";
+    }
+    xml += "<b id=\"5\" lat=\"1\" lon=\"2\"/><node id=\"1\" lat=\"38.5\" lon=\"-121.7\"/><c id=\"6\"/><way id=\"2\"><nd ref=\"1\"/></way></osm>";
+    auto reader = std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(xml), 1);
+    SXMLEntity entity;
+    std::string last = "a" + std::to_string(CXMLReader::MaxSymbols - 1);
+    while (reader->ReadEntity(entity) && !(entity.DType == SXMLEntity::EType::EndElement && entity.DNameData == last)) {
+    }
+    COpenStreetMap map(reader);
+
+    ASSERT_EQ(map.NodeCount(), 1);
+    EXPECT_EQ(map.NodeByIndex(0)->ID(), 1);
+    ASSERT_EQ(map.WayCount(), 1);
+    EXPECT_EQ(map.WayByIndex(0)->GetNodeID(0), 1);
+}
@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+#include "DSVColumnLoader.h"
+#include "StringDataSource.h"
+
+// creates a comma separated reader over the text
+static std::shared_ptr<CDSVReader> MakeReader(const std::string &text){
+    return std::make_shared<CDSVReader>(std::make_shared<CStringDataSource>(text), ',');
+}
+
+TEST(DSVColumnLoader, HeaderTest){
+    CDSVColumnLoader Loader;
+    auto Name = Loader.AddColumn("name", CDSVColumnLoader::EColumnType::String);
+    auto Lat = Loader.AddColumn("lat", CDSVColumnLoader::EColumnType::Double);
+    auto ID = Loader.AddColumn("id", CDSVColumnLoader::EColumnType::UInt64);
+    auto Kind = Loader.AddColumn("kind", CDSVColumnLoader::EColumnType::Enum);
+
+    EXPECT_TRUE(Loader.Load(MakeReader("id,lat,kind,name\n7,38.5,bus,\"Main, St\"\n8,x,bus,Bad\n9,-1.25,rail,Elm\n10,2\n\n11,0,bus,\n")));
+    ASSERT_EQ(Loader.RowCount(),3);
+    EXPECT_TRUE(Loader.Statistics().DHeaderFound);
+    EXPECT_EQ(Loader.Statistics().DRows,5);
+    EXPECT_EQ(Loader.Statistics().DLoadedRows,3);
+    EXPECT_EQ(Loader.Statistics().DShortRows,1);
+    EXPECT_EQ(Loader.Statistics().DBadRows,1);
+    EXPECT_EQ(Loader.BadValueCount(Lat),1);
+    EXPECT_EQ(Loader.BadValueCount(ID),0);
+    EXPECT_EQ(Loader.UInt64Column(ID),std::vector<uint64_t>({7,9,11}));
+    EXPECT_EQ(Loader.DoubleColumn(Lat),std::vector<double>({38.5,-1.25,0}));
+    EXPECT_EQ(Loader.StringValue(Name,0),"Main, St");
+    EXPECT_EQ(Loader.StringValue(Name,1),"Elm");
+    EXPECT_EQ(Loader.StringValue(Name,2),"");
+    EXPECT_EQ(Loader.EnumColumn(Kind),std::vector<uint32_t>({0,1,0}));
+    EXPECT_EQ(Loader.EnumValueCount(Kind),2);
+    EXPECT_EQ(Loader.EnumValue(Kind,1),"rail");
+}
+
+TEST(DSVColumnLoader, PositionalTest){
+    CDSVColumnLoader Loader;
+    auto Stop = Loader.AddColumn("stop_id", CDSVColumnLoader::EColumnType::UInt64);
+    auto Node = Loader.AddColumn("node_id", CDSVColumnLoader::EColumnType::UInt64);
+
+    EXPECT_TRUE(Loader.Load(MakeReader("1,100\n2,200\n")));
+    EXPECT_FALSE(Loader.Statistics().DHeaderFound);
+    EXPECT_EQ(Loader.UInt64Column(Stop),std::vector<uint64_t>({1,2}));
+    EXPECT_EQ(Loader.UInt64Column(Node),std::vector<uint64_t>({100,200}));
+    EXPECT_TRUE(Loader.DoubleColumn(Stop).empty());
+    EXPECT_TRUE(Loader.UInt64Column(5).empty());
+    EXPECT_FALSE(Loader.Load(MakeReader("")));
+}
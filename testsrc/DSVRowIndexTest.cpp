@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+#include "DSVRowIndex.h"
+#include "DSVReader.h"
+#include "StringDataSource.h"
+#include "StringDataSink.h"
+#include "FileDataSource.h"
+#include "MmapDataSource.h"
+#include "PrefetchDataSource.h"
+#include "GzipDataSource.h"
+#include "GzipDataSink.h"
+
+namespace{
+
+const std::string IndexTestData = "a,b\r\n\"multi\nline\",c\rd,\"e\"\"\r\"\n\nf,g\r\nh";
+
+std::vector< std::vector< std::string > > ReadAllRows(std::shared_ptr< CDataSource > src){
+    CDSVReader Reader(src, ',');
+    std::vector< std::vector< std::string > > Rows;
+    std::vector< std::string > Row;
+    while(Reader.ReadRow(Row)){
+        Rows.push_back(Row);
+    }
+    return Rows;
+}
+
+}
+
+TEST(DSVRowIndex, BuildTest){
+    CDSVRowIndex Index(2);
+
+    EXPECT_TRUE(Index.Build(std::make_shared<CStringDataSource>(IndexTestData)));
+    EXPECT_EQ(Index.Interval(),2);
+    EXPECT_EQ(Index.RowCount(),ReadAllRows(std::make_shared<CStringDataSource>(IndexTestData)).size());
+    EXPECT_EQ(Index.RowCount(),6);
+    ASSERT_EQ(Index.EntryCount(),3);
+    EXPECT_EQ(Index.Offset(0),0);
+    EXPECT_EQ(IndexTestData.substr(Index.Offset(1),2),"d,");
+    EXPECT_EQ(IndexTestData.substr(Index.Offset(2),3),"f,g");
+
+    // tiny blocks split CRLF pairs and quoted text across refills
+    for(std::size_t BlockSize = 1; BlockSize <= 5; BlockSize++){
+        CDSVRowIndex Blocked(2);
+        EXPECT_TRUE(Blocked.Build(std::make_shared<CPrefetchDataSource>(std::make_shared<CStringDataSource>(IndexTestData), BlockSize)));
+        EXPECT_EQ(Blocked.RowCount(),6);
+        ASSERT_EQ(Blocked.EntryCount(),3);
+        for(std::size_t Entry = 0; Entry < 3; Entry++){
+            EXPECT_EQ(Blocked.Offset(Entry),Index.Offset(Entry));
+        }
+    }
+
+    EXPECT_TRUE(Index.Build(std::make_shared<CStringDataSource>("")));
+    EXPECT_EQ(Index.RowCount(),0);
+    EXPECT_EQ(Index.EntryCount(),0);
+
+    EXPECT_TRUE(Index.Build(std::make_shared<CStringDataSource>("a\r\nb\r\n")));
+    EXPECT_EQ(Index.RowCount(),2);
+    EXPECT_EQ(Index.EntryCount(),1);
+}
+
+TEST(DSVRowIndex, SeekRowTest){
+    auto Expected = ReadAllRows(std::make_shared<CStringDataSource>(IndexTestData));
+    for(std::size_t Interval = 1; Interval <= 4; Interval++){
+        CDSVRowIndex Index(Interval);
+        ASSERT_TRUE(Index.Build(std::make_shared<CStringDataSource>(IndexTestData)));
+        for(std::size_t RowIndex = 0; RowIndex < Expected.size(); RowIndex++){
+            CDSVReader Reader(std::make_shared<CStringDataSource>(IndexTestData), ',');
+            std::vector< std::string > Row;
+            ASSERT_TRUE(Reader.SeekRow(Index, RowIndex));
+            for(std::size_t Next = RowIndex; Next < Expected.size(); Next++){
+                ASSERT_TRUE(Reader.ReadRow(Row));
+                EXPECT_EQ(Row,Expected[Next]);
+            }
+            EXPECT_TRUE(Reader.End());
+        }
+        CDSVReader Reader(std::make_shared<CStringDataSource>(IndexTestData), ',');
+        EXPECT_FALSE(Reader.SeekRow(Index, Expected.size()));
+    }
+}
+
+TEST(DSVRowIndex, SidecarTest){
+    CDSVRowIndex Index(3);
+    CDSVRowIndex Loaded;
+    auto Sink = std::make_shared<CStringDataSink>();
+
+    ASSERT_TRUE(Index.Build(std::make_shared<CStringDataSource>(IndexTestData)));
+    EXPECT_TRUE(Index.Save(Sink));
+    EXPECT_TRUE(Loaded.Load(std::make_shared<CStringDataSource>(Sink->String())));
+    EXPECT_EQ(Loaded.Interval(),3);
+    EXPECT_EQ(Loaded.RowCount(),Index.RowCount());
+    ASSERT_EQ(Loaded.EntryCount(),Index.EntryCount());
+    for(std::size_t Entry = 0; Entry < Index.EntryCount(); Entry++){
+        EXPECT_EQ(Loaded.Offset(Entry),Index.Offset(Entry));
+    }
+
+    std::string Corrupt = Sink->String();
+    Corrupt[6] ^= 1;
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(Corrupt)));
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>(Sink->String().substr(0, 7))));
+    EXPECT_FALSE(Loaded.Load(std::make_shared<CStringDataSource>("")));
+    EXPECT_EQ(Loaded.Interval(),3);
+}
+
+TEST(DSVRowIndex, FileSeekTest){
+    CDSVRowIndex Index(16);
+    auto Expected = ReadAllRows(std::make_shared<CMmapDataSource>("data/stops.csv"));
+
+    ASSERT_TRUE(Index.Build(std::make_shared<CFileDataSource>("data/stops.csv", 100)));
+    EXPECT_EQ(Index.RowCount(),Expected.size());
+    CDSVReader Reader(std::make_shared<CFileDataSource>("data/stops.csv", 100), ',');
+    std::vector< std::string > Row;
+    for(std::size_t RowIndex : {250, 17, 0, 297, 120}){
+        ASSERT_TRUE(Reader.SeekRow(Index, RowIndex));
+        ASSERT_TRUE(Reader.ReadRow(Row));
+        EXPECT_EQ(Row,Expected[RowIndex]);
+    }
+}
+
+TEST(DSVRowIndex, UnseekableTest){
+    // gzip sources cannot seek and are read through the prefetch ring, a
+    // failed seek must leave the blocks already read ahead in place, the data
+    // spans several ring blocks so the producer keeps running meanwhile
+    std::string Text;
+    {
+        std::vector<char> Data;
+        CMmapDataSource Source("data/stops.csv");
+        ASSERT_TRUE(Source.Read(Data, Source.Size()));
+        for(int Copy = 0; Copy < 300; Copy++){
+            Text.append(Data.data(), Data.size());
+        }
+    }
+    auto Expected = ReadAllRows(std::make_shared<CStringDataSource>(Text));
+    auto Compressed = std::make_shared<CStringDataSink>();
+    {
+        CGzipDataSink Sink(Compressed);
+        ASSERT_TRUE(Sink.Write(std::vector<char>(Text.begin(), Text.end())));
+        ASSERT_TRUE(Sink.Close());
+    }
+    CDSVRowIndex Index(16);
+    ASSERT_TRUE(Index.Build(std::make_shared<CStringDataSource>(Text)));
+    auto Source = std::make_shared<CGzipDataSource>(std::make_shared<CStringDataSource>(Compressed->String()));
+    ASSERT_TRUE(Source->Blocking());
+    CDSVReader Reader(Source, ',');
+    std::vector< std::string > Row;
+    for(std::size_t RowIndex = 0; RowIndex < Expected.size(); RowIndex++){
+        if(RowIndex % 997 == 3){
+            EXPECT_FALSE(Reader.SeekRow(Index, 0));
+        }
+        ASSERT_TRUE(Reader.ReadRow(Row));
+        ASSERT_EQ(Row,Expected[RowIndex]);
+    }
+    EXPECT_FALSE(Reader.SeekRow(Index, 0));
+    EXPECT_FALSE(Reader.ReadRow(Row));
+    EXPECT_TRUE(Reader.End());
+}
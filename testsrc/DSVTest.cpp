@@ -22,8 +22,184 @@ TEST(DSVTest, BasicReadWrite) {
         // for each row read and write it to the sink
         writer.WriteRow(row);
     }
+    // push the buffered rows out to the sink
+    EXPECT_TRUE(writer.Flush());
 
     // assert that string output from sink matches expected DSV content
     EXPECT_EQ(sink->String(), "hello,anikaandaleena,hi\na,b,c\n");
 }
 
+
+TEST(DSVTest, QuotedFieldsTest) {
+    // quoted delimiters, newlines and doubled quotes, with windows line endings
+    std::string longfield(150, 'x');
+    std::shared_ptr<CStringDataSource> src = std::make_shared<CStringDataSource>(
+        "a,\"b,c\",\"say \"\"hi\"\"\"\r\n\r\n\"multi\nline\"," + longfield + ",\"" + longfield + ",\"\n;last");
+    CDSVReader reader(src, ',');
+    std::vector<std::string> row;
+
+    EXPECT_TRUE(reader.ReadRow(row));
+    EXPECT_EQ(row, std::vector<std::string>({"a", "b,c", "say \"hi\""}));
+    EXPECT_TRUE(reader.ReadRow(row));
+    EXPECT_TRUE(row.empty());
+    EXPECT_TRUE(reader.ReadRow(row));
+    EXPECT_EQ(row, std::vector<std::string>({"multi\nline", longfield, longfield + ","}));
+    EXPECT_TRUE(reader.ReadRow(row));
+    EXPECT_EQ(row, std::vector<std::string>({";last"}));
+    EXPECT_TRUE(reader.End());
+    EXPECT_FALSE(reader.ReadRow(row));
+    EXPECT_TRUE(row.empty());
+}
+
+TEST(DSVTest, ReadRowViewTest) {
+    std::shared_ptr<CStringDataSource> src = std::make_shared<CStringDataSource>("plain,\"quoted\",\"a\"\"b\",\r\nnext\n");
+    CDSVReader reader(src, ',');
+    std::vector<std::string_view> row;
+
+    EXPECT_TRUE(reader.ReadRowView(row));
+    ASSERT_EQ(row.size(), 4);
+    EXPECT_EQ(row[0], "plain");
+    EXPECT_EQ(row[1], "quoted");
+    EXPECT_EQ(row[2], "a\"b");
+    EXPECT_EQ(row[3], "");
+    EXPECT_TRUE(reader.ReadRowView(row));
+    EXPECT_EQ(row, std::vector<std::string_view>({"next"}));
+    EXPECT_TRUE(reader.End());
+    EXPECT_FALSE(reader.ReadRowView(row));
+    EXPECT_TRUE(row.empty());
+}
+
+TEST(DSVTest, WriterQuotingTest) {
+    std::shared_ptr<CStringDataSink> sink = std::make_shared<CStringDataSink>();
+    std::string longfield(100, 'x');
+    {
+        CDSVWriter writer(sink, ',');
+        EXPECT_TRUE(writer.WriteRow({"a", "b,c", "say \"hi\"", "multi\nline", "cr\rend"}));
+        EXPECT_TRUE(writer.WriteRow({}));
+        EXPECT_TRUE(writer.WriteRow({longfield + "\"" + longfield, longfield}));
+        // nothing reaches the sink until a batch fills or the writer flushes
+        EXPECT_EQ(sink->String(), "");
+    }
+    EXPECT_EQ(sink->String(), "a,\"b,c\",\"say \"\"hi\"\"\",\"multi\nline\",\"cr\rend\"\n\n\"" + longfield + "\"\"" + longfield + "\"," + longfield + "\n");
+
+    std::shared_ptr<CStringDataSink> quoted = std::make_shared<CStringDataSink>();
+    CDSVWriter writer(quoted, ';', true);
+    EXPECT_TRUE(writer.WriteRow({"a", ""}));
+    EXPECT_TRUE(writer.Flush());
+    EXPECT_EQ(quoted->String(), "\"a\";\"\"\n");
+}
+
+TEST(DSVTest, WriterBatchTest) {
+    // enough rows to fill several batches, read back to check nothing is lost
+    std::shared_ptr<CStringDataSink> sink = std::make_shared<CStringDataSink>();
+    CDSVWriter writer(sink, ',');
+    std::vector<std::vector<std::string>> rows;
+    for (int i = 0; i < 20000; i++) {
+        rows.push_back({std::to_string(i), "field \"" + std::to_string(i * 7) + "\"", "x,y"});
+        EXPECT_TRUE(writer.WriteRow(rows.back()));
+    }
+    EXPECT_FALSE(sink->String().empty());
+    EXPECT_TRUE(writer.Flush());
+
+    CDSVReader reader(std::make_shared<CStringDataSource>(sink->String()), ',');
+    std::vector<std::string> row;
+    for (const auto &expected : rows) {
+        ASSERT_TRUE(reader.ReadRow(row));
+        EXPECT_EQ(row, expected);
+    }
+    EXPECT_FALSE(reader.ReadRow(row));
+}
+
+// a sink whose writes fail until it is told to accept them
+class CFailingDataSink : public CDataSink {
+    public:
+        bool fail = true;
+        std::string data;
+
+        bool Put(const char &ch) noexcept override {
+            if (fail) return false;
+            data += ch;
+            return true;
+        }
+
+        bool Write(const std::vector<char> &buf) noexcept override {
+            if (fail) return false;
+            data.append(buf.begin(), buf.end());
+            return true;
+        }
+};
+
+TEST(DSVTest, WriterFailedWriteTest) {
+    // rows stay buffered when the sink fails and go out on the next flush
+    std::shared_ptr<CFailingDataSink> sink = std::make_shared<CFailingDataSink>();
+    CDSVWriter writer(sink, ',');
+    EXPECT_TRUE(writer.WriteRow({"a", "b"}));
+    EXPECT_FALSE(writer.Flush());
+    EXPECT_TRUE(writer.WriteRow({"c"}));
+    sink->fail = false;
+    EXPECT_TRUE(writer.Flush());
+    EXPECT_EQ(sink->data, "a,b\nc\n");
+}
+
+TEST(DSVTest, WriteFieldsTest) {
+    std::shared_ptr<CStringDataSink> sink = std::make_shared<CStringDataSink>();
+    CDSVWriter writer(sink, ',');
+    std::string name = "main, st";
+
+    EXPECT_TRUE(writer.WriteFields(22, uint64_t(18446744073709551615ULL), -7, 38.5, "x", std::string_view("y\"z"), name, 'c'));
+    EXPECT_TRUE(writer.WriteFields());
+    EXPECT_TRUE(writer.WriteFields(0.1, -121.7405, 1e21));
+    EXPECT_TRUE(writer.Flush());
+    EXPECT_EQ(sink->String(), "22,18446744073709551615,-7,38.5,x,\"y\"\"z\",\"main, st\",c\n\n0.1,-121.7405,1e+21\n");
+
+    // numbers are quoted when the delimiter could appear in them
+    std::shared_ptr<CStringDataSink> dotted = std::make_shared<CStringDataSink>();
+    CDSVWriter dotwriter(dotted, '.');
+    EXPECT_TRUE(dotwriter.WriteFields(1, 2.5, "a"));
+    std::shared_ptr<CStringDataSink> quoted = std::make_shared<CStringDataSink>();
+    CDSVWriter quotewriter(quoted, ',', true);
+    EXPECT_TRUE(quotewriter.WriteFields(1, 2.5, "a"));
+    EXPECT_TRUE(dotwriter.Flush());
+    EXPECT_TRUE(quotewriter.Flush());
+    EXPECT_EQ(dotted->String(), "1.\"2.5\".a\n");
+    EXPECT_EQ(quoted->String(), "\"1\",\"2.5\",\"a\"\n");
+}
+
+TEST(DSVTest, WriteColumnsTest) {
+    std::shared_ptr<CStringDataSink> sink = std::make_shared<CStringDataSink>();
+    CDSVWriter writer(sink, ',');
+    std::vector<uint64_t> ids = {1, 2, 3};
+    std::vector<int64_t> nodes = {-10, 20, 30, 40};
+    std::vector<double> lats = {38.5, -0.25, 1.0};
+    std::vector<std::string> names = {"a", "b,c", "d"};
+    std::vector<std::string_view> tags = {"x", "y", "\"z\""};
+
+    // the extra node makes the columns uneven, nothing is written
+    EXPECT_FALSE(writer.WriteColumns({ids, nodes, lats, names, tags}));
+    EXPECT_TRUE(writer.Flush());
+    EXPECT_EQ(sink->String(), "");
+    nodes.pop_back();
+    EXPECT_TRUE(writer.WriteColumns({ids, nodes, lats, names, tags}));
+    EXPECT_TRUE(writer.WriteColumns({}));
+    EXPECT_TRUE(writer.Flush());
+    EXPECT_EQ(sink->String(), "1,-10,38.5,a,x\n2,20,-0.25,\"b,c\",y\n3,30,1,d,\"\"\"z\"\"\"\n");
+}
+
+TEST(DSVTest, WriteColumnsQuotedTest) {
+    // quoted numbers are formatted straight into the buffer, the quote goes
+    // in front only when it is needed
+    std::shared_ptr<CStringDataSink> quoted = std::make_shared<CStringDataSink>();
+    std::shared_ptr<CStringDataSink> dashed = std::make_shared<CStringDataSink>();
+    CDSVWriter quotewriter(quoted, ',', true);
+    CDSVWriter dashwriter(dashed, '-');
+    std::vector<int64_t> values = {-1, 0, 12345678901234};
+    std::vector<double> doubles = {-0.5, 1e300, 2.0};
+    std::vector<std::string> names = {"a", "b-c", ""};
+
+    EXPECT_TRUE(quotewriter.WriteColumns({values, doubles, names}));
+    EXPECT_TRUE(dashwriter.WriteColumns({values, doubles, names}));
+    EXPECT_TRUE(quotewriter.Flush());
+    EXPECT_TRUE(dashwriter.Flush());
+    EXPECT_EQ(quoted->String(), "\"-1\",\"-0.5\",\"a\"\n\"0\",\"1e+300\",\"b-c\"\n\"12345678901234\",\"2\",\"\"\n");
+    EXPECT_EQ(dashed->String(), "\"-1\"-\"-0.5\"-a\n0-1e+300-\"b-c\"\n12345678901234-2-\n");
+}
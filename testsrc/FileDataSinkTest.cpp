@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include "FileDataSink.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+// returns a fresh temporary file name
+static std::string TempFileName(){
+    char FileName[] = "/tmp/filesinkXXXXXX";
+    int FileDescriptor = mkstemp(FileName);
+    if(FileDescriptor >= 0){
+        close(FileDescriptor);
+    }
+    return FileName;
+}
+
+// returns the whole contents of the file
+static std::string FileContents(const std::string &filename){
+    std::ifstream Input(filename, std::ios::binary);
+    std::stringstream Contents;
+    Contents << Input.rdbuf();
+    return Contents.str();
+}
+
+TEST(FileDataSink, OpenTest){
+    CFileDataSink MissingSink("/nonexistent/dir/out.csv");
+
+    EXPECT_FALSE(MissingSink.IsOpen());
+    EXPECT_FALSE(MissingSink.Put('x'));
+    EXPECT_FALSE(MissingSink.Write({'x'}));
+}
+
+TEST(FileDataSink, PutWriteTest){
+    std::string FileName = TempFileName();
+    {
+        CFileDataSink Sink(FileName);
+        ASSERT_TRUE(Sink.IsOpen());
+        EXPECT_TRUE(Sink.Put('H'));
+        EXPECT_TRUE(Sink.Write({'e','l','l','o'}));
+        EXPECT_EQ(FileContents(FileName),"");
+        EXPECT_TRUE(Sink.Flush());
+        EXPECT_EQ(FileContents(FileName),"Hello");
+        EXPECT_TRUE(Sink.Write({' ','W','o','r','l','d'}));
+    }
+    EXPECT_EQ(FileContents(FileName),"Hello World");
+    std::remove(FileName.c_str());
+}
+
+TEST(FileDataSink, LargeWriteTest){
+    std::string FileName = TempFileName();
+    std::string Expected;
+    for(int Index = 0; Index < 5000; Index++){
+        Expected += std::to_string(Index) + ",";
+    }
+    std::vector<char> Block(Expected.begin(), Expected.end());
+    for(bool Direct : {false, true}){
+        CFileDataSink Sink(FileName, 4096, Direct, CFileDataSink::ESyncPolicy::OnFlush);
+        ASSERT_TRUE(Sink.IsOpen());
+        for(std::size_t Index = 0; Index < 100; Index++){
+            EXPECT_TRUE(Sink.Put(Expected[Index]));
+        }
+        EXPECT_TRUE(Sink.Write(std::vector<char>(Block.begin() + 100, Block.end())));
+        EXPECT_TRUE(Sink.Close());
+        EXPECT_FALSE(Sink.Put('x'));
+        EXPECT_EQ(FileContents(FileName),Expected);
+    }
+    std::remove(FileName.c_str());
+}
+
+TEST(FileDataSink, FlushTailTest){
+    std::string FileName = TempFileName();
+    std::string First(5000, 'a'), Second(10000, 'b');
+    for(bool Direct : {false, true}){
+        CFileDataSink Sink(FileName, 8192, Direct);
+        ASSERT_TRUE(Sink.IsOpen());
+        // a flush in the middle of a block still puts every byte in the file
+        EXPECT_TRUE(Sink.Write(std::vector<char>(First.begin(), First.end())));
+        EXPECT_TRUE(Sink.Flush());
+        EXPECT_EQ(FileContents(FileName),First);
+        EXPECT_TRUE(Sink.Write(std::vector<char>(Second.begin(), Second.end())));
+        EXPECT_TRUE(Sink.Flush());
+        EXPECT_EQ(FileContents(FileName),First + Second);
+        EXPECT_TRUE(Sink.Put('c'));
+        EXPECT_TRUE(Sink.Close());
+        EXPECT_EQ(FileContents(FileName),First + Second + "c");
+    }
+    std::remove(FileName.c_str());
+}
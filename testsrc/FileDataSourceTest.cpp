@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+#include "FileDataSource.h"
+#include "DSVReader.h"
+
+TEST(FileDataSource, OpenTest){
+    CFileDataSource MissingSource("/nonexistent/file.csv");
+    char TempCh = 'x';
+
+    EXPECT_FALSE(MissingSource.IsOpen());
+    EXPECT_TRUE(MissingSource.End());
+    EXPECT_FALSE(MissingSource.Get(TempCh));
+    EXPECT_EQ(TempCh,'x');
+}
+
+TEST(FileDataSource, ReadTest){
+    CFileDataSource Source("data/stops.csv", 4);
+    std::vector< char > TempVector;
+    char Buffer[64];
+    char TempCh = 'x';
+
+    ASSERT_TRUE(Source.IsOpen());
+    EXPECT_TRUE(Source.Blocking());
+    EXPECT_TRUE(Source.Peek(TempCh));
+    EXPECT_EQ(TempCh,'s');
+    EXPECT_TRUE(Source.Read(TempVector,7));
+    EXPECT_EQ(std::string(TempVector.begin(),TempVector.end()),"stop_id");
+    EXPECT_EQ(Source.ReadBlock(Buffer,10),10);
+    EXPECT_EQ(std::string(Buffer,10),",node_id\r\n");
+    std::size_t Total = 17;
+    while(!Source.End()){
+        Total += Source.ReadBlock(Buffer,sizeof(Buffer));
+    }
+    EXPECT_EQ(Total,5111);
+}
+
+TEST(FileDataSource, DSVReaderTest){
+    CDSVReader Reader(std::make_shared<CFileDataSource>("data/stops.csv"), ',');
+    std::vector<std::string> Row;
+    std::size_t Rows = 0;
+
+    EXPECT_TRUE(Reader.ReadRow(Row));
+    EXPECT_EQ(Row,std::vector<std::string>({"stop_id","node_id"}));
+    while(Reader.ReadRow(Row)){
+        EXPECT_EQ(Row.size(),2);
+        Rows++;
+    }
+    EXPECT_EQ(Rows,298);
+    EXPECT_TRUE(Reader.End());
+}
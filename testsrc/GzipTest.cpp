@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include "GzipDataSource.h"
+#include "GzipDataSink.h"
+#include "StringDataSource.h"
+#include "StringDataSink.h"
+#include "FileDataSource.h"
+#include "DSVReader.h"
+#include "XMLReader.h"
+
+// compresses the string into a single gzip member
+static std::string Compress(const std::string &str, std::size_t buffersize = CGzipDataSink::DefaultBufferSize){
+    auto Sink = std::make_shared<CStringDataSink>();
+    CGzipDataSink GzipSink(Sink, CGzipDataSink::DefaultLevel, buffersize);
+    GzipSink.Write(std::vector<char>(str.begin(), str.end()));
+    GzipSink.Close();
+    return Sink->String();
+}
+
+TEST(GzipTest, RoundTripTest){
+    auto Sink = std::make_shared<CStringDataSink>();
+    CGzipDataSink GzipSink(Sink);
+
+    EXPECT_TRUE(GzipSink.Put('H'));
+    EXPECT_TRUE(GzipSink.Write({'e','l','l','o'}));
+    EXPECT_TRUE(GzipSink.Close());
+    EXPECT_FALSE(GzipSink.Put('x'));
+    ASSERT_GE(Sink->String().size(),2);
+    EXPECT_EQ(Sink->String()[0],'\x1f');
+    EXPECT_EQ(Sink->String()[1],'\x8b');
+
+    CGzipDataSource Source(std::make_shared<CStringDataSource>(Sink->String()));
+    std::vector< char > TempVector;
+    char TempCh = 'x';
+    EXPECT_FALSE(Source.End());
+    EXPECT_TRUE(Source.Peek(TempCh));
+    EXPECT_EQ(TempCh,'H');
+    EXPECT_TRUE(Source.Get(TempCh));
+    EXPECT_EQ(TempCh,'H');
+    EXPECT_TRUE(Source.Read(TempVector,10));
+    EXPECT_EQ(std::string(TempVector.begin(),TempVector.end()),"ello");
+    EXPECT_TRUE(Source.End());
+    EXPECT_FALSE(Source.Error());
+}
+
+TEST(GzipTest, MultiMemberAndSmallBufferTest){
+    std::string Text;
+    for(int Index = 0; Index < 2000; Index++){
+        Text += std::to_string(Index * 7919) + (Index % 10 ? "," : "\n");
+    }
+    std::string Compressed = Compress(Text, 16) + Compress("tail");
+    CGzipDataSource Source(std::make_shared<CStringDataSource>(Compressed), 7);
+    std::string Result;
+    const char *Data = nullptr;
+    std::size_t Length;
+
+    while((Length = Source.Borrow(Data,5))){
+        Result.append(Data,Length);
+    }
+    EXPECT_EQ(Result,Text + "tail");
+    EXPECT_FALSE(Source.Error());
+}
+
+TEST(GzipTest, CorruptTest){
+    std::string Compressed = Compress("Hello World, Hello World, Hello World");
+    CGzipDataSource Truncated(std::make_shared<CStringDataSource>(Compressed.substr(0, Compressed.size() / 2)));
+    CGzipDataSource Garbage(std::make_shared<CStringDataSource>("not gzip data"));
+    std::vector< char > TempVector;
+
+    Truncated.Read(TempVector,100);
+    EXPECT_TRUE(Truncated.End());
+    EXPECT_TRUE(Truncated.Error());
+    EXPECT_FALSE(Garbage.Read(TempVector,100));
+    EXPECT_TRUE(Garbage.Error());
+}
+
+TEST(GzipTest, ReaderTest){
+    std::string Stops = Compress("stop_id,node_id\n1,100\n2,200\n");
+    CDSVReader DSVReader(std::make_shared<CGzipDataSource>(std::make_shared<CStringDataSource>(Stops)), ',');
+    std::vector<std::string> Row;
+
+    EXPECT_TRUE(DSVReader.ReadRow(Row));
+    EXPECT_TRUE(DSVReader.ReadRow(Row));
+    EXPECT_EQ(Row,std::vector<std::string>({"1","100"}));
+    EXPECT_TRUE(DSVReader.ReadRow(Row));
+    EXPECT_FALSE(DSVReader.ReadRow(Row));
+
+    // the compressed map must parse to the same entities as the plain one
+    std::vector<char> Map;
+    CFileDataSource MapSource("data/davis.osm");
+    ASSERT_TRUE(MapSource.Read(Map, 1 << 22));
+    CXMLReader PlainReader(std::make_shared<CStringDataSource>(std::string(Map.begin(), Map.end())));
+    CXMLReader GzipReader(std::make_shared<CGzipDataSource>(std::make_shared<CStringDataSource>(Compress(std::string(Map.begin(), Map.end())))));
+    SXMLEntity PlainEntity, GzipEntity;
+    std::size_t Count = 0;
+    while(PlainReader.ReadEntity(PlainEntity, true)){
+        ASSERT_TRUE(GzipReader.ReadEntity(GzipEntity, true));
+        EXPECT_EQ(PlainEntity.DNameData,GzipEntity.DNameData);
+        EXPECT_EQ(PlainEntity.DAttributes,GzipEntity.DAttributes);
+        Count++;
+    }
+    EXPECT_FALSE(GzipReader.ReadEntity(GzipEntity, true));
+    EXPECT_GT(Count,10000);
+}
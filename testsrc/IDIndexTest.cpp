@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include "IDIndex.h"
+#include <random>
+#include <unordered_map>
+
+namespace{
+
+// checks every id and a set of missing ids against a scan of the list
+void ExpectMatchesScan(const CIDIndex &index, const std::vector<uint64_t> &ids, const std::vector<uint64_t> &missing){
+    std::unordered_map<uint64_t, std::size_t> First;
+    for(std::size_t Index = 0; Index < ids.size(); Index++){
+        First.emplace(ids[Index], Index);
+    }
+    EXPECT_EQ(index.Count(), First.size());
+    for(const auto &Entry : First){
+        EXPECT_EQ(index.Find(Entry.first), Entry.second) << Entry.first;
+    }
+    for(auto Id : missing){
+        EXPECT_EQ(index.Find(Id), CIDIndex::NotFound) << Id;
+    }
+}
+
+}
+
+TEST(IDIndex, SmallTest){
+    for(auto Kind : {CIDIndex::EKind::Eytzinger, CIDIndex::EKind::Hash}){
+        CIDIndex Index(Kind);
+        EXPECT_EQ(Index.Kind(), Kind);
+        EXPECT_EQ(Index.Find(1), CIDIndex::NotFound);
+        Index.Build({});
+        EXPECT_EQ(Index.Count(), 0);
+        EXPECT_EQ(Index.Find(0), CIDIndex::NotFound);
+
+        // duplicates keep the first position like a front to back scan
+        std::vector<uint64_t> Ids = {30, 10, 20, 10, 0, UINT64_MAX, 30};
+        Index.Build(Ids);
+        ExpectMatchesScan(Index, Ids, {1, 15, 25, 31, UINT64_MAX - 1});
+        EXPECT_EQ(Index.Find(10), 1);
+        EXPECT_EQ(Index.Find(30), 0);
+    }
+}
+
+TEST(IDIndex, RandomTest){
+    std::mt19937_64 Generator(42);
+    for(std::size_t Size : {1, 2, 3, 7, 8, 100, 1023, 1024, 1025, 50000}){
+        std::vector<uint64_t> Ids, Missing;
+        for(std::size_t Index = 0; Index < Size; Index++){
+            // even ids are present so odd ones are known to be missing
+            Ids.push_back((Generator() % (Size * 4)) * 2);
+            Missing.push_back(Ids.back() + 1);
+        }
+        for(auto Kind : {CIDIndex::EKind::Eytzinger, CIDIndex::EKind::Hash}){
+            CIDIndex Index(Kind);
+            Index.Build(Ids);
+            ExpectMatchesScan(Index, Ids, Missing);
+        }
+    }
+}
+
+TEST(IDIndex, MemoryUsageTest){
+    std::vector<uint64_t> Ids;
+    for(uint64_t Id = 0; Id < 10000; Id++){
+        Ids.push_back(Id * 3);
+    }
+    CIDIndex Sorted(CIDIndex::EKind::Eytzinger), Hashed(CIDIndex::EKind::Hash);
+    Sorted.Build(Ids);
+    Hashed.Build(Ids);
+    EXPECT_GE(Sorted.MemoryUsage(), Ids.size() * 2 * sizeof(uint64_t));
+    // the hash table trades at least twice the slots for fewer probes
+    EXPECT_GE(Hashed.MemoryUsage(), 2 * Sorted.MemoryUsage() - 2 * 2 * sizeof(uint64_t));
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include "MmapDataSource.h"
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+
+// writes the contents to a fresh temporary file and returns its name
+static std::string CreateTempFile(const std::string &contents){
+    char FileName[] = "/tmp/mmapsourceXXXXXX";
+    int FileDescriptor = mkstemp(FileName);
+    if(FileDescriptor >= 0){
+        if(!contents.empty() && write(FileDescriptor, contents.data(), contents.size()) < 0){
+            FileName[0] = '\0';
+        }
+        close(FileDescriptor);
+    }
+    return FileName;
+}
+
+TEST(MmapDataSource, OpenTest){
+    std::string EmptyFile = CreateTempFile("");
+    CMmapDataSource MissingSource("/nonexistent/file.osm");
+    CMmapDataSource EmptySource(EmptyFile);
+
+    EXPECT_FALSE(MissingSource.IsOpen());
+    EXPECT_TRUE(MissingSource.End());
+    EXPECT_TRUE(EmptySource.IsOpen());
+    EXPECT_TRUE(EmptySource.End());
+    EXPECT_EQ(EmptySource.Size(),0);
+    std::remove(EmptyFile.c_str());
+}
+
+TEST(MmapDataSource, GetPeekTest){
+    std::string FileName = CreateTempFile("Hello");
+    CMmapDataSource Source(FileName);
+    char TempCh = 'x';
+
+    ASSERT_TRUE(Source.IsOpen());
+    EXPECT_FALSE(Source.End());
+    EXPECT_TRUE(Source.Peek(TempCh));
+    EXPECT_EQ(TempCh,'H');
+    EXPECT_TRUE(Source.Get(TempCh));
+    EXPECT_EQ(TempCh,'H');
+    EXPECT_TRUE(Source.Get(TempCh));
+    EXPECT_EQ(TempCh,'e');
+    EXPECT_EQ(Source.Position(),2);
+    EXPECT_EQ(Source.Advance(10),3);
+    EXPECT_TRUE(Source.End());
+    TempCh = 'x';
+    EXPECT_FALSE(Source.Get(TempCh));
+    EXPECT_EQ(TempCh,'x');
+    std::remove(FileName.c_str());
+}
+
+TEST(MmapDataSource, ReadSpanTest){
+    std::string FileName = CreateTempFile("stop_id,node_id\n22043,2849810514\n");
+    CMmapDataSource Source(FileName);
+    std::vector< char > TempVector;
+
+    ASSERT_EQ(Source.Size(),33);
+    EXPECT_EQ(std::string(Source.Data(),Source.Size()),"stop_id,node_id\n22043,2849810514\n");
+    EXPECT_TRUE(Source.Read(TempVector,7));
+    EXPECT_EQ(std::string(TempVector.begin(),TempVector.end()),"stop_id");
+    EXPECT_TRUE(Source.Read(TempVector,100));
+    EXPECT_EQ(TempVector.size(),26);
+    EXPECT_FALSE(Source.Read(TempVector,1));
+    EXPECT_TRUE(TempVector.empty());
+    std::remove(FileName.c_str());
+}
+
+TEST(MmapDataSource, AccessTest){
+    std::string FileName = CreateTempFile("Hello");
+    CMmapDataSource Source(FileName, CMmapDataSource::EAccess::Random);
+    CMmapDataSource MissingSource("/nonexistent/file.osm", CMmapDataSource::EAccess::Random);
+    char Ch;
+
+    // the hint only changes paging, the data reads the same
+    ASSERT_TRUE(Source.IsOpen());
+    EXPECT_TRUE(Source.Seek(4));
+    EXPECT_TRUE(Source.Get(Ch));
+    EXPECT_EQ(Ch,'o');
+    EXPECT_TRUE(Source.Advise(CMmapDataSource::EAccess::Sequential));
+    EXPECT_TRUE(Source.Advise(CMmapDataSource::EAccess::Random));
+    EXPECT_FALSE(MissingSource.Advise(CMmapDataSource::EAccess::Random));
+    std::remove(FileName.c_str());
+}
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include "OSMXMLTokenizer.h"
+#include "XMLReader.h"
+#include "StringDataSource.h"
+#include "MmapDataSource.h"
+
+namespace{
+
+// reads entities until the reader stops and flattens them into one line each
+std::vector< std::string > ReadEntities(std::shared_ptr< CDataSource > src, CXMLReader::EBackend backend, std::size_t blocksize = CXMLReader::DefaultBlockSize){
+    CXMLReader Reader(src, blocksize, backend);
+    SXMLEntity Entity;
+    std::vector< std::string > Lines;
+    while(Reader.ReadEntity(Entity)){
+        std::string Line = std::to_string(static_cast<int>(Entity.DType)) + ":" + Entity.DNameData;
+        for(auto &Attribute : Entity.DAttributes){
+            Line += " " + Attribute.first + "=" + Attribute.second;
+        }
+        Lines.push_back(Line);
+    }
+    Lines.push_back(Reader.End() ? "end" : "stopped");
+    return Lines;
+}
+
+void ExpectSameAsExpat(const std::string &xml){
+    auto Expected = ReadEntities(std::make_shared<CStringDataSource>(xml), CXMLReader::EBackend::Expat);
+    for(std::size_t BlockSize : {1, 2, 5, 64, 4096}){
+        EXPECT_EQ(ReadEntities(std::make_shared<CStringDataSource>(xml), CXMLReader::EBackend::OSM, BlockSize), Expected) << xml << " block size " << BlockSize;
+    }
+}
+
+void ExpectBothStop(const std::string &xml){
+    for(std::size_t BlockSize : {1, 2, 5, 64, 4096}){
+        EXPECT_EQ(ReadEntities(std::make_shared<CStringDataSource>(xml), CXMLReader::EBackend::Expat, BlockSize).back(), "stopped") << xml << " block size " << BlockSize;
+        EXPECT_EQ(ReadEntities(std::make_shared<CStringDataSource>(xml), CXMLReader::EBackend::OSM, BlockSize).back(), "stopped") << xml << " block size " << BlockSize;
+    }
+}
+
+class CRecordingHandler : public COSMXMLTokenizer::SHandler{
+    public:
+        std::vector< std::string > DEvents;
+
+        void StartElement(const char *name, const char **attributes) override{
+            std::string Event = std::string("<") + name;
+            for(int Index = 0; attributes[Index]; Index += 2){
+                Event += std::string(" ") + attributes[Index] + "=" + attributes[Index + 1];
+            }
+            DEvents.push_back(Event);
+        };
+        void EndElement(const char *name) override{
+            DEvents.push_back(std::string("/") + name);
+        };
+        void CharData(const char *data, std::size_t length) override{
+            DEvents.push_back(std::string(data, length));
+        };
+};
+
+}
+
+TEST(OSMXMLTokenizer, TokenizerTest){
+    CRecordingHandler Handler;
+    COSMXMLTokenizer Tokenizer(Handler);
+    std::string XML = "<?xml version='1.0' encoding='UTF-8'?>\n<osm a=\"x &amp; y\tz\"><node id='1'/>\r\n<tag k=\"&#x41;&lt;\"></tag></osm>";
+
+    EXPECT_EQ(Tokenizer.Parse(XML.data(), 20, false), COSMXMLTokenizer::EStatus::Ok);
+    EXPECT_EQ(Tokenizer.Parse(XML.data() + 20, XML.size() - 20, false), COSMXMLTokenizer::EStatus::Ok);
+    EXPECT_EQ(Tokenizer.Parse(nullptr, 0, true), COSMXMLTokenizer::EStatus::Ok);
+    EXPECT_EQ(Handler.DEvents, std::vector< std::string >({"<osm a=x & y z", "<node id=1", "/node", "\n", "<tag k=A<", "/tag", "/osm"}));
+    EXPECT_TRUE(Tokenizer.OpenElements().empty());
+}
+
+TEST(OSMXMLTokenizer, UnexpectedTest){
+    CRecordingHandler Handler;
+    COSMXMLTokenizer Tokenizer(Handler);
+    std::string XML = "<osm><node id=\"1\"><!-- note --></node></osm>";
+
+    EXPECT_EQ(Tokenizer.Parse(XML.data(), XML.size(), false), COSMXMLTokenizer::EStatus::Unexpected);
+    EXPECT_EQ(Tokenizer.Remainder(), "<!-- note --></node></osm>");
+    EXPECT_EQ(Tokenizer.OpenElements(), std::vector< std::string >({"osm", "node"}));
+    EXPECT_EQ(Handler.DEvents, std::vector< std::string >({"<osm", "<node id=1"}));
+    // later input is kept for whoever takes over
+    EXPECT_EQ(Tokenizer.Parse("\n", 1, true), COSMXMLTokenizer::EStatus::Unexpected);
+    EXPECT_EQ(Tokenizer.Remainder(), "<!-- note --></node></osm>\n");
+}
+
+TEST(OSMXMLTokenizer, DifferentialTest){
+    // constructs the tokenizer handles itself
+    ExpectSameAsExpat("<osm/>");
+    ExpectSameAsExpat("\n<osm version=\"0.6\">\n <node id=\"1\" lat=\"38.5\" lon=\"-121.7\"/>\n</osm>\n");
+    ExpectSameAsExpat("<?xml version=\"1.0\" encoding=\"utf-8\"?><osm><tag k=\"name\" v=\"Caf\xC3\xA9 &quot;1&quot; &#233;&#x1F600;\"/></osm>");
+    ExpectSameAsExpat("<osm a = 'tab\there' b=\"line\r\nbreak\" c=\"&#13;&#10;\">text\r\nmore\rend &gt; ] ></osm>");
+    ExpectSameAsExpat("<osm><way id=\"1\"><nd ref=\"2\"/><nd ref=\"3\" /></way ></osm>");
+    // constructs that are handed over to expat
+    ExpectSameAsExpat("<osm><node id=\"1\"><!-- comment --><tag k=\"a\" v=\"b\"/></node><way id=\"2\"/></osm>");
+    ExpectSameAsExpat("<!DOCTYPE osm><osm><node id=\"1\"/></osm>");
+    ExpectSameAsExpat("<osm><node><![CDATA[<raw>]]></node>after</osm>");
+    ExpectSameAsExpat("<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?><osm><tag v=\"\xE9\"/></osm>");
+    ExpectSameAsExpat("\xEF\xBB\xBF<osm><node id=\"1\"/></osm>");
+    ExpectSameAsExpat("<osm><?pi data?><node id=\"1\"/></osm>");
+    ExpectSameAsExpat("\n<?xml version=\"1.0\"?><osm/>");
+    ExpectSameAsExpat(" \r\n<?pi data?><osm><node id=\"1\"/></osm>");
+    ExpectSameAsExpat("<osm><n\xC3\xA9 id=\"1\"/></osm>");
+    // malformed input stops both backends, how many entities come first
+    // depends on where the blocks are cut
+    ExpectBothStop("<osm><node id=\"1\"></way></osm>");
+    ExpectBothStop("<osm><node id=\"1\" id2=1/></osm>");
+    ExpectBothStop("<osm><node id=\"1\"/>");
+    ExpectBothStop("<osm><tag v=\"&unknown;\"/></osm>");
+    ExpectBothStop("<osm><tag v=\"bad \xC3\"/></osm>");
+    ExpectBothStop("<osm></osm><osm></osm>");
+    ExpectBothStop("<osm>a]]>b</osm>");
+    ExpectBothStop("");
+}
+
+TEST(OSMXMLTokenizer, DavisTest){
+    auto Map = std::make_shared<CMmapDataSource>("data/davis.osm");
+    ASSERT_TRUE(Map->IsOpen());
+    std::string Text(Map->Data(), Map->Size());
+    auto Expected = ReadEntities(Map, CXMLReader::EBackend::Expat);
+
+    EXPECT_GT(Expected.size(), 10000);
+    EXPECT_EQ(Expected.back(), "end");
+    EXPECT_EQ(ReadEntities(std::make_shared<CMmapDataSource>("data/davis.osm"), CXMLReader::EBackend::OSM), Expected);
+    EXPECT_EQ(ReadEntities(std::make_shared<CStringDataSource>(Text), CXMLReader::EBackend::OSM, 1000), Expected);
+}
@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+#include "PBFReader.h"
+#include "OpenStreetMap.h"
+#include "StringDataSource.h"
+#include "MmapDataSource.h"
+#include "StreetMapTest.h"
+#include <zlib.h>
+
+namespace{
+
+// minimal protobuf writer for building test files
+std::string Varint(uint64_t value){
+    std::string Result;
+    while(value >= 0x80){
+        Result += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    Result += static_cast<char>(value);
+    return Result;
+}
+
+std::string ZigZag(int64_t value){
+    return Varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+std::string VarintField(uint32_t field, uint64_t value){
+    return Varint(field << 3) + Varint(value);
+}
+
+std::string BytesField(uint32_t field, const std::string &bytes){
+    return Varint((field << 3) | 2) + Varint(bytes.size()) + bytes;
+}
+
+// frames a block as a blob, compressed with zlib or stored raw
+std::string Frame(const std::string &type, const std::string &block, bool compress){
+    std::string Blob;
+    if(compress){
+        std::string Compressed(compressBound(block.size()), '\0');
+        uLongf Length = Compressed.size();
+        compress2(reinterpret_cast<Bytef *>(&Compressed[0]), &Length, reinterpret_cast<const Bytef *>(block.data()), block.size(), 9);
+        Compressed.resize(Length);
+        Blob = VarintField(2, block.size()) + BytesField(3, Compressed);
+    }
+    else{
+        Blob = BytesField(1, block);
+    }
+    std::string Header = BytesField(1, type) + VarintField(3, Blob.size());
+    std::string Prefix(4, '\0');
+    for(int Index = 0; Index < 4; Index++){
+        Prefix[Index] = static_cast<char>(Header.size() >> (24 - Index * 8));
+    }
+    return Prefix + Header + Blob;
+}
+
+std::string HeaderFrame(const std::string &feature = "DenseNodes"){
+    return Frame("OSMHeader", BytesField(4, "OsmSchema-V0.6") + BytesField(4, feature), false);
+}
+
+std::vector<CPBFReader::SBlock> ReadAllBlocks(CPBFReader &reader){
+    std::vector<CPBFReader::SBlock> Blocks;
+    CPBFReader::SBlock Block;
+    while(reader.ReadBlock(Block)){
+        Blocks.push_back(Block);
+    }
+    return Blocks;
+}
+
+}
+
+TEST(PBFReader, BlockTest){
+    // strings: "", "name", "Main", "highway", "stop"
+    std::string Strings = BytesField(1, BytesField(1, "") + BytesField(1, "name") + BytesField(1, "Main") + BytesField(1, "highway") + BytesField(1, "stop"));
+    // signed fields are varints holding the zigzag encoded value
+    std::string Node = BytesField(1, Varint(1 << 3) + ZigZag(-5) + BytesField(2, Varint(3)) + BytesField(3, Varint(4)) + Varint(8 << 3) + ZigZag(25) + Varint(9 << 3) + ZigZag(-40));
+    // dense metadata with versions and delta coded timestamps only
+    std::string DenseInfo = BytesField(5, BytesField(1, Varint(1) + Varint(2) + Varint(1)) + BytesField(2, ZigZag(1) + ZigZag(1) + ZigZag(-2)));
+    std::string Dense = BytesField(2, BytesField(1, ZigZag(7) + ZigZag(1) + ZigZag(-3)) + DenseInfo + BytesField(8, ZigZag(10) + ZigZag(1) + ZigZag(-2)) + BytesField(9, ZigZag(0) + ZigZag(0) + ZigZag(5)) + BytesField(10, Varint(1) + Varint(2) + Varint(0) + Varint(0) + Varint(3) + Varint(4) + Varint(1) + Varint(2) + Varint(0)));
+    std::string Way = BytesField(3, VarintField(1, 9) + BytesField(2, Varint(1)) + BytesField(3, Varint(2)) + BytesField(8, ZigZag(7) + ZigZag(-2) + ZigZag(3)));
+    std::string Block = Strings + BytesField(2, Node + Dense) + BytesField(2, Way) + VarintField(17, 10000000) + VarintField(18, 2000) + VarintField(19, 1000000000) + VarintField(20, 2000000000);
+    std::string File = HeaderFrame() + Frame("OSMData", Block, true) + Frame("Unknown", "ignored", false) + Frame("OSMData", Strings, false);
+
+    CPBFReader Reader(std::make_shared<CStringDataSource>(File), 2);
+    auto Blocks = ReadAllBlocks(Reader);
+    EXPECT_TRUE(Reader.End());
+    ASSERT_EQ(Blocks.size(), 2);
+    const auto &First = Blocks[0];
+    // metadata keys and values are added after the file's strings
+    EXPECT_EQ(First.DStrings, std::vector<std::string>({"", "name", "Main", "highway", "stop", "version", "1", "timestamp", "1970-01-01T00:00:02Z", "2", "1970-01-01T00:00:04Z", "1970-01-01T00:00:00Z"}));
+    EXPECT_EQ(First.DNodeIDs, std::vector<uint64_t>({static_cast<uint64_t>(-5), 7, 8, 5}));
+    // offset plus granularity times the value in nanodegrees
+    EXPECT_EQ(First.DNodeLats, std::vector<double>({1.25, 1.1, 1.11, 1.09}));
+    EXPECT_EQ(First.DNodeLons, std::vector<double>({1.6, 2.0, 2.0, 2.05}));
+    EXPECT_EQ(First.DNodeTagStarts, std::vector<std::size_t>({0, 1, 4, 6, 10}));
+    EXPECT_EQ(First.DNodeTags, std::vector<CPBFReader::SBlock::TTag>({{3, 4}, {5, 6}, {7, 8}, {1, 2}, {5, 9}, {7, 10}, {5, 6}, {7, 11}, {3, 4}, {1, 2}}));
+    EXPECT_EQ(First.DWayIDs, std::vector<uint64_t>({9}));
+    EXPECT_EQ(First.DWayRefs, std::vector<uint64_t>({7, 5, 8}));
+    EXPECT_EQ(First.DWayRefStarts, std::vector<std::size_t>({0, 3}));
+    EXPECT_EQ(First.DWayTags, std::vector<CPBFReader::SBlock::TTag>({{1, 2}}));
+    EXPECT_TRUE(Blocks[1].DNodeIDs.empty());
+    EXPECT_TRUE(Blocks[1].DWayIDs.empty());
+}
+
+TEST(PBFReader, MalformedTest){
+    std::string Block = BytesField(1, BytesField(1, "") + BytesField(1, "k")) + BytesField(2, BytesField(3, VarintField(1, 1) + BytesField(2, Varint(1)) + BytesField(3, Varint(1))));
+    std::string Good = HeaderFrame() + Frame("OSMData", Block, true);
+    {
+        CPBFReader Reader(std::make_shared<CStringDataSource>(Good), 1);
+        EXPECT_EQ(ReadAllBlocks(Reader).size(), 1);
+        EXPECT_TRUE(Reader.End());
+    }
+    // a feature the reader does not support
+    CPBFReader Historical(std::make_shared<CStringDataSource>(HeaderFrame("HistoricalInformation") + Frame("OSMData", Block, true)), 1);
+    EXPECT_TRUE(ReadAllBlocks(Historical).empty());
+    EXPECT_FALSE(Historical.End());
+    // blocks read before a truncated blob are still handed out
+    std::string Truncated = Good + Frame("OSMData", Block, true);
+    Truncated.resize(Truncated.size() - 3);
+    CPBFReader Partial(std::make_shared<CStringDataSource>(Truncated), 1);
+    EXPECT_EQ(ReadAllBlocks(Partial).size(), 1);
+    EXPECT_FALSE(Partial.End());
+    // a string index past the string table
+    std::string BadIndex = BytesField(1, BytesField(1, "")) + BytesField(2, BytesField(3, VarintField(1, 1) + BytesField(2, Varint(1)) + BytesField(3, Varint(1))));
+    CPBFReader Index(std::make_shared<CStringDataSource>(HeaderFrame() + Frame("OSMData", BadIndex, false)), 1);
+    EXPECT_TRUE(ReadAllBlocks(Index).empty());
+    EXPECT_FALSE(Index.End());
+    // a user past the string table and dense metadata missing a node
+    std::string BadUser = BytesField(1, BytesField(1, "")) + BytesField(2, BytesField(3, VarintField(1, 1) + BytesField(4, VarintField(5, 3))));
+    std::string ShortInfo = BytesField(1, BytesField(1, "")) + BytesField(2, BytesField(2, BytesField(1, ZigZag(1) + ZigZag(1)) + BytesField(5, BytesField(1, Varint(1))) + BytesField(8, ZigZag(0) + ZigZag(0)) + BytesField(9, ZigZag(0) + ZigZag(0))));
+    for(const auto &Data : {BadUser, ShortInfo}){
+        CPBFReader Metadata(std::make_shared<CStringDataSource>(HeaderFrame() + Frame("OSMData", Data, false)), 1);
+        EXPECT_TRUE(ReadAllBlocks(Metadata).empty());
+        EXPECT_FALSE(Metadata.End());
+    }
+    // corrupt compressed data
+    std::string Corrupt = HeaderFrame() + Frame("OSMData", Block, true);
+    Corrupt[Corrupt.size() - 5] ^= 0x55;
+    CPBFReader Inflate(std::make_shared<CStringDataSource>(Corrupt), 1);
+    EXPECT_TRUE(ReadAllBlocks(Inflate).empty());
+    EXPECT_FALSE(Inflate.End());
+}
+
+TEST(PBFReader, DavisTest){
+    // data/davis.osm.pbf holds the nodes and ways of data/davis.osm, a few
+    // plain nodes ahead of dense ones, zlib and raw blobs, data/metadata.osm
+    // adds author metadata which the PBF file holds as Info and DenseInfo
+    for(auto FileName : {"data/davis.osm", "data/metadata.osm"})
+    for(std::size_t Threads : {1, 4}){
+        COpenStreetMap Expected(std::make_shared<CXMLReader>(std::make_shared<CMmapDataSource>(FileName)));
+        COpenStreetMap Map(std::make_shared<CPBFReader>(std::make_shared<CMmapDataSource>(std::string(FileName) + ".pbf"), Threads));
+        ExpectSameStreetMap(Map, Expected);
+    }
+}
+
+TEST(PBFReader, MetadataTest){
+    COpenStreetMap Map(std::make_shared<CPBFReader>(std::make_shared<CMmapDataSource>("data/metadata.osm.pbf")));
+
+    ASSERT_EQ(Map.NodeCount(), 12);
+    ASSERT_EQ(Map.WayCount(), 3);
+    auto Node = Map.NodeByID(62224290);
+    ASSERT_TRUE(Node);
+    EXPECT_EQ(Node->AttributeCount(), 5);
+    EXPECT_EQ(Node->GetAttributeKey(0), "changeset");
+    EXPECT_EQ(Node->GetAttribute("version"), "1");
+    EXPECT_EQ(Node->GetAttribute("timestamp"), "2015-03-04T22:51:04Z");
+    EXPECT_EQ(Node->GetAttribute("uid"), "232");
+    EXPECT_EQ(Node->GetAttribute("user"), "J & K Survey");
+    EXPECT_EQ(Node->GetAttribute("changeset"), "29411148");
+    // plain nodes and ways without Info have no metadata
+    EXPECT_EQ(Map.NodeByID(62209104)->AttributeCount(), 0);
+    EXPECT_EQ(Map.NodeByID(62208369)->GetAttribute("highway"), "traffic_signals");
+    EXPECT_EQ(Map.NodeByID(62208369)->GetAttribute("changeset"), "29411000");
+    EXPECT_FALSE(Map.WayByIndex(2)->HasAttribute("version"));
+    EXPECT_EQ(Map.WayByIndex(0)->GetAttribute("user"), "bdiscoe");
+}
@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include "ParallelDSVReader.h"
+#include "DSVReader.h"
+#include "StringDataSource.h"
+#include <atomic>
+#include <mutex>
+
+// reads every row with the sequential reader for comparison
+static std::vector< std::vector<std::string> > SequentialRows(const std::string &data){
+    CDSVReader Reader(std::make_shared<CStringDataSource>(data), ',');
+    std::vector< std::vector<std::string> > Rows;
+    std::vector<std::string> Row;
+    while(Reader.ReadRow(Row)){
+        Rows.push_back(Row);
+    }
+    return Rows;
+}
+
+static std::vector<std::string> ToStrings(const CParallelDSVReader::TRow &row){
+    return std::vector<std::string>(row.begin(), row.end());
+}
+
+TEST(ParallelDSVReader, OrderedTest){
+    std::string Data;
+    for(int Index = 0; Index < 300; Index++){
+        Data += std::to_string(Index) + ",\"quoted, " + std::to_string(Index) + "\nline\",\"say \"\"" + std::to_string(Index % 7) + "\"\"\"";
+        Data += Index % 3 ? "\r\n" : "\n";
+    }
+    Data += "last,row";
+    auto Expected = SequentialRows(Data);
+    for(std::size_t ChunkSize : {1, 7, 64, 1000, 1 << 20}){
+        for(std::size_t Threads : {1, 3}){
+            CParallelDSVReader Reader(Data, ',', Threads, ChunkSize);
+            std::vector< std::vector<std::string> > Rows;
+            EXPECT_TRUE(Reader.ParseOrdered([&](const CParallelDSVReader::TRow &row){
+                Rows.push_back(ToStrings(row));
+            }));
+            EXPECT_EQ(Rows,Expected);
+        }
+    }
+}
+
+TEST(ParallelDSVReader, ChunkCallbackTest){
+    std::string Data = "a,b\n\"c\nd\",e\n\nf\r\ng,\"h,i\"";
+    auto Expected = SequentialRows(Data);
+    CParallelDSVReader Reader(Data, ',', 4, 3);
+    std::vector< std::vector< std::vector<std::string> > > ChunkRows(Reader.ChunkCount());
+    std::mutex Mutex;
+
+    EXPECT_TRUE(Reader.ParseChunks([&](std::size_t chunk, const CParallelDSVReader::TRow &row){
+        std::lock_guard<std::mutex> Lock(Mutex);
+        ChunkRows[chunk].push_back(ToStrings(row));
+    }));
+    std::vector< std::vector<std::string> > Rows;
+    for(auto &Chunk : ChunkRows){
+        Rows.insert(Rows.end(), Chunk.begin(), Chunk.end());
+    }
+    EXPECT_EQ(Rows,Expected);
+}
+
+TEST(ParallelDSVReader, MappedFileTest){
+    CParallelDSVReader MissingReader(std::make_shared<CMmapDataSource>("/nonexistent/file.csv"), ',');
+    CParallelDSVReader Reader(std::make_shared<CMmapDataSource>("data/routes.csv"), ',', 2, 512);
+    std::size_t Rows = 0;
+
+    EXPECT_FALSE(MissingReader.ParseOrdered([](const CParallelDSVReader::TRow &){}));
+    EXPECT_GT(Reader.ChunkCount(),1);
+    EXPECT_TRUE(Reader.ParseOrdered([&](const CParallelDSVReader::TRow &row){
+        EXPECT_EQ(row.size(),2);
+        if(!Rows){
+            EXPECT_EQ(row[0],"route");
+        }
+        Rows++;
+    }));
+    CMmapDataSource Source("data/routes.csv");
+    EXPECT_EQ(Rows,SequentialRows(std::string(Source.Data(), Source.Size())).size());
+}
+
+TEST(ParallelDSVReader, CallbackThrowTest){
+    std::string Data;
+    for(int Index = 0; Index < 200; Index++){
+        Data += std::to_string(Index) + ",\"" + std::to_string(Index) + "\"\"\"\n";
+    }
+    auto Expected = SequentialRows(Data);
+    // the workers are stopped and joined while the exception unwinds
+    CParallelDSVReader Reader(Data, ',', 3, 16);
+    std::size_t Rows = 0;
+    EXPECT_THROW(Reader.ParseOrdered([&](const CParallelDSVReader::TRow &row){
+        if(++Rows == 50){
+            throw std::runtime_error("stop");
+        }
+    }), std::runtime_error);
+    std::vector< std::vector<std::string> > Parsed;
+    EXPECT_TRUE(Reader.ParseOrdered([&](const CParallelDSVReader::TRow &row){
+        Parsed.push_back(ToStrings(row));
+    }));
+    EXPECT_EQ(Parsed,Expected);
+}
+
+TEST(ParallelDSVReader, ChunkCallbackThrowTest){
+    std::string Data;
+    for(int Index = 0; Index < 200; Index++){
+        Data += std::to_string(Index) + ",x\n";
+    }
+    // a throw on a pool thread reaches the caller after every worker joins
+    CParallelDSVReader Reader(Data, ',', 4, 16);
+    ASSERT_GT(Reader.ChunkCount(), 4u);
+    std::atomic<std::size_t> Rows(0);
+    EXPECT_THROW(Reader.ParseChunks([&](std::size_t chunk, const CParallelDSVReader::TRow &row){
+        if(chunk % 2){
+            throw std::runtime_error("stop");
+        }
+        Rows++;
+    }), std::runtime_error);
+    Rows = 0;
+    EXPECT_TRUE(Reader.ParseChunks([&](std::size_t chunk, const CParallelDSVReader::TRow &row){
+        Rows++;
+    }));
+    EXPECT_EQ(Rows,200u);
+}
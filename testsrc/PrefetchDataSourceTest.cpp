@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include "PrefetchDataSource.h"
+#include "StringDataSource.h"
+#include "DSVReader.h"
+#include "XMLReader.h"
+
+// a string source that claims to stall so readers wrap it in a prefetcher
+class CSlowStringDataSource : public CStringDataSource{
+    public:
+        CSlowStringDataSource(const std::string &str) : CStringDataSource(str){};
+
+        bool Blocking() const noexcept override{
+            return true;
+        };
+};
+
+TEST(PrefetchDataSource, EmptyTest){
+    CPrefetchDataSource Source(std::make_shared<CStringDataSource>(""), 4, 2);
+    char TempCh = 'x';
+    const char *Data = nullptr;
+
+    EXPECT_TRUE(Source.End());
+    EXPECT_FALSE(Source.Get(TempCh));
+    EXPECT_FALSE(Source.Peek(TempCh));
+    EXPECT_EQ(TempCh,'x');
+    EXPECT_EQ(Source.Borrow(Data,4),0);
+}
+
+TEST(PrefetchDataSource, GetPeekReadTest){
+    CPrefetchDataSource Source(std::make_shared<CStringDataSource>("Hello World"), 3, 2);
+    std::vector< char > TempVector;
+    char Buffer[8];
+    const char *Data = nullptr;
+    char TempCh = 'x';
+
+    EXPECT_FALSE(Source.End());
+    EXPECT_TRUE(Source.Peek(TempCh));
+    EXPECT_EQ(TempCh,'H');
+    EXPECT_TRUE(Source.Get(TempCh));
+    EXPECT_EQ(TempCh,'H');
+    EXPECT_EQ(Source.Borrow(Data,8),2);
+    EXPECT_EQ(std::string(Data,2),"el");
+    EXPECT_EQ(Source.ReadBlock(Buffer,5),5);
+    EXPECT_EQ(std::string(Buffer,5),"lo Wo");
+    EXPECT_TRUE(Source.Read(TempVector,8));
+    EXPECT_EQ(std::string(TempVector.begin(),TempVector.end()),"rld");
+    EXPECT_TRUE(Source.End());
+}
+
+TEST(PrefetchDataSource, EarlyDestructionTest){
+    std::string Input(100000,'a');
+    CPrefetchDataSource Source(std::make_shared<CStringDataSource>(Input), 16, 2);
+    char TempCh = 'x';
+
+    EXPECT_TRUE(Source.Get(TempCh));
+    EXPECT_EQ(TempCh,'a');
+}
+
+TEST(PrefetchDataSource, ReaderWrapTest){
+    std::vector<std::string> Row;
+    CDSVReader DSVReader(std::make_shared<CSlowStringDataSource>("a,b\n\"c\nd\",e\n"), ',');
+    SXMLEntity Entity;
+    CXMLReader XMLReader(std::make_shared<CSlowStringDataSource>("<osm><node id=\"1\"/></osm>"));
+
+    EXPECT_TRUE(DSVReader.ReadRow(Row));
+    EXPECT_EQ(Row,std::vector<std::string>({"a","b"}));
+    EXPECT_TRUE(DSVReader.ReadRow(Row));
+    EXPECT_EQ(Row,std::vector<std::string>({"c\nd","e"}));
+    EXPECT_TRUE(DSVReader.End());
+    EXPECT_TRUE(XMLReader.ReadEntity(Entity));
+    EXPECT_EQ(Entity.DNameData,"osm");
+    EXPECT_TRUE(XMLReader.ReadEntity(Entity));
+    EXPECT_EQ(Entity.AttributeValue("id"),"1");
+}
@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+#include "SnapshotStreetMap.h"
+#include "OpenStreetMap.h"
+#include "StringDataSource.h"
+#include "StringDataSink.h"
+#include "StreetMapTest.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace{
+
+// writes the contents to a fresh temporary file and returns its name
+std::string CreateTempFile(const std::string &contents){
+    char FileName[] = "/tmp/snapshotXXXXXX";
+    int FileDescriptor = mkstemp(FileName);
+    if(FileDescriptor >= 0){
+        if(!contents.empty() && write(FileDescriptor, contents.data(), contents.size()) < 0){
+            FileName[0] = '\0';
+        }
+        close(FileDescriptor);
+    }
+    return FileName;
+}
+
+std::string SnapshotOf(const CStreetMap &map){
+    auto Sink = std::make_shared<CStringDataSink>();
+    EXPECT_TRUE(CSnapshotStreetMap::Write(map, Sink));
+    return Sink->String();
+}
+
+// recomputes the checksum of edited contents, it sits 96 bytes into the header
+void Rechecksum(std::string &contents){
+    const std::size_t ChecksumOffset = 96;
+    std::memset(&contents[ChecksumOffset], 0, sizeof(uint32_t));
+    uint32_t Checksum = static_cast<uint32_t>(crc32(0L, reinterpret_cast<const Bytef *>(contents.data()), contents.size()));
+    std::memcpy(&contents[ChecksumOffset], &Checksum, sizeof(uint32_t));
+}
+
+// opens the contents as a snapshot through a temporary file
+std::shared_ptr<CSnapshotStreetMap> OpenSnapshot(const std::string &contents, bool verify = true){
+    std::string FileName = CreateTempFile(contents);
+    auto Source = std::make_shared<CMmapDataSource>(FileName, CMmapDataSource::EAccess::Random);
+    std::remove(FileName.c_str());
+    return std::make_shared<CSnapshotStreetMap>(Source, verify);
+}
+
+}
+
+TEST(SnapshotStreetMap, SimpleTest){
+    COpenStreetMap Map(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>(
+        "<osm>\n"
+        "  <node id=\"1\" lat=\"38.5\" lon=\"-121.7\"/>\n"
+        "  <node id=\"2\" lat=\"38.6\" lon=\"-121.8\">\n"
+        "    <tag k=\"highway\" v=\"traffic_signals\"/>\n"
+        "  </node>\n"
+        "  <way id=\"10\">\n"
+        "    <nd ref=\"1\"/>\n"
+        "    <nd ref=\"2\"/>\n"
+        "    <tag k=\"name\" v=\"Main &amp; 1st\"/>\n"
+        "    <tag k=\"highway\" v=\"residential\"/>\n"
+        "  </way>\n"
+        "  <way id=\"11\"/>\n"
+        "</osm>\n")));
+    std::shared_ptr<CStreetMap::SNode> Node;
+    std::shared_ptr<CStreetMap::SWay> Way;
+    {
+        auto Snapshot = OpenSnapshot(SnapshotOf(Map));
+        ASSERT_TRUE(Snapshot->IsValid());
+        ExpectSameStreetMap(Map, *Snapshot);
+        Node = Snapshot->NodeByID(2);
+        Way = Snapshot->WayByID(10);
+        EXPECT_EQ(Snapshot->NodeByID(3), nullptr);
+        EXPECT_EQ(Snapshot->WayByID(12), nullptr);
+        EXPECT_EQ(Snapshot->NodeByIndex(2), nullptr);
+        EXPECT_EQ(Snapshot->WayByIndex(2), nullptr);
+        EXPECT_EQ(Snapshot->WayByID(11)->AttributeCount(), 0);
+    }
+    // handles keep the mapping alive after the map is gone
+    ASSERT_TRUE(Node);
+    EXPECT_EQ(Node->GetAttribute("highway"), "traffic_signals");
+    EXPECT_FALSE(Node->HasAttribute("name"));
+    ASSERT_TRUE(Way);
+    EXPECT_EQ(Way->GetAttribute("name"), "Main & 1st");
+    EXPECT_EQ(Way->GetAttribute("surface"), "");
+    EXPECT_EQ(Way->GetNodeID(1), 2);
+}
+
+TEST(SnapshotStreetMap, DavisTest){
+    COpenStreetMap Map(std::make_shared<CXMLReader>(std::make_shared<CMmapDataSource>("data/davis.osm")));
+    std::string Contents = SnapshotOf(Map);
+    auto Snapshot = OpenSnapshot(Contents);
+
+    ASSERT_TRUE(Snapshot->IsValid());
+    ExpectSameStreetMap(Map, *Snapshot);
+    // a snapshot of a snapshot is the same file
+    EXPECT_EQ(SnapshotOf(*Snapshot), Contents);
+    auto Unverified = OpenSnapshot(Contents, false);
+    ASSERT_TRUE(Unverified->IsValid());
+    ExpectSameStreetMap(Map, *Unverified);
+}
+
+TEST(SnapshotStreetMap, InvalidTest){
+    COpenStreetMap Map(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>("<osm><node id=\"1\" lat=\"1\" lon=\"2\"><tag k=\"a\" v=\"b\"/></node></osm>")));
+    std::string Contents = SnapshotOf(Map);
+    ASSERT_TRUE(OpenSnapshot(Contents)->IsValid());
+
+    auto Missing = std::make_shared<CSnapshotStreetMap>(std::make_shared<CMmapDataSource>("/nonexistent/map.snap"));
+    EXPECT_FALSE(Missing->IsValid());
+    EXPECT_EQ(Missing->NodeCount(), 0);
+    EXPECT_EQ(Missing->NodeByID(1), nullptr);
+    EXPECT_FALSE(OpenSnapshot("")->IsValid());
+    // sizes are checked even when the file is trusted
+    EXPECT_FALSE(OpenSnapshot(Contents.substr(0, Contents.size() - 8), false)->IsValid());
+    EXPECT_FALSE(OpenSnapshot(Contents + std::string(8, '\0'), false)->IsValid());
+    std::string BadMagic = Contents;
+    BadMagic[0] = 'X';
+    EXPECT_FALSE(OpenSnapshot(BadMagic, false)->IsValid());
+    std::string BadVersion = Contents;
+    BadVersion[8]++;
+    EXPECT_FALSE(OpenSnapshot(BadVersion, false)->IsValid());
+    // a flipped bit anywhere is caught by the checksum
+    std::string Corrupt = Contents;
+    Corrupt[Corrupt.size() - 1] ^= 1;
+    EXPECT_FALSE(OpenSnapshot(Corrupt)->IsValid());
+    EXPECT_TRUE(OpenSnapshot(Corrupt, false)->IsValid());
+}
+
+TEST(SnapshotStreetMap, OrderTest){
+    COpenStreetMap Map(std::make_shared<CXMLReader>(std::make_shared<CStringDataSource>("<osm><node id=\"1\" lat=\"1\" lon=\"1\"/><node id=\"2\" lat=\"2\" lon=\"2\"/><node id=\"3\" lat=\"3\" lon=\"3\"/></osm>")));
+    std::string Contents = SnapshotOf(Map);
+    std::string Edited = Contents;
+    Rechecksum(Edited);
+    ASSERT_EQ(Edited, Contents);
+    // a 104 byte header, three ids, lats and lons, one attribute start, then
+    // the index keys with slot 0 unused, slots 2 and 3 hold ids 1 and 3
+    const std::size_t KeysOffset = 104 + 3 * 3 * 8 + 8;
+    uint64_t Left, Right;
+    std::memcpy(&Left, &Edited[KeysOffset + 16], sizeof(uint64_t));
+    std::memcpy(&Right, &Edited[KeysOffset + 24], sizeof(uint64_t));
+    ASSERT_EQ(Left, 1u);
+    ASSERT_EQ(Right, 3u);
+    std::memcpy(&Edited[KeysOffset + 16], &Right, sizeof(uint64_t));
+    std::memcpy(&Edited[KeysOffset + 24], &Left, sizeof(uint64_t));
+    Rechecksum(Edited);
+    // the checksum matches but the keys are out of order
+    EXPECT_FALSE(OpenSnapshot(Edited)->IsValid());
+    EXPECT_TRUE(OpenSnapshot(Contents)->IsValid());
+}
@@ -0,0 +1,49 @@
+#ifndef STREETMAPTEST_H
+#define STREETMAPTEST_H
+
+#include <gtest/gtest.h>
+#include "StreetMap.h"
+
+// expects two street maps to hold the same nodes and ways in the same order,
+// with the same attribute keys in the same order and the same values, and
+// every id found through the id lookups
+inline void ExpectSameStreetMap(const CStreetMap &map, const CStreetMap &other){
+    ASSERT_EQ(map.NodeCount(), other.NodeCount());
+    ASSERT_EQ(map.WayCount(), other.WayCount());
+    for(std::size_t Index = 0; Index < map.NodeCount(); Index++){
+        auto Node = map.NodeByIndex(Index), Other = other.NodeByIndex(Index);
+        EXPECT_EQ(Node->ID(), Other->ID());
+        EXPECT_EQ(Node->Location(), Other->Location());
+        ASSERT_EQ(Node->AttributeCount(), Other->AttributeCount());
+        for(std::size_t Attribute = 0; Attribute < Node->AttributeCount(); Attribute++){
+            auto Key = Node->GetAttributeKey(Attribute);
+            EXPECT_EQ(Key, Other->GetAttributeKey(Attribute));
+            EXPECT_TRUE(Other->HasAttribute(Key));
+            EXPECT_EQ(Node->GetAttribute(Key), Other->GetAttribute(Key));
+        }
+        auto Found = other.NodeByID(Node->ID());
+        ASSERT_TRUE(Found);
+        EXPECT_EQ(Found->Location(), map.NodeByID(Node->ID())->Location());
+    }
+    for(std::size_t Index = 0; Index < map.WayCount(); Index++){
+        auto Way = map.WayByIndex(Index), Other = other.WayByIndex(Index);
+        EXPECT_EQ(Way->ID(), Other->ID());
+        ASSERT_EQ(Way->NodeCount(), Other->NodeCount());
+        // one past the end checks both give the invalid id
+        for(std::size_t Node = 0; Node <= Way->NodeCount(); Node++){
+            EXPECT_EQ(Way->GetNodeID(Node), Other->GetNodeID(Node));
+        }
+        ASSERT_EQ(Way->AttributeCount(), Other->AttributeCount());
+        for(std::size_t Attribute = 0; Attribute < Way->AttributeCount(); Attribute++){
+            auto Key = Way->GetAttributeKey(Attribute);
+            EXPECT_EQ(Key, Other->GetAttributeKey(Attribute));
+            EXPECT_TRUE(Other->HasAttribute(Key));
+            EXPECT_EQ(Way->GetAttribute(Key), Other->GetAttribute(Key));
+        }
+        auto Found = other.WayByID(Way->ID());
+        ASSERT_TRUE(Found);
+        EXPECT_EQ(Found->NodeCount(), map.WayByID(Way->ID())->NodeCount());
+    }
+}
+
+#endif
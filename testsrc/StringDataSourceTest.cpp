@@ -81,3 +81,35 @@ TEST(StringDataSource, ReadTest){
     EXPECT_FALSE(Source2.Peek(TempCh));
     EXPECT_EQ(TempCh,'x');
 }
+
+TEST(StringDataSource, ReadBlockTest){
+    CStringDataSource EmptySource("");
+    CStringDataSource Source("Hello");
+    char Buffer[8];
+    char TempCh = 'x';
+
+    EXPECT_EQ(EmptySource.ReadBlock(Buffer,8),0);
+    EXPECT_EQ(Source.ReadBlock(Buffer,2),2);
+    EXPECT_EQ(std::string(Buffer,2),"He");
+    EXPECT_TRUE(Source.Peek(TempCh));
+    EXPECT_EQ(TempCh,'l');
+    EXPECT_EQ(Source.ReadBlock(Buffer,8),3);
+    EXPECT_EQ(std::string(Buffer,3),"llo");
+    EXPECT_TRUE(Source.End());
+    EXPECT_EQ(Source.ReadBlock(Buffer,8),0);
+}
+
+TEST(StringDataSource, BorrowTest){
+    CStringDataSource EmptySource("");
+    CStringDataSource Source("Hello");
+    const char *Data = nullptr;
+    char TempCh = 'x';
+
+    EXPECT_EQ(EmptySource.Borrow(Data,8),0);
+    EXPECT_EQ(Source.Borrow(Data,4),4);
+    EXPECT_EQ(std::string(Data,4),"Hell");
+    EXPECT_TRUE(Source.Get(TempCh));
+    EXPECT_EQ(TempCh,'o');
+    EXPECT_EQ(Source.Borrow(Data,4),0);
+    EXPECT_TRUE(Source.End());
+}
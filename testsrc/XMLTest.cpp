@@ -3,6 +3,7 @@
 #include "XMLWriter.h"
 #include "StringDataSource.h"
 #include "StringDataSink.h"
+#include "MmapDataSource.h"
 
 TEST(XMLTest, BasicReadWrite) {
     // create a data source from a string containing XML data
@@ -29,6 +30,356 @@ TEST(XMLTest, BasicReadWrite) {
         }
     }
 
+    writer.Flush();
+
     // After all entities are processed, check if the output matches the original input
     EXPECT_EQ(sink->String(), "<tag>data</tag>");
 }
+
+// a string source that cannot lend its storage, so the reader reads into
+// the parser's own buffer
+class CCopyingStringDataSource : public CStringDataSource {
+public:
+    CCopyingStringDataSource(const std::string &str) : CStringDataSource(str) {}
+
+    std::size_t Borrow(const char *&data, std::size_t count) noexcept override {
+        return 0;
+    }
+};
+
+static std::vector<SXMLEntity> ReadAllEntities(CXMLReader &reader) {
+    std::vector<SXMLEntity> entities;
+    SXMLEntity entity;
+    while (reader.ReadEntity(entity)) {
+        entities.push_back(entity);
+    }
+    return entities;
+}
+
+static bool SameEntities(const std::vector<SXMLEntity> &first, const std::vector<SXMLEntity> &second) {
+    if (first.size() != second.size()) {
+        return false;
+    }
+    for (std::size_t index = 0; index < first.size(); index++) {
+        if (first[index].DType != second[index].DType || first[index].DNameData != second[index].DNameData || first[index].DAttributes != second[index].DAttributes
+            || first[index].DNameID != second[index].DNameID || first[index].DAttributeIDs != second[index].DAttributeIDs) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST(XMLTest, BlockSizeTest) {
+    std::string xml = "<osm version=\"0.6\"><node id=\"1\" lat=\"38.5\">text &amp; more</node><way id=\"2\"/></osm>";
+    CXMLReader whole(std::make_shared<CStringDataSource>(xml));
+    std::vector<SXMLEntity> expected = ReadAllEntities(whole);
+    ASSERT_EQ(expected.size(), 7);
+    EXPECT_EQ(expected[2].DNameData, "text & more");
+
+    for (std::size_t blocksize : {1, 3, 7, 64}) {
+        CXMLReader borrowed(std::make_shared<CStringDataSource>(xml), blocksize);
+        CXMLReader copied(std::make_shared<CCopyingStringDataSource>(xml), blocksize);
+        EXPECT_TRUE(SameEntities(ReadAllEntities(borrowed), expected));
+        EXPECT_TRUE(SameEntities(ReadAllEntities(copied), expected));
+        EXPECT_TRUE(borrowed.End());
+        EXPECT_TRUE(copied.End());
+    }
+
+    // a whole map through both paths with the default block size
+    auto map = std::make_shared<CMmapDataSource>("data/davis.osm");
+    ASSERT_TRUE(map->IsOpen());
+    std::string text(map->Data(), map->Size());
+    CXMLReader mapped(map);
+    CXMLReader copied(std::make_shared<CCopyingStringDataSource>(text));
+    std::vector<SXMLEntity> entities = ReadAllEntities(mapped);
+    EXPECT_GT(entities.size(), 10000);
+    EXPECT_TRUE(SameEntities(entities, ReadAllEntities(copied)));
+}
+
+TEST(XMLTest, EntityReuseTest) {
+    // entities are recycled, nothing from an earlier entity may leak into a later one
+    std::string xml = "<a x=\"1\" y=\"2\" z=\"3\">text<b k=\"v\"/>more<c/></a>";
+    CXMLReader reader(std::make_shared<CStringDataSource>(xml), 4);
+    SXMLEntity entity;
+
+    ASSERT_TRUE(reader.ReadEntity(entity));
+    EXPECT_EQ(entity.DNameData, "a");
+    EXPECT_EQ(entity.DAttributes, std::vector<SXMLEntity::TAttribute>({{"x", "1"}, {"y", "2"}, {"z", "3"}}));
+    ASSERT_TRUE(reader.ReadEntity(entity));
+    EXPECT_EQ(entity.DType, SXMLEntity::EType::CharData);
+    EXPECT_EQ(entity.DNameData, "text");
+    EXPECT_TRUE(entity.DAttributes.empty());
+    ASSERT_TRUE(reader.ReadEntity(entity, true));
+    EXPECT_EQ(entity.DNameData, "b");
+    EXPECT_EQ(entity.DAttributes, std::vector<SXMLEntity::TAttribute>({{"k", "v"}}));
+    ASSERT_TRUE(reader.ReadEntity(entity, true));
+    EXPECT_EQ(entity.DType, SXMLEntity::EType::EndElement);
+    EXPECT_EQ(entity.DNameData, "b");
+    EXPECT_TRUE(entity.DAttributes.empty());
+    ASSERT_TRUE(reader.ReadEntity(entity, true));
+    EXPECT_EQ(entity.DType, SXMLEntity::EType::StartElement);
+    EXPECT_EQ(entity.DNameData, "c");
+    EXPECT_TRUE(entity.DAttributes.empty());
+    ASSERT_TRUE(reader.ReadEntity(entity, true));
+    ASSERT_TRUE(reader.ReadEntity(entity, true));
+    EXPECT_EQ(entity.DNameData, "a");
+    EXPECT_FALSE(reader.ReadEntity(entity, true));
+    EXPECT_TRUE(reader.End());
+}
+
+// records visitor events as entities so they can be compared with ReadEntity
+class CRecordingVisitor : public CXMLVisitor {
+public:
+    std::vector<SXMLEntity> entities;
+
+    void StartElement(std::string_view name, TSymbolID nameid, const std::vector<TAttribute> &attributes, const std::vector<TSymbolID> &attributeids) override {
+        SXMLEntity entity{SXMLEntity::EType::StartElement, std::string(name), {}};
+        entity.DNameID = nameid;
+        entity.DAttributeIDs = attributeids;
+        for (const auto &attribute : attributes) {
+            entity.DAttributes.emplace_back(attribute.first, attribute.second);
+        }
+        entities.push_back(entity);
+    }
+
+    void EndElement(std::string_view name, TSymbolID nameid) override {
+        entities.push_back({SXMLEntity::EType::EndElement, std::string(name), {}});
+        entities.back().DNameID = nameid;
+    }
+
+    void CharData(std::string_view data) override {
+        entities.push_back({SXMLEntity::EType::CharData, std::string(data), {}});
+    }
+};
+
+TEST(XMLTest, VisitTest) {
+    std::string xml = "<osm version=\"0.6\"><node id=\"1\" lat=\"38.5\">text &amp; more</node><way id=\"2\"/></osm>";
+    CXMLReader reader(std::make_shared<CStringDataSource>(xml));
+    std::vector<SXMLEntity> expected = ReadAllEntities(reader);
+
+    for (std::size_t blocksize : {1, 5, 4096}) {
+        CXMLReader visited(std::make_shared<CStringDataSource>(xml), blocksize);
+        CRecordingVisitor visitor;
+        EXPECT_TRUE(visited.Visit(visitor));
+        EXPECT_TRUE(SameEntities(visitor.entities, expected));
+        EXPECT_TRUE(visited.End());
+    }
+
+    // entities already read stay read, queued ones go to the visitor
+    CXMLReader mixed(std::make_shared<CStringDataSource>(xml), 1);
+    CRecordingVisitor visitor;
+    SXMLEntity entity;
+    ASSERT_TRUE(mixed.ReadEntity(entity));
+    ASSERT_TRUE(mixed.ReadEntity(entity));
+    EXPECT_TRUE(mixed.Visit(visitor, true));
+    EXPECT_TRUE(SameEntities(visitor.entities, {expected[3], expected[4], expected[5], expected[6]}));
+
+    CXMLReader broken(std::make_shared<CStringDataSource>("<a><b></a>"));
+    EXPECT_FALSE(broken.Visit(visitor));
+}
+
+TEST(XMLTest, SymbolTest) {
+    CXMLReader reader(std::make_shared<CStringDataSource>("<osm><node id=\"1\" lat=\"2\"/><way id=\"3\">x</way></osm>"));
+    SXMLEntity::TSymbolID node = reader.Symbol("node");
+    SXMLEntity::TSymbolID id = reader.Symbol("id");
+    SXMLEntity entity;
+
+    EXPECT_NE(node, SXMLEntity::TSymbolID(SXMLEntity::InvalidSymbolID));
+    EXPECT_EQ(reader.Symbol("node"), node);
+    EXPECT_EQ(reader.SymbolName(node), "node");
+    EXPECT_EQ(reader.SymbolName(1000), "");
+
+    ASSERT_TRUE(reader.ReadEntity(entity));
+    EXPECT_EQ(reader.SymbolName(entity.DNameID), "osm");
+    ASSERT_TRUE(reader.ReadEntity(entity));
+    EXPECT_EQ(entity.DNameID, node);
+    ASSERT_EQ(entity.DAttributeIDs.size(), 2);
+    EXPECT_EQ(entity.DAttributeIDs[0], id);
+    EXPECT_TRUE(entity.AttributeExists(id));
+    EXPECT_EQ(entity.AttributeValue(id), "1");
+    EXPECT_EQ(entity.AttributeValue(reader.Symbol("lat")), "2");
+    EXPECT_FALSE(entity.AttributeExists(reader.Symbol("lon")));
+    EXPECT_FALSE(entity.AttributeExists(SXMLEntity::InvalidSymbolID));
+    // attributes added by hand have no symbol
+    EXPECT_TRUE(entity.SetAttribute("lon", "4"));
+    EXPECT_EQ(entity.DAttributeIDs.size(), 3);
+    EXPECT_FALSE(entity.AttributeExists(reader.Symbol("lon")));
+    EXPECT_EQ(entity.AttributeValue("lon"), "4");
+    ASSERT_TRUE(reader.ReadEntity(entity));
+    EXPECT_EQ(entity.DType, SXMLEntity::EType::EndElement);
+    EXPECT_EQ(entity.DNameID, node);
+    ASSERT_TRUE(reader.ReadEntity(entity, true));
+    EXPECT_EQ(reader.SymbolName(entity.DNameID), "way");
+    ASSERT_TRUE(reader.ReadEntity(entity));
+    EXPECT_EQ(entity.DType, SXMLEntity::EType::CharData);
+    EXPECT_EQ(entity.DNameID, SXMLEntity::TSymbolID(SXMLEntity::InvalidSymbolID));
+    EXPECT_TRUE(entity.DAttributeIDs.empty());
+
+    // the table stops growing once it is full
+    CXMLReader full(std::make_shared<CStringDataSource>(""));
+    for (std::size_t index = 0; index < CXMLReader::MaxSymbols; index++) {
+        EXPECT_EQ(full.Symbol("n" + std::to_string(index)), index);
+    }
+    EXPECT_EQ(full.Symbol("extra"), SXMLEntity::TSymbolID(SXMLEntity::InvalidSymbolID));
+    EXPECT_EQ(full.Symbol("n7"), 7);
+
+    // a document cannot use up the ids kept for symbols and filters asked for later
+    std::string names = "<r>";
+    for (std::size_t index = 0; index < CXMLReader::MaxSymbols; index++) {
+        names += "<n" + std::to_string(index) + "/>";
+    }
+    // one byte blocks so the filter applies to everything after the names
+    CXMLReader filled(std::make_shared<CStringDataSource>(names + "<keep/><drop/><keep/></r>"), 1);
+    while (filled.ReadEntity(entity) && entity.DNameData != "n" + std::to_string(CXMLReader::MaxSymbols - 1)) {
+    }
+    EXPECT_EQ(entity.DNameID, SXMLEntity::TSymbolID(SXMLEntity::InvalidSymbolID));
+    EXPECT_NE(filled.Symbol("late"), SXMLEntity::TSymbolID(SXMLEntity::InvalidSymbolID));
+    CXMLReader::SFilter filter;
+    filter.DMode = CXMLReader::SFilter::EMode::Allow;
+    filter.DNames = {"keep"};
+    filter.DDepth = 1;
+    filled.SetFilter(filter);
+    std::vector<std::string> kept;
+    while (filled.ReadEntity(entity)) {
+        kept.push_back(entity.DNameData);
+    }
+    EXPECT_EQ(kept, std::vector<std::string>({"n" + std::to_string(CXMLReader::MaxSymbols - 1), "keep", "keep", "keep", "keep", "r"}));
+}
+
+TEST(XMLTest, FilterTest) {
+    std::string xml = "<osm>\n <bounds/>\n <node id=\"1\"><tag k=\"a\"/></node>\n <relation id=\"2\"><member ref=\"1\"><node id=\"3\"/></member> text</relation>\n <way id=\"4\"> <nd ref=\"1\"/> </way>\n</osm>";
+    CXMLReader::SFilter filter;
+    SXMLEntity entity;
+
+    // allow list at any depth, whitespace between elements dropped
+    CXMLReader allowed(std::make_shared<CStringDataSource>(xml), 7);
+    filter.DMode = CXMLReader::SFilter::EMode::Allow;
+    filter.DNames = {"osm", "node", "way", "nd", "tag"};
+    filter.DDropWhitespace = true;
+    allowed.SetFilter(filter);
+    std::vector<std::string> names;
+    while (allowed.ReadEntity(entity)) {
+        names.push_back((entity.DType == SXMLEntity::EType::EndElement ? "/" : "") + entity.DNameData);
+    }
+    EXPECT_EQ(names, std::vector<std::string>({"osm", "node", "tag", "/tag", "/node", "way", "nd", "/nd", "/way", "/osm"}));
+    EXPECT_TRUE(allowed.End());
+
+    // deny list at one depth only, the node inside the relation goes with it
+    CXMLReader denied(std::make_shared<CStringDataSource>(xml));
+    filter.DMode = CXMLReader::SFilter::EMode::Deny;
+    filter.DNames = {"relation", "bounds", "nd"};
+    filter.DDepth = 1;
+    filter.DDropWhitespace = false;
+    denied.SetFilter(filter);
+    names.clear();
+    while (denied.ReadEntity(entity, true)) {
+        names.push_back((entity.DType == SXMLEntity::EType::EndElement ? "/" : "") + entity.DNameData);
+    }
+    EXPECT_EQ(names, std::vector<std::string>({"osm", "node", "tag", "/tag", "/node", "way", "nd", "/nd", "/way", "/osm"}));
+
+    // the filter applies to visitors as well
+    CXMLReader visited(std::make_shared<CStringDataSource>(xml));
+    filter.DMode = CXMLReader::SFilter::EMode::Allow;
+    filter.DNames = {"relation"};
+    filter.DDropWhitespace = true;
+    visited.SetFilter(filter);
+    CRecordingVisitor visitor;
+    EXPECT_TRUE(visited.Visit(visitor));
+    names.clear();
+    for (const auto &recorded : visitor.entities) {
+        names.push_back((recorded.DType == SXMLEntity::EType::EndElement ? "/" : "") + recorded.DNameData);
+    }
+    EXPECT_EQ(names, std::vector<std::string>({"osm", "relation", "member", "node", "/node", "/member", " text", "/relation", "/osm"}));
+}
+
+TEST(XMLTest, WriterEscapingTest) {
+    std::shared_ptr<CStringDataSink> sink = std::make_shared<CStringDataSink>();
+    std::string longtext(40, 'x');
+    {
+        CXMLWriter writer(sink);
+        SXMLEntity entity;
+        entity.DType = SXMLEntity::EType::StartElement;
+        entity.DNameData = "osm";
+        entity.SetAttribute("a", "1 < 2 & \"3\" > 'o'");
+        EXPECT_TRUE(writer.WriteEntity(entity));
+        entity.DType = SXMLEntity::EType::CharData;
+        entity.DNameData = longtext + "<" + longtext + "&&" + longtext;
+        entity.DAttributes.clear();
+        EXPECT_TRUE(writer.WriteEntity(entity));
+        entity.DType = SXMLEntity::EType::CompleteElement;
+        entity.DNameData = "tag";
+        entity.SetAttribute("v", longtext);
+        EXPECT_TRUE(writer.WriteEntity(entity));
+        // nothing reaches the sink until a batch fills or the writer flushes
+        EXPECT_EQ(sink->String(), "");
+    }
+    // the destructor writes the buffer but leaves elements open
+    EXPECT_EQ(sink->String(), "<osm a=\"1 &lt; 2 &amp; &quot;3&quot; &gt; &apos;o&apos;\">" + longtext + "&lt;" + longtext + "&amp;&amp;" + longtext + "<tag v=\"" + longtext + "\"/>");
+}
+
+// a sink whose writes fail until it is told to accept them
+class CFailingDataSink : public CDataSink {
+public:
+    bool fail = true;
+    std::string data;
+
+    bool Put(const char &ch) noexcept override {
+        if (fail) return false;
+        data += ch;
+        return true;
+    }
+
+    bool Write(const std::vector<char> &buf) noexcept override {
+        if (fail) return false;
+        data.append(buf.begin(), buf.end());
+        return true;
+    }
+};
+
+TEST(XMLTest, WriterFailedWriteTest) {
+    // output stays buffered when the sink fails and goes out on the next flush
+    std::shared_ptr<CFailingDataSink> sink = std::make_shared<CFailingDataSink>();
+    CXMLWriter writer(sink);
+    SXMLEntity entity;
+    entity.DType = SXMLEntity::EType::StartElement;
+    entity.DNameData = "osm";
+    EXPECT_TRUE(writer.WriteEntity(entity));
+    EXPECT_FALSE(writer.Flush());
+    sink->fail = false;
+    EXPECT_TRUE(writer.Flush());
+    EXPECT_EQ(sink->data, "<osm></osm>");
+}
+
+TEST(XMLTest, WriterBatchTest) {
+    // enough elements to fill several batches, read back to check nothing is lost
+    std::shared_ptr<CStringDataSink> sink = std::make_shared<CStringDataSink>();
+    CXMLWriter writer(sink);
+    SXMLEntity entity;
+    entity.DType = SXMLEntity::EType::StartElement;
+    entity.DNameData = "osm";
+    EXPECT_TRUE(writer.WriteEntity(entity));
+    entity.DType = SXMLEntity::EType::CompleteElement;
+    entity.DNameData = "node";
+    for (int i = 0; i < 20000; i++) {
+        entity.SetAttribute("id", std::to_string(i));
+        entity.SetAttribute("v", "a & \"" + std::to_string(i * 7) + "\"");
+        EXPECT_TRUE(writer.WriteEntity(entity));
+    }
+    EXPECT_FALSE(sink->String().empty());
+    EXPECT_TRUE(writer.Flush());
+
+    CXMLReader reader(std::make_shared<CStringDataSource>(sink->String()));
+    ASSERT_TRUE(reader.ReadEntity(entity));
+    EXPECT_EQ(entity.DNameData, "osm");
+    for (int i = 0; i < 20000; i++) {
+        ASSERT_TRUE(reader.ReadEntity(entity));
+        ASSERT_EQ(entity.DType, SXMLEntity::EType::StartElement);
+        EXPECT_EQ(entity.AttributeValue("id"), std::to_string(i));
+        EXPECT_EQ(entity.AttributeValue("v"), "a & \"" + std::to_string(i * 7) + "\"");
+        ASSERT_TRUE(reader.ReadEntity(entity));
+        EXPECT_EQ(entity.DType, SXMLEntity::EType::EndElement);
+    }
+    ASSERT_TRUE(reader.ReadEntity(entity));
+    EXPECT_EQ(entity.DType, SXMLEntity::EType::EndElement);
+    EXPECT_FALSE(reader.ReadEntity(entity));
+}